@@ -26,6 +26,77 @@ Change History
 NEXT VERSION:
 - added tpSetDefaultProjection to setup an easy default projection for a certain draw area so you
 dont need to touch tpSetProjection most of the time.
+- added tpSetFlatteningMode. Curves are now flattened with a segment count computed up front
+(Wang's formula) and forward differencing by default. The old adaptive subdivision is still
+available via kTpFlatteningModeSubdivision.
+- added tpSetFlatteningTolerance. The flattening tolerance is now specified in device pixels and
+takes the full transform, projection and viewport (including skew and non-uniform scale) into
+account.
+- flattened path geometry is now cached in scale bands (powers of sqrt(2)). Zooming within a band
+reuses the cached geometry, zooming out switches to coarser geometry. Each path keeps the geometry
+of up to TARP_GL_MAX_LOD_BANDS bands.
+- paths with non scaling strokes now reuse their flattened geometry if the transform only
+translates, rotates and uniformly scales them. The stroke is only regenerated if the scale changes.
+- round joins and caps are now tessellated based on the stroke width in device pixels and the
+flattening tolerance instead of using a fixed number of segments.
+- strokes are now stored as unique vertices plus 16 bit (or 32 bit for very large paths) indices
+and drawn with glDrawElements, roughly halving the stroke vertex data that is uploaded.
+- added tpSetStrokeExtrusionMode. With kTpStrokeExtrusionModeGPU strokes are extruded in the
+vertex shader, so changing the stroke width (or the scale of a non scaling, non dashed stroke) only
+updates a uniform instead of regenerating the stroke geometry.
+- added tpSetJobSystem and tpSetThreadPoolSize to flatten and stroke paths with many contours in
+parallel chunks. The built-in thread pool uses pthreads on linux and macOS, so the implementation
+now has to be linked with -pthread there. Define TARP_NO_THREADS to compile without it.
+- added tpGeometryBuilder to generate render caches on any thread without touching OpenGL. Gradient
+ramp textures are now uploaded right before drawing.
+- render caches (including the internal ones of paths) now own their gpu buffers. Unchanged caches
+are drawn without uploading anything and modified caches only upload the contours that changed.
+- nonzero fills (and clipping masks) now write the winding in a single pass using two sided
+stencil operations instead of drawing every contour twice.
+- the fans of all contours of a fill or clipping mask are now submitted with a single
+glMultiDrawArrays instead of one draw call per contour.
+- added tpSetDrawBatching to draw consecutive, non overlapping solid color paths with a single
+upload and stencil and cover sequence. The matrix and colors of every draw are fetched from a
+texture buffer.
+- added tpDrawRenderCacheInstanced to draw a render cache many times with a different transform and
+colors per instance. Instances that don't overlap share their stencil and cover draw calls.
+- fills made of convex contours that don't overlap (i.e. rectangles, circles and ellipses) are now
+drawn directly in a single pass, without writing to the stencil buffer and drawing a cover quad.
+- added tpSetFillMode. With kTpFillModeTriangulate, tpDrawPath and tpCachePath triangulate fills on
+the cpu with a sweep line that honors the fill rule, so that solid color fills are drawn in a single
+pass.
+- the cover pass of fills and strokes now draws an octagon around the geometry (one per contour for
+shapes made of a few disjoint parts) instead of a bounding box, and the stroke bounds are computed
+from the stroke geometry instead of padding the path bounds by the miter limit.
+- solid color strokes are now drawn in a single pass. The stencil only guards against blending
+overlapping stroke triangles twice and is reset with a scissored clear instead of a cover pass.
+- clip paths that are pixel aligned rectangles in device space are now clipped with the scissor test
+instead of rendering a clipping mask to the stencil buffer. They can be mixed freely with other clip
+paths on the clipping stack.
+- the clipping stack is now stored as a depth in the stencil buffer. Beginning a clip path only
+rasterizes the pixels inside of it one level deeper and ending it draws its cover geometry to move
+them back up, so the stack is never cleared or rebuilt. The render caches that are cloned for the
+clipping stack are created on demand.
+- the depth of the clipping stack is stored in the upper TARP_GL_CLIP_DEPTH_BITS (4 by default) bits
+of the stencil buffer. This lowers the number of nested clip paths from 64 to 15 (pixel aligned
+rectangles don't count) and nonzero fills now wrap at a winding of 16 instead of 32.
+TARP_GL_MAX_CLIPPING_STACK_DEPTH was removed, defining it is an error now. A tpBeginClipping that
+failed still has to be ended with tpEndClipping.
+- the mask of the last clip path at the bottom of the clipping stack is kept in the stencil buffer
+after it ended, so beginning the same clip path again does not render it again. Added
+tpSetRetainClippingMasks to keep it across frames. Only this single mask is kept, not one per clip
+path.
+- draws that lie completely outside of the viewport, the scissor box or the active clip paths are
+now skipped. tpDrawPath tests the bounds of the path segments before generating any geometry, so
+paths that are off screen are not flattened or stroked either.
+- added tpSetContourCulling. Render caches with many contours keep a grid over the bounds of their
+contours, so that only the contours that overlap the viewport and the active clip paths are drawn.
+The stencil and cover passes are clamped to them with the scissor test.
+- added tpSetGeometryUploadMode. kTpGeometryUploadModeStreaming streams the geometry of every draw
+through a persistently mapped, fenced ring buffer (or an orphaned buffer if ARB_buffer_storage is
+not available), which suits content that changes every frame.
+- curves are flattened four at a time using SSE2 or NEON if available. Define TARP_NO_SIMD to use
+the plain C implementation instead.
 - fixed bug where cached strokes did not properly get copied to new renderCache.
 - more bug fixes
 
@@ -62,6 +133,7 @@ See end of file.
 /* @TODO: Double check which ones of these we actually need */
 #include <assert.h>
 #include <float.h>
+#include <limits.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -173,8 +245,34 @@ memory allocation!
 
 /* some tarp related opengl related settings */
 #define TARP_GL_RAMP_TEXTURE_SIZE 1024
-#define TARP_GL_MAX_CLIPPING_STACK_DEPTH 64
+#define TARP_GL_MAX_LOD_BANDS 4
 #define TARP_GL_ERROR_MESSAGE_SIZE 512
+#define TARP_GL_MAX_GEOMETRY_JOBS 16
+#define TARP_GL_MIN_CONTOURS_PER_JOB 256
+#define TARP_GL_MAX_DIRTY_RANGES 16
+#define TARP_GL_STREAM_FRAME_COUNT 3
+#define TARP_GL_STREAM_SECTION_SIZE (1024 * 1024)
+#define TARP_GL_MAX_BATCH_DRAWS 256
+#define TARP_GL_INSTANCE_GRID_SIZE 64
+#define TARP_GL_MAX_CONVEX_FILL_CONTOURS 64
+#define TARP_GL_MAX_COVER_CONTOURS 32
+#define TARP_GL_MIN_CULLED_CONTOURS 64
+#define TARP_GL_MAX_CONTOUR_GRID_SIZE 64
+
+/*
+the number of stencil bits that hold the depth of the clipping stack (see tpBeginClipping). The
+remaining bits hold the winding of nonzero fills, so more bits allow deeper nesting of clip paths
+at the cost of a smaller winding range. Define it before including tarp to change it.
+*/
+#ifndef TARP_GL_CLIP_DEPTH_BITS
+#define TARP_GL_CLIP_DEPTH_BITS 4
+#endif
+#if TARP_GL_CLIP_DEPTH_BITS < 1 || TARP_GL_CLIP_DEPTH_BITS > 6
+#error "TARP_GL_CLIP_DEPTH_BITS must be between 1 and 6, fills need at least two stencil bits."
+#endif
+#ifdef TARP_GL_MAX_CLIPPING_STACK_DEPTH
+#error "TARP_GL_MAX_CLIPPING_STACK_DEPTH was removed, use TARP_GL_CLIP_DEPTH_BITS instead."
+#endif
 
 #endif /* TARP_IMPLEMENTATION_OPENGL */
 
@@ -183,6 +281,8 @@ memory allocation!
 #define TARP_MAX_DASH_ARRAY_SIZE 64
 #define TARP_MAX_ERROR_MESSAGE 512
 #define TARP_MAX_CURVE_SUBDIVISIONS 16
+#define TARP_MAX_CURVE_SEGMENTS 1024
+#define TARP_MAX_ROUND_SEGMENTS 128
 #define TARP_RADIAL_GRADIENT_SLICES 64
 
 /* some helper macros */
@@ -200,6 +300,35 @@ memory allocation!
 #define TARP_IMPLEMENTATION
 #endif /* TARP_IMPLEMENTATION_OPENGL */
 
+/*
+simd instruction set used by the implementation to flatten curves in batches. Define
+TARP_NO_SIMD before including tarp to force the scalar reference implementation.
+*/
+#if defined(TARP_IMPLEMENTATION) && !defined(TARP_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TARP_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define TARP_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif /* defined(TARP_IMPLEMENTATION) && !defined(TARP_NO_SIMD) */
+
+/*
+threading api used by the built-in thread pool (see tpSetThreadPoolSize). With pthreads (linux,
+macOS) the implementation needs to be linked with -pthread (Threads::Threads in CMake). Define
+TARP_NO_THREADS before including tarp to compile without it.
+*/
+#if defined(TARP_IMPLEMENTATION) && !defined(TARP_NO_THREADS)
+#if defined(_WIN32)
+#define TARP_THREADS_WIN32
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define TARP_THREADS_PTHREAD
+#include <pthread.h>
+#endif
+#endif /* defined(TARP_IMPLEMENTATION) && !defined(TARP_NO_THREADS) */
+
 /*
 helper to generate a typesafe handle class.
 */
@@ -265,6 +394,30 @@ typedef enum
     kTpStrokeJoinBevel
 } tpStrokeJoin;
 
+typedef enum TARP_API
+{
+    kTpFlatteningModeForwardDifferencing,
+    kTpFlatteningModeSubdivision
+} tpFlatteningMode;
+
+typedef enum TARP_API
+{
+    kTpStrokeExtrusionModeCPU,
+    kTpStrokeExtrusionModeGPU
+} tpStrokeExtrusionMode;
+
+typedef enum TARP_API
+{
+    kTpFillModeStencil,
+    kTpFillModeTriangulate
+} tpFillMode;
+
+typedef enum TARP_API
+{
+    kTpGeometryUploadModeRetained,
+    kTpGeometryUploadModeStreaming
+} tpGeometryUploadMode;
+
 /*
 Basic Types
 ~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -306,6 +459,14 @@ typedef struct TARP_API
     tpVec2 t;
 } tpTransform;
 
+/* one instance of a render cache drawn with tpDrawRenderCacheInstanced */
+typedef struct TARP_API
+{
+    tpTransform transform;
+    tpColor fill;
+    tpColor stroke;
+} tpRenderCacheInstance;
+
 typedef struct TARP_API
 {
     tpFloat v[16];
@@ -357,7 +518,22 @@ typedef struct TARP_API
     tpBool scaleStroke;
 } tpStyle;
 
+typedef void (*tpJobFunction)(void * _data);
+
+/*
+Interface to an external job scheduler (see tpSetJobSystem). submit has to schedule _fn(_data) to
+be executed, possibly on another thread, and wait has to block until all submitted jobs are done.
+userData is passed to both of them.
+*/
+typedef struct TARP_API
+{
+    void * userData;
+    void (*submit)(void * _userData, tpJobFunction _fn, void * _data);
+    void (*wait)(void * _userData);
+} tpJobSystem;
+
 TARP_HANDLE(tpContext);
+TARP_HANDLE(tpGeometryBuilder);
 
 /*
 NOTE: All the color, matrix and vector functions are mainly for internal use
@@ -697,7 +873,88 @@ TARP_API tpBool tpSetTransform(tpContext _ctx, const tpTransform * _transform);
 /* Reset the transformation to the identity matrix */
 TARP_API tpBool tpResetTransform(tpContext _ctx);
 
-/* Draw a path with the provided style */
+/*
+Set the algorithm that is used to flatten curves. kTpFlatteningModeForwardDifferencing (the
+default) computes the number of line segments for each curve up front and evaluates them with
+forward differencing. kTpFlatteningModeSubdivision recursively subdivides each curve until it is
+flat enough (limited by TARP_MAX_CURVE_SUBDIVISIONS).
+*/
+TARP_API tpBool tpSetFlatteningMode(tpContext _ctx, tpFlatteningMode _mode);
+
+/*
+Set the maximum distance in device pixels between a curve and its flattened line segments
+(defaults to 0.15). Higher values produce less geometry at the cost of visual quality. The
+viewport is queried in tpPrepareDrawing to map the projection to device pixels.
+*/
+TARP_API tpBool tpSetFlatteningTolerance(tpContext _ctx, tpFloat _pixels);
+
+/*
+Set where strokes are extruded to their width. kTpStrokeExtrusionModeCPU (the default) generates
+the final stroke triangles on the cpu. kTpStrokeExtrusionModeGPU caches the stroke centerline
+vertices together with their extrusion and applies the stroke width in the vertex shader, so
+changing the stroke width or the scale of a non scaling stroke does not regenerate the stroke
+geometry. The tessellation of round joins and caps is only refined if the width changes a lot.
+*/
+TARP_API tpBool tpSetStrokeExtrusionMode(tpContext _ctx, tpStrokeExtrusionMode _mode);
+
+/*
+Set how the fills of tpDrawPath and tpCachePath are generated. With kTpFillModeStencil (the
+default) the fans of the contours are rasterized into the stencil buffer and covered.
+kTpFillModeTriangulate splits the fill into non overlapping triangles on the cpu with a sweep line,
+resolving self intersections and the fill rule of the style, so that solid color fills are drawn in
+a single pass without touching the stencil buffer. Triangulating is a lot more expensive than
+flattening, so it is meant for static content. A path drawn with tpDrawPath is triangulated again
+whenever any of its contours, its fill rule or its transform (for non scaling strokes) changes.
+*/
+TARP_API tpBool tpSetFillMode(tpContext _ctx, tpFillMode _mode);
+
+/*
+Set a job system that is used to flatten and stroke paths with many contours in parallel. The
+contours are split into chunks that are processed into separate buffers and merged in order, so
+the generated geometry is identical to processing them on the calling thread (the default, which
+you can go back to by passing NULL). TARP_MALLOC and friends need to be thread safe if you use this.
+*/
+TARP_API tpBool tpSetJobSystem(tpContext _ctx, const tpJobSystem * _jobSystem);
+
+/*
+Use a thread pool with _threadCount worker threads that is owned by the context as its job system
+(see tpSetJobSystem). Passing 0 stops the thread pool. Fails if tarp was compiled without threads.
+*/
+TARP_API tpBool tpSetThreadPoolSize(tpContext _ctx, int _threadCount);
+
+/*
+Set how the geometry of render caches gets to the gpu. With kTpGeometryUploadModeRetained (the
+default) every render cache owns gpu buffers that are only updated where the cache changed. With
+kTpGeometryUploadModeStreaming the geometry is written to a ring buffer owned by the context every
+time it is drawn, which suits content that changes every frame. The ring buffer is persistently
+mapped and fenced per frame if ARB_buffer_storage is available and orphaned otherwise. The mode
+takes effect at the next tpPrepareDrawing, which also creates the ring buffer the first time it is
+needed.
+*/
+TARP_API tpBool tpSetGeometryUploadMode(tpContext _ctx, tpGeometryUploadMode _mode);
+
+/*
+Enable or disable draw batching. While enabled, consecutive calls to tpDrawPath and
+tpDrawRenderCache are collected and drawn together with one upload and one stencil and cover
+sequence. The geometry is copied into the batch, so paths and caches can be changed or destroyed
+right after drawing them. A batch is drawn once a draw overlaps any draw in it (in device space),
+uses a different fill rule or a gradient, the clipping changes, the batching gets disabled or in
+tpFinishDrawing, so the painter's order is always kept. The geometry of a batch goes through the
+ring buffer of kTpGeometryUploadModeStreaming if that mode is active.
+*/
+TARP_API tpBool tpSetDrawBatching(tpContext _ctx, tpBool _bEnabled);
+
+/*
+Enable or disable contour culling. While enabled, paths and render caches with many contours that
+are only partially visible only draw the contours that overlap the viewport and the active clip
+paths, and all of their passes (including the cover) are clamped to where those contours are. The
+contours are looked up in a grid over their bounds that is built with the geometry of the cache.
+Caches whose contours get culled are not batched (see tpSetDrawBatching).
+*/
+TARP_API tpBool tpSetContourCulling(tpContext _ctx, tpBool _bEnabled);
+
+/* Draw a path with the provided style. Nothing is done (including generating its geometry) if the
+ * path lies outside of the viewport or the active clip paths. */
 TARP_API tpBool tpDrawPath(tpContext _ctx, tpPath _path, const tpStyle * _style);
 
 TARP_API tpRenderCache tpRenderCacheCreate();
@@ -707,10 +964,25 @@ TARP_API tpBool tpCachePath(tpContext _ctx,
                             const tpStyle * _style,
                             tpRenderCache _cache);
 
+/* Destroys the cache. Needs to be called on the thread that owns the OpenGL context if the cache
+ * was drawn, as it owns the gpu buffers it is drawn from. */
 TARP_API void tpRenderCacheDestroy(tpRenderCache _cache);
 
 TARP_API tpBool tpDrawRenderCache(tpContext _ctx, tpRenderCache _cache);
 
+/*
+Draw a render cache _count times. The transform of each instance is applied on top of the
+transform the cache was created with (including its stroke, so the stroke scales with it) and its
+colors replace the fill and stroke colors of the cache. Only caches with color paints can be drawn
+instanced. Instances are drawn in order, consecutive instances that don't overlap share their
+stencil and cover draw calls and instances outside of the viewport or the active clip paths are
+skipped.
+*/
+TARP_API tpBool tpDrawRenderCacheInstanced(tpContext _ctx,
+                                           tpRenderCache _cache,
+                                           const tpRenderCacheInstance * _instances,
+                                           int _count);
+
 TARP_API tpBool tpRenderCacheFlattenedContour(tpRenderCache _cache,
                                               int _contourIndex,
                                               tpVec2 ** _outVertices,
@@ -718,9 +990,35 @@ TARP_API tpBool tpRenderCacheFlattenedContour(tpRenderCache _cache,
 
 TARP_HANDLE_FUNCTIONS_DEF(tpRenderCache)
 
+/*
+A geometry builder generates the geometry of render caches without touching OpenGL or the context
+it was created from, so that paths can be cached on other threads and only uploaded and drawn on
+the thread that owns the context (tpDrawRenderCache). It copies the flattening mode, tolerance,
+stroke extrusion mode, fill mode, projection and viewport of the context on creation.
+
+Use one builder per thread. A path (including its gradients) must not be modified or cached by
+anything else while it is being cached, as the color stops of its gradients are finalized in the
+process. The contours are processed on the calling thread.
+*/
+TARP_API tpGeometryBuilder tpGeometryBuilderCreate(tpContext _ctx);
+
+TARP_API void tpGeometryBuilderDestroy(tpGeometryBuilder _builder);
+
+/* Like tpCachePath, but generates the geometry for the provided transform */
+TARP_API tpBool tpGeometryBuilderCachePath(tpGeometryBuilder _builder,
+                                           tpPath _path,
+                                           const tpStyle * _style,
+                                           const tpTransform * _transform,
+                                           tpRenderCache _cache);
+
+TARP_HANDLE_FUNCTIONS_DEF(tpGeometryBuilder)
+
 /*
 Define a clipping path. You can nest these calls. All following draw
-calls will be clippied by the provided path.
+calls will be clippied by the provided path. Up to 2^TARP_GL_CLIP_DEPTH_BITS - 1 (15 by default)
+clip paths can be nested, not counting the ones that are pixel aligned rectangles, which are
+clipped with the scissor test. Every call has to be matched by a call to tpEndClipping, even if it
+failed (i.e. because the clipping stack is full), in which case it does not clip anything.
 */
 TARP_API tpBool tpBeginClipping(tpContext _ctx, tpPath _path);
 
@@ -736,6 +1034,18 @@ TARP_API tpBool tpEndClipping(tpContext _ctx);
 /* End all clipping paths. This will remove all clipping. */
 TARP_API tpBool tpResetClipping(tpContext _ctx);
 
+/*
+The mask of the last clip path that ended at the bottom of the clipping stack stays in the stencil
+buffer until a different clip path begins there, so beginning the same clip path again (with the
+same transform, projection and viewport) does not render it again. Enable this to keep that mask
+across frames, too. Only that one mask is kept, not one per clip path: a different clip path
+beginning at the bottom of the stack replaces it, so of several panels that are clipped once per
+frame only the last one is reused. While enabled, the stencil buffer must not be changed between
+tpFinishDrawing and tpPrepareDrawing, i.e. don't clear it or draw to a different framebuffer in
+between.
+*/
+TARP_API tpBool tpSetRetainClippingMasks(tpContext _ctx, tpBool _bEnabled);
+
 /* Returns a string identifier of the current implementation */
 TARP_API const char * tpImplementationName();
 
@@ -757,6 +1067,7 @@ TARP_HANDLE_FUNCTIONS_DECL(tpPath)
 TARP_HANDLE_FUNCTIONS_DECL(tpGradient)
 TARP_HANDLE_FUNCTIONS_DECL(tpRenderCache)
 TARP_HANDLE_FUNCTIONS_DECL(tpContext)
+TARP_HANDLE_FUNCTIONS_DECL(tpGeometryBuilder)
 
 TARP_API tpColor tpColorMake(tpFloat _r, tpFloat _g, tpFloat _b, tpFloat _a)
 {
@@ -1253,10 +1564,12 @@ TARP_LOCAL void _tpGLSetErrorMessage(const char * _message)
 static const char * _vertexShaderCode =
     "#version 150 \n"
     "uniform mat4 transformProjection; \n"
+    "uniform float strokeHalfWidth; \n"
     "in vec2 vertex; \n"
+    "in vec2 extrusion; \n"
     "void main() \n"
     "{ \n"
-    "gl_Position = transformProjection * vec4(vertex, 0.0, 1.0); \n"
+    "gl_Position = transformProjection * vec4(vertex + extrusion * strokeHalfWidth, 0.0, 1.0); \n"
     "} \n";
 
 static const char * _fragmentShaderCode =
@@ -1293,9 +1606,74 @@ static const char * _fragmentShaderCodeTexture =
     "pixelColor.a = meshOpacity; \n"
     "} \n";
 
+/* the number of texels of the per draw data of a batch (matrix, fill color, stroke color and the
+ * stroke half width) */
+#define _kTpGLBatchTexelsPerDraw 7
+
+static const char * _vertexShaderCodeBatch =
+    "#version 150 \n"
+    "uniform samplerBuffer drawData; \n"
+    "uniform int colorSlot; \n"
+    "in vec2 vertex; \n"
+    "in vec2 extrusion; \n"
+    "in float drawIndex; \n"
+    "out vec4 icol; \n"
+    "void main() \n"
+    "{ \n"
+    "int b = int(drawIndex) * 7; \n"
+    "mat4 m = mat4(texelFetch(drawData, b), texelFetch(drawData, b + 1), \n"
+    "texelFetch(drawData, b + 2), texelFetch(drawData, b + 3)); \n"
+    "gl_Position = m * vec4(vertex + extrusion * texelFetch(drawData, b + 6).x, 0.0, 1.0); \n"
+    "icol = texelFetch(drawData, b + 4 + colorSlot); \n"
+    "} \n";
+
+/* the number of floats per instance in the instance buffer (matrix, translation, fill color and
+ * stroke color) */
+#define _kTpGLInstanceFloatCount 14
+
+/* the instance transform is applied between the render transform of the cache and the projection */
+static const char * _vertexShaderCodeInstanced =
+    "#version 150 \n"
+    "uniform mat4 projection; \n"
+    "uniform mat4 renderTransform; \n"
+    "uniform float strokeHalfWidth; \n"
+    "uniform int colorSlot; \n"
+    "in vec2 vertex; \n"
+    "in vec2 extrusion; \n"
+    "in vec4 im; \n"
+    "in vec2 it; \n"
+    "in vec4 fill; \n"
+    "in vec4 stroke; \n"
+    "out vec4 icol; \n"
+    "void main() \n"
+    "{ \n"
+    "vec4 p = renderTransform * vec4(vertex + extrusion * strokeHalfWidth, 0.0, 1.0); \n"
+    "p.xy = mat2(im.xy, im.zw) * p.xy + it * p.w; \n"
+    "gl_Position = projection * p; \n"
+    "icol = colorSlot == 0 ? fill : stroke; \n"
+    "} \n";
+
+static const char * _fragmentShaderCodeBatch =
+    "#version 150 \n"
+    "in vec4 icol; \n"
+    "out vec4 pixelColor; \n"
+    "void main() \n"
+    "{ \n"
+    "pixelColor = icol; \n"
+    "} \n";
+
 struct TARP_LOCAL _tpGLContext;
 typedef struct _tpGLContext _tpGLContext;
 
+/* the input shared by all jobs that flatten/stroke the contours of a path (see tpSetJobSystem) */
+struct TARP_LOCAL _tpGLFlattenJobInput;
+typedef struct _tpGLFlattenJobInput _tpGLFlattenJobInput;
+struct TARP_LOCAL _tpGLStrokeJobInput;
+typedef struct _tpGLStrokeJobInput _tpGLStrokeJobInput;
+
+struct TARP_LOCAL _tpGLThreadPool;
+typedef struct _tpGLThreadPool _tpGLThreadPool;
+
 typedef enum TARP_LOCAL
 {
     /*
@@ -1303,18 +1681,41 @@ typedef enum TARP_LOCAL
     2 bits. These need to be the lower bits in order to work with the
     Increment, Decrement stencil operations
     http://www.opengl.org/discussion_boards/showthread.php/149740-glStencilOp-s-GL_INCR-GL_DECR-behaviour-when-masked
+    Fills and strokes are never rasterized at the same time, which is why the stroke plane can share
+    the lowest bit of the fill plane. The clipping plane holds the depth of the clipping stack that
+    a pixel is inside of in the upper TARP_GL_CLIP_DEPTH_BITS bits (11110000 by default).
     */
-    _kTpGLFillRasterStencilPlane = 0x1F,    /* binary mask 00011111 */
-    _kTpGLClippingStencilPlaneOne = 1 << 5, /* binary mask 00100000 */
-    _kTpGLClippingStencilPlaneTwo = 1 << 6, /* binary mask 01000000 */
-    _kTpGLStrokeRasterStencilPlane = 1 << 7 /* binary mask 10000000 */
+    _kTpGLFillRasterStencilPlane = (1 << (8 - TARP_GL_CLIP_DEPTH_BITS)) - 1,
+    _kTpGLStrokeRasterStencilPlane = 0x01, /* binary mask 00000001 */
+    _kTpGLClippingStencilPlane = 0xFF - _kTpGLFillRasterStencilPlane
 } _tpGLStencilPlane;
 
+/* the clipping depth is stored in the upper bits of the stencil buffer, which limits the number of
+ * nested clip paths that are rendered to the stencil buffer */
+typedef enum TARP_LOCAL
+{
+    _kTpGLClippingDepthShift = 8 - TARP_GL_CLIP_DEPTH_BITS,
+    _kTpGLMaxClippingDepth = (1 << TARP_GL_CLIP_DEPTH_BITS) - 1
+} _tpGLClippingDepth;
+
+/* range of the scale bands that flattened path geometry is cached in (see _tpGLLodBand) */
+typedef enum TARP_LOCAL
+{
+    _kTpGLMinLodBand = -128,
+    _kTpGLMaxLodBand = 128,
+    _kTpGLInvalidLodBand = 129 /* the cached geometry does not belong to any band */
+} _tpGLLodBandRange;
+
 typedef struct TARP_LOCAL
 {
     tpVec2 min, max;
 } _tpGLRect;
 
+#define _TARP_ARRAY_T _tpGLRectArray
+#define _TARP_ITEM_T _tpGLRect
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
 typedef struct TARP_LOCAL
 {
     tpVec2 p0, h0, h1, p1;
@@ -1325,6 +1726,22 @@ typedef struct TARP_LOCAL
     _tpGLCurve first, second;
 } _tpGLCurvePair;
 
+/* control points of up to four curves in structure of arrays layout to flatten them in one go */
+typedef struct TARP_LOCAL
+{
+    tpFloat p0x[4], p0y[4];
+    tpFloat h0x[4], h0y[4];
+    tpFloat h1x[4], h1y[4];
+    tpFloat p1x[4], p1y[4];
+} _tpGLCurveBatch;
+
+/* precomputed rotations to tessellate round joins and caps */
+typedef struct TARP_LOCAL
+{
+    int count; /* the number of segments of a full circle */
+    tpVec2 rotations[TARP_MAX_ROUND_SEGMENTS]; /* cos and sin of the multiples of the step angle */
+} _tpGLRoundTable;
+
 #define _TARP_ARRAY_T _tpFloatArray
 #define _TARP_ITEM_T tpFloat
 #include <Tarp/TarpArray.h>
@@ -1343,6 +1760,45 @@ typedef struct TARP_LOCAL
 #define _TARP_COMPARATOR_T 0
 #include <Tarp/TarpArray.h>
 
+#define _TARP_ARRAY_T _tpGLIndexArray
+#define _TARP_ITEM_T GLuint
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+#define _TARP_ARRAY_T _tpGLShortIndexArray
+#define _TARP_ITEM_T GLushort
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+#define _TARP_ARRAY_T _tpGLIntArray
+#define _TARP_ITEM_T GLint
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+#define _TARP_ARRAY_T _tpGLSizeiArray
+#define _TARP_ITEM_T GLsizei
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+/* offsets into gpu buffers, as passed to glMultiDrawElements */
+typedef const GLvoid * _tpGLBufferOffset;
+
+#define _TARP_ARRAY_T _tpGLBufferOffsetArray
+#define _TARP_ITEM_T _tpGLBufferOffset
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+/* the buffers the stroke geometry is generated into */
+typedef struct TARP_LOCAL
+{
+    _tpVec2Array * fillVertices; /* the flattened contours that are stroked */
+    _tpVec2Array * vertices;     /* the stroke vertices are added after the fill vertices */
+    _tpVec2Array * extrusions;   /* the extrusion of each stroke vertex from its center... */
+    int extrusionOffset;         /* ...starting at this vertex index */
+    _tpGLIndexArray * indices;
+    tpBool bExtrudeOnGPU; /* only add the centers to the vertices (see tpStrokeExtrusionMode) */
+} _tpGLStrokeBuffers;
+
 #define _TARP_ARRAY_T _tpColorStopArray
 #define _TARP_ITEM_T tpColorStop
 #define _TARP_COMPARATOR_T 0
@@ -1392,6 +1848,7 @@ typedef struct TARP_LOCAL
 
     /* rendering specific data/caches */
     tpBool bDirty;
+    tpBool bRampDirty; /* the ramp texture is uploaded right before drawing if set */
     GLuint rampTexture;
 } _tpGLGradient;
 
@@ -1409,7 +1866,14 @@ typedef struct TARP_LOCAL
     int fillVertexCount;
     int strokeVertexOffset;
     int strokeVertexCount;
+    int strokeIndexOffset;
+    int strokeIndexCount;
     tpBool bIsClosed;
+    /* set by the flattener. The orientation is the sign of the area of the fill (1 or -1, 0 if the
+     * contour has no area) */
+    tpBool bIsConvex;
+    int orientation;
+    _tpGLRect bounds;
 } _tpGLRenderCacheContour;
 
 #define _TARP_ARRAY_T _tpGLRenderCacheContourArray
@@ -1417,22 +1881,144 @@ typedef struct TARP_LOCAL
 #define _TARP_COMPARATOR_T 0
 #include <Tarp/TarpArray.h>
 
+/* a non horizontal edge of the fill used to triangulate it (see _tpGLTriangulateFill) */
+typedef struct TARP_LOCAL
+{
+    tpVec2 top, bottom; /* top.y < bottom.y */
+    tpFloat dxdy;
+    int winding;  /* 1 if the contour goes down along the edge, -1 otherwise */
+    int openSpan; /* the span that has this edge as its left edge in the last slab or -1 */
+} _tpGLSweepEdge;
+
+#define _TARP_ARRAY_T _tpGLSweepEdgeArray
+#define _TARP_ITEM_T _tpGLSweepEdge
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+/* the filled area between two edges that is still growing downwards */
+typedef struct TARP_LOCAL
+{
+    int left, right;
+    tpFloat y; /* where the span started */
+    tpBool bContinued;
+} _tpGLSweepSpan;
+
+#define _TARP_ARRAY_T _tpGLSweepSpanArray
+#define _TARP_ITEM_T _tpGLSweepSpan
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+typedef struct TARP_LOCAL
+{
+    GLuint vao;
+    GLuint vbo;
+    GLuint vboSize;
+    GLuint ebo;
+    GLuint eboSize;
+    GLuint extrusionVbo;
+    GLuint extrusionVboSize;
+} _tpGLVAO;
+
+/* the element ranges of a gpu buffer that changed since it was last uploaded */
+typedef struct TARP_LOCAL
+{
+    int starts[TARP_GL_MAX_DIRTY_RANGES];
+    int ends[TARP_GL_MAX_DIRTY_RANGES];
+    int count;
+} _tpGLDirtyRanges;
+
+/* a chunk of the contours of a path that is flattened or stroked by one job */
+typedef struct TARP_LOCAL
+{
+    const _tpGLFlattenJobInput * flattenInput;
+    const _tpGLStrokeJobInput * strokeInput;
+    int contourStart;
+    int contourEnd;
+
+    /* the geometry generated for the chunk. Vertex offsets and indices are relative to the chunk
+     * until the chunks get merged */
+    _tpVec2Array vertices;
+    _tpBoolArray joints;
+    _tpVec2Array extrusions;
+    _tpGLIndexArray indices;
+    _tpGLRenderCacheContourArray contours;
+    _tpGLRect bounds;
+} _tpGLGeometryJob;
+
 typedef struct TARP_LOCAL
 {
     _tpGLRenderCacheContourArray contours;
+    /* the first vertex and vertex count of the fan of every contour, so that all fans are drawn
+     * with a single glMultiDrawArrays */
+    _tpGLIntArray fillFirsts;
+    _tpGLSizeiArray fillCounts;
+    /* all contours are convex and don't overlap, so the fill can be drawn without the stencil */
+    tpBool bConvexFill;
+    /* the fans of the geometry that covers the fill and stroke during the paint pass. They are
+     * stored at the end of the geometry cache, starting at boundsVertexOffset */
+    _tpGLIntArray fillCoverFirsts;
+    _tpGLSizeiArray fillCoverCounts;
+    _tpGLIntArray strokeCoverFirsts;
+    _tpGLSizeiArray strokeCoverCounts;
+    /*
+    a uniform grid over the bounds of the contours (including their stroke) that is used to only
+    draw the visible contours of caches with many of them (see tpSetContourCulling). The contours
+    of cell i are contourGridItems[contourGridCells[i], contourGridCells[i + 1]). contourGridSize is
+    0 for caches with less than TARP_GL_MIN_CULLED_CONTOURS contours.
+    */
+    _tpGLRectArray contourBounds;
+    _tpGLRect contourGridBounds;
+    int contourGridSize;
+    _tpGLIntArray contourGridCells;
+    _tpGLIntArray contourGridItems;
     _tpVec2Array geometryCache;
     _tpGLTextureVertexArray textureGeometryCache;
     _tpBoolArray jointCache;
+    /* the stroke triangles index into the geometry cache. Only one of the index caches is used at
+     * a time, depending on whether all stroke vertices can be addressed with 16 bit or not */
+    _tpGLIndexArray indexCache;
+    _tpGLShortIndexArray shortIndexCache;
+    GLenum indexType;
+    /* if the stroke is extruded on the gpu, the geometry cache only contains the centers of the
+     * stroke vertices and this array holds their extrusions (starting at strokeVertexOffset) */
+    _tpVec2Array extrusionCache;
+    tpBool bExtrudeStrokeOnGPU;
+    tpFloat strokeHalfWidth; /* the half width the extrusions are scaled by */
+    int roundSegmentCount;   /* the number of segments of a full circle used for round joins/caps */
     _tpGLRect boundsCache;
     _tpGLRect strokeBoundsCache;
     _tpGLGradientCacheData fillGradientData;
     _tpGLGradientCacheData strokeGradientData;
     int strokeVertexOffset;
     int strokeVertexCount;
+    int strokeIndexCount;
     int boundsVertexOffset;
+    /* the triangles of the fill if it was triangulated (see tpSetFillMode). They are stored right
+     * after the contours and drawn instead of the fans */
+    int fillTriangleOffset;
+    int fillTriangleCount;
     tpMat4 renderMatrix; /* either the transform or transformProjection */
+    tpMat4 renderProjection; /* the projection part of renderMatrix */
+    tpMat4 renderTransform; /* the transform part of renderMatrix */
+    tpBool bIsLocalSpace; /* was the geometry generated before applying the transform? */
+    tpFloat strokeScale;  /* the stroke width and dashes were divided by this scale */
     tpStyle style;
     _tpFloatArray dashArrayStorage; /* used to potentially copy the dash array to that style uses */
+
+    /*
+    the gpu buffers of the cache, created the first time it is drawn. generation is incremented
+    whenever the cached data changes and uploadedGeneration is the generation the buffers hold, so
+    unchanged caches are drawn without any upload. Otherwise only the vertex (geometry and
+    extrusions) and index ranges that changed since the last upload are uploaded.
+    */
+    _tpGLVAO vao;
+    _tpGLVAO textureVao;
+    int generation;
+    int uploadedGeneration;
+    GLenum uploadedIndexType;
+    _tpGLDirtyRanges dirtyVertices;
+    _tpGLDirtyRanges dirtyIndices;
+    tpBool bTextureGeometryDirty;
 } _tpGLRenderCache;
 
 typedef struct TARP_LOCAL
@@ -1441,7 +2027,6 @@ typedef struct TARP_LOCAL
     int currentContourIndex;
 
     tpBool bPathGeometryDirty;
-    tpFloat lastTransformScale;
 
     int lastFillGradientID;
     int lastStrokeGradientID;
@@ -1449,21 +2034,62 @@ typedef struct TARP_LOCAL
     _tpGLContext * lastDrawContext;
     int lastTransformID;
     int lastProjectionID;
+    int lastGeometrySettingsID;
 
     tpTransform fillPaintTransform;
     tpTransform strokePaintTransform;
     tpBool bFillPaintTransformDirty;
     tpBool bStrokePaintTransformDirty;
 
+    /* the bounds of the positions and handles of all segments, which contain the curves. They
+     * are used to cull the path before its geometry is generated */
+    _tpGLRect segmentBounds;
+    tpBool bSegmentBoundsDirty;
+
+    /* render cache of the current scale band */
     _tpGLRenderCache * renderCache;
+
+    /* the render caches of the most recently used scale bands */
+    _tpGLRenderCache * lodCaches[TARP_GL_MAX_LOD_BANDS];
+    int lodBands[TARP_GL_MAX_LOD_BANDS];
+    int lodCacheCount;
+    int lodIndex;
 } _tpGLPath;
 
+/* an entry of the clipping stack of a context */
 typedef struct TARP_LOCAL
 {
-    GLuint vao;
-    GLuint vbo;
-    GLuint vboSize;
-} _tpGLVAO;
+    /* axis aligned rectangles are clipped against with the scissor test alone, all other clip
+     * paths are rendered to the stencil planes. Clip paths that failed to begin are kept as
+     * scissor clips that did not change the scissor box, so that ending them does nothing. */
+    tpBool bIsScissorClip;
+    /* the scissor state before the clip began */
+    GLboolean bScissorTest;
+    GLint scissorBox[4];
+    /* the clip bounds of the context before the clip began */
+    _tpGLRect clipBounds;
+} _tpGLClip;
+
+#define _TARP_ARRAY_T _tpGLClipArray
+#define _TARP_ITEM_T _tpGLClip
+#define _TARP_COMPARATOR_T 0
+#include <Tarp/TarpArray.h>
+
+/* everything the mask of a clip path at the bottom of the clipping stack depends on, to tell if it
+ * can be reused when a clip path begins there again */
+typedef struct TARP_LOCAL
+{
+    _tpVec2Array vertices;
+    _tpGLSizeiArray fillCounts;
+    int fillTriangleCount;
+    tpFillRule fillRule;
+    tpMat4 renderMatrix;
+    GLint viewport[4];
+    GLboolean bScissorTest;
+    GLint scissorBox[4];
+    /* the pixels that the mask was rendered to lie within these bounds */
+    _tpGLRect deviceBounds;
+} _tpGLClipMaskKey;
 
 typedef struct TARP_LOCAL
 {
@@ -1487,53 +2113,207 @@ typedef struct TARP_LOCAL
     GLboolean cullFace;
     GLenum cullFaceMode;
     GLenum frontFace;
+    GLboolean scissorTest;
+    GLint scissorBox[4];
     GLuint vao;
     GLuint vbo;
     GLuint program;
 } _tpGLStateBackup;
 
+/*
+the ring buffer that geometry is streamed through with kTpGeometryUploadModeStreaming. If it is
+persistently mapped, it is split into one section per frame in flight that is guarded by a fence.
+Otherwise the whole buffer is written with glBufferSubData and orphaned once it is full.
+*/
+typedef struct TARP_LOCAL
+{
+    GLuint vao;
+    GLuint textureVao;
+    GLuint buffer;
+    GLsizeiptr sectionSize;
+    char * mapped;
+    tpBool bPersistent;
+    GLsync fences[TARP_GL_STREAM_FRAME_COUNT];
+    int section;
+    GLsizeiptr head;
+    GLsizeiptr end;
+} _tpGLStreamBuffer;
+
+/*
+consecutive draws that are collected while draw batching is enabled (see tpSetDrawBatching). The
+geometry of all draws is merged into one set of buffers and every vertex knows the index of its
+draw, which is used to look up the matrix, colors and stroke half width of the draw from the
+drawData texture buffer (_kTpGLBatchTexelsPerDraw texels per draw). Draws in a batch never overlap,
+so they can share one stencil and cover sequence. The vertices, extrusions, draw indices and
+indices are packed into vbo (or a block of the stream buffer) one after another.
+*/
+typedef struct TARP_LOCAL
+{
+    GLuint vao;
+    GLuint vbo;
+    GLuint dataBuffer;
+    GLuint dataTexture;
+
+    _tpVec2Array vertices;
+    _tpVec2Array extrusions;
+    _tpFloatArray drawIndices;
+    _tpGLIndexArray indices;
+    _tpFloatArray drawData;
+    _tpGLIntArray fillFirsts;
+    _tpGLSizeiArray fillCounts;
+    _tpGLIntArray fillCoverFirsts;
+    _tpGLSizeiArray fillCoverCounts;
+    _tpGLRectArray deviceBounds;
+    tpFillRule fillRule;
+    int drawCount;
+} _tpGLDrawBatch;
+
+/*
+everything needed to generate the geometry of a render cache. The context owns one that is synced
+with its transform and projection before caching, tpGeometryBuilder is a standalone one.
+*/
+typedef struct TARP_LOCAL
+{
+    /* see tpSetFlatteningMode, tpSetFlatteningTolerance and tpSetStrokeExtrusionMode */
+    tpFlatteningMode flatteningMode;
+    tpFloat flatteningTolerance;
+    tpStrokeExtrusionMode strokeExtrusionMode;
+    tpFillMode fillMode; /* see tpSetFillMode */
+
+    /* the transform and projection the geometry is generated for (see _tpGLContext) */
+    GLint viewport[4];
+    tpTransform transform;
+    tpMat4 projection;
+    tpMat4 transformProjection;
+    tpFloat transformScale;
+    tpFloat projectionScale;
+
+    /* used to generate the geometry of paths with many contours in parallel if set */
+    tpJobSystem jobSystem;
+    _tpGLGeometryJob geometryJobs[TARP_GL_MAX_GEOMETRY_JOBS];
+
+    /* used to temporarily store vertex/stroke data (think double buffering)
+     */
+    _tpVec2Array tmpVertices;
+    _tpBoolArray tmpJoints;
+    _tpGLIndexArray tmpIndices;
+    _tpVec2Array tmpExtrusions;
+    _tpGLTextureVertexArray tmpTexVertices;
+    _tpColorStopArray tmpColorStops;
+    _tpGLRenderCacheContourArray tmpRcContours;
+
+    /* used to triangulate fills */
+    _tpGLSweepEdgeArray sweepEdges;
+    _tpFloatArray sweepYs;
+    _tpGLIntArray sweepActive;
+    _tpFloatArray sweepXs;
+    _tpGLSweepSpanArray sweepSpans;
+    _tpGLSweepSpanArray sweepNextSpans;
+} _tpGLGeometryBuilder;
+
 struct _tpGLContext
 {
     GLuint program;
     GLuint textureProgram;
+    GLuint batchProgram;
+    GLuint instanceProgram;
 
     /* uniform locations for the color shaders */
     GLuint tpLoc;
     GLuint meshColorLoc;
+    GLuint strokeHalfWidthLoc;
 
     /* uniform locations for the texture shaders */
     GLuint tpTextureLoc;
     GLuint opacityTextureLoc;
 
-    _tpGLVAO vao;
-    _tpGLVAO textureVao;
-
-    /* this array allocates render caches that the context takes ownership over in cases where a
-     * render cache needs to be cloned */
-    _tpGLRenderCache * clippingRenderCaches[TARP_GL_MAX_CLIPPING_STACK_DEPTH];
-    /* this render cache array is the actual active clipping stack */
-    _tpGLRenderCache * clippingStack[TARP_GL_MAX_CLIPPING_STACK_DEPTH];
+    /* uniform locations for the batch shaders */
+    GLuint drawDataLoc;
+    GLuint colorSlotLoc;
+
+    /* uniform locations for the instancing shaders */
+    GLuint instanceProjectionLoc;
+    GLuint instanceRenderTransformLoc;
+    GLuint instanceStrokeHalfWidthLoc;
+    GLuint instanceColorSlotLoc;
+
+    /* this array holds render caches that the context takes ownership over in cases where a
+     * render cache needs to be cloned. They are created the first time they are needed */
+    _tpGLRenderCache * clippingRenderCaches[_kTpGLMaxClippingDepth];
+    /* this render cache array is the actual active clipping stack of the clips that use the
+     * stencil planes. clippingStackDepth is also the value of the clipping plane inside of them */
+    _tpGLRenderCache * clippingStack[_kTpGLMaxClippingDepth];
     int clippingStackDepth;
+    /* all clips that are active, including the scissor clips */
+    _tpGLClipArray clips;
+    /* the mask of the last clip path that was rendered at the bottom of the stack. Once it ended,
+     * bHasRetainedClipMask is set as the mask is still in the stencil buffer */
+    _tpGLClipMaskKey clipMaskKey;
+    tpBool bHasRetainedClipMask;
+    tpBool bRetainClippingMasks;
+    /* the scissor state tarp draws with, i.e. the scissor box of the user intersected with the
+     * active scissor clips */
+    GLboolean bScissorTest;
+    GLint scissorBox[4];
+    /* everything that is drawn lies within these bounds in normalized device coordinates, i.e.
+     * the viewport intersected with the scissor box and the bounds of the active clip paths */
+    _tpGLRect clipBounds;
 
-    int currentClipStencilPlane;
-    tpBool bCanSwapStencilPlanes;
     tpTransform transform;
     tpMat4 renderTransform;
     tpMat4 projection;
     tpMat4 transformProjection;
+    /* the maximum number of device pixels one unit in path space (transformScale) and after the
+     * transform (projectionScale) can span */
     tpFloat transformScale;
+    tpFloat projectionScale;
+    GLint viewport[4];
     int transformID;
     int projectionID;
     tpBool bTransformProjDirty;
     tpStyle clippingStyle;
 
-    /* used to temporarily store vertex/stroke data (think double buffering)
-     */
-    _tpVec2Array tmpVertices;
-    _tpBoolArray tmpJoints;
-    _tpGLTextureVertexArray tmpTexVertices;
-    _tpColorStopArray tmpColorStops;
-    _tpGLRenderCacheContourArray tmpRcContours;
+    /* generates the geometry of all paths drawn with the context. It holds the settings that
+     * affect the generated geometry (flattening mode/tolerance, stroke extrusion mode, fill mode
+     * and job system). geometrySettingsID is incremented whenever one of them changes so that
+     * internal path caches know to regenerate their geometry */
+    _tpGLGeometryBuilder builder;
+    int geometrySettingsID;
+    _tpGLThreadPool * threadPool; /* the built-in job system (see tpSetThreadPoolSize) */
+    tpGeometryUploadMode uploadMode;
+    /* set by tpSetGeometryUploadMode and applied in tpPrepareDrawing */
+    tpGeometryUploadMode requestedUploadMode;
+    _tpGLStreamBuffer stream;
+    /* where the geometry of the render cache that is currently drawn lives */
+    GLuint drawVao;
+    GLuint drawTextureVao;
+    GLsizeiptr drawIndexOffset;
+    tpBool bBatchDraws;
+    _tpGLDrawBatch batch;
+
+    /*
+    the instances of tpDrawRenderCacheInstanced, split into runs of consecutive instances that
+    don't overlap. The grid marks the cells of normalized device space that the current run covers.
+    */
+    GLuint instanceVbo;
+    _tpFloatArray instanceData;
+    _tpGLIntArray instanceRuns;
+    _tpGLRectArray instanceRunBounds; /* the device bounds of all instances of a run */
+    int instanceGrid[TARP_GL_INSTANCE_GRID_SIZE * TARP_GL_INSTANCE_GRID_SIZE];
+    int instanceRunStamp;
+
+    /*
+    the contours of the cache that is being drawn that are visible if contour culling is enabled,
+    as fans and ranges of stroke indices. The stamps mark the contours that were already visited
+    while walking the cells of the contour grid of the cache.
+    */
+    tpBool bCullContours;
+    _tpGLIntArray visibleFillFirsts;
+    _tpGLSizeiArray visibleFillCounts;
+    _tpGLSizeiArray visibleStrokeCounts;
+    _tpGLBufferOffsetArray visibleStrokeOffsets;
+    _tpGLIntArray contourStamps;
+    int contourStamp;
 
     _tpGLStateBackup stateBackup;
 };
@@ -1544,30 +2324,195 @@ typedef struct TARP_LOCAL
     int length;
 } _ErrorMessage;
 
-TARP_LOCAL void _tpGLGradientCacheDataInit(_tpGLGradientCacheData * _gd, _tpGLRect * _bounds)
+/*
+the built-in thread pool. The thread that waits for the jobs to complete works on them, too.
+*/
+#if defined(TARP_THREADS_PTHREAD)
+typedef pthread_t _tpGLThread;
+typedef pthread_mutex_t _tpGLMutex;
+typedef pthread_cond_t _tpGLCondition;
+#define _TARP_THREAD_FUNCTION(_name) void * _name(void * _arg)
+#define _tpGLMutexInit(_m) pthread_mutex_init(_m, NULL)
+#define _tpGLMutexDestroy(_m) pthread_mutex_destroy(_m)
+#define _tpGLMutexLock(_m) pthread_mutex_lock(_m)
+#define _tpGLMutexUnlock(_m) pthread_mutex_unlock(_m)
+#define _tpGLConditionInit(_c) pthread_cond_init(_c, NULL)
+#define _tpGLConditionDestroy(_c) pthread_cond_destroy(_c)
+#define _tpGLConditionWait(_c, _m) pthread_cond_wait(_c, _m)
+#define _tpGLConditionBroadcast(_c) pthread_cond_broadcast(_c)
+#define _tpGLThreadStart(_t, _fn, _arg) (pthread_create(_t, NULL, _fn, _arg) == 0)
+#define _tpGLThreadJoin(_t) pthread_join(_t, NULL)
+#elif defined(TARP_THREADS_WIN32)
+typedef HANDLE _tpGLThread;
+typedef CRITICAL_SECTION _tpGLMutex;
+typedef CONDITION_VARIABLE _tpGLCondition;
+#define _TARP_THREAD_FUNCTION(_name) DWORD WINAPI _name(LPVOID _arg)
+#define _tpGLMutexInit(_m) InitializeCriticalSection(_m)
+#define _tpGLMutexDestroy(_m) DeleteCriticalSection(_m)
+#define _tpGLMutexLock(_m) EnterCriticalSection(_m)
+#define _tpGLMutexUnlock(_m) LeaveCriticalSection(_m)
+#define _tpGLConditionInit(_c) InitializeConditionVariable(_c)
+#define _tpGLConditionDestroy(_c)
+#define _tpGLConditionWait(_c, _m) SleepConditionVariableCS(_c, _m, INFINITE)
+#define _tpGLConditionBroadcast(_c) WakeAllConditionVariable(_c)
+#define _tpGLThreadStart(_t, _fn, _arg)                                                            \
+    ((*(_t) = CreateThread(NULL, 0, _fn, _arg, 0, NULL)) != NULL)
+#define _tpGLThreadJoin(_t) (WaitForSingleObject(_t, INFINITE), CloseHandle(_t))
+#endif
+
+#if defined(TARP_THREADS_PTHREAD) || defined(TARP_THREADS_WIN32)
+
+typedef struct TARP_LOCAL
 {
-    _gd->bounds = _bounds;
-    _gd->vertexOffset = 0;
-    _gd->vertexCount = 0;
-}
+    tpJobFunction fn;
+    void * data;
+} _tpGLJob;
 
-/* @TODO: Get rid of all the _ErrorMessage things and call
- * _tpGLSetErrorMessage instead? */
-TARP_LOCAL tpBool _compileShader(const char * _shaderCode,
-                                 GLenum _shaderType,
-                                 GLuint * _outHandle,
-                                 _ErrorMessage * _outError)
+struct _tpGLThreadPool
 {
-    GLenum glHandle;
-    GLint state, len, infologLength;
+    _tpGLThread * threads;
+    int threadCount;
+    _tpGLMutex mutex;
+    _tpGLCondition jobAvailable;
+    _tpGLCondition jobsDone;
 
-    glHandle = glCreateShader(_shaderType);
-    len = (GLint)strlen(_shaderCode);
-    _TARP_ASSERT_NO_GL_ERROR(glShaderSource(glHandle, 1, &_shaderCode, &len));
-    _TARP_ASSERT_NO_GL_ERROR(glCompileShader(glHandle));
+    /* the jobs submitted since the last wait. nextJob is the next one that is not taken yet */
+    _tpGLJob jobs[TARP_GL_MAX_GEOMETRY_JOBS];
+    int jobCount;
+    int nextJob;
+    int unfinishedJobCount;
+    tpBool bShutdown;
+};
 
-    /* check if the shader compiled */
-    _TARP_ASSERT_NO_GL_ERROR(glGetShaderiv(glHandle, GL_COMPILE_STATUS, &state));
+/* runs the next job that is not taken yet. The pool mutex needs to be locked */
+TARP_LOCAL void _tpGLThreadPoolRunJob(_tpGLThreadPool * _pool)
+{
+    _tpGLJob job = _pool->jobs[_pool->nextJob++];
+    _tpGLMutexUnlock(&_pool->mutex);
+    job.fn(job.data);
+    _tpGLMutexLock(&_pool->mutex);
+    if (--_pool->unfinishedJobCount == 0)
+        _tpGLConditionBroadcast(&_pool->jobsDone);
+}
+
+TARP_LOCAL _TARP_THREAD_FUNCTION(_tpGLThreadPoolWorker)
+{
+    _tpGLThreadPool * pool = (_tpGLThreadPool *)_arg;
+
+    _tpGLMutexLock(&pool->mutex);
+    while (!pool->bShutdown)
+    {
+        if (pool->nextJob < pool->jobCount)
+            _tpGLThreadPoolRunJob(pool);
+        else
+            _tpGLConditionWait(&pool->jobAvailable, &pool->mutex);
+    }
+    _tpGLMutexUnlock(&pool->mutex);
+    return 0;
+}
+
+TARP_LOCAL void _tpGLThreadPoolSubmit(void * _userData, tpJobFunction _fn, void * _data)
+{
+    _tpGLThreadPool * pool = (_tpGLThreadPool *)_userData;
+
+    _tpGLMutexLock(&pool->mutex);
+    assert(pool->jobCount < TARP_GL_MAX_GEOMETRY_JOBS);
+    pool->jobs[pool->jobCount].fn = _fn;
+    pool->jobs[pool->jobCount].data = _data;
+    pool->jobCount++;
+    pool->unfinishedJobCount++;
+    _tpGLConditionBroadcast(&pool->jobAvailable);
+    _tpGLMutexUnlock(&pool->mutex);
+}
+
+TARP_LOCAL void _tpGLThreadPoolWait(void * _userData)
+{
+    _tpGLThreadPool * pool = (_tpGLThreadPool *)_userData;
+
+    _tpGLMutexLock(&pool->mutex);
+    while (pool->nextJob < pool->jobCount)
+        _tpGLThreadPoolRunJob(pool);
+    while (pool->unfinishedJobCount)
+        _tpGLConditionWait(&pool->jobsDone, &pool->mutex);
+    pool->jobCount = 0;
+    pool->nextJob = 0;
+    _tpGLMutexUnlock(&pool->mutex);
+}
+
+TARP_LOCAL void _tpGLThreadPoolDestroy(_tpGLThreadPool * _pool)
+{
+    int i;
+
+    _tpGLMutexLock(&_pool->mutex);
+    _pool->bShutdown = tpTrue;
+    _tpGLConditionBroadcast(&_pool->jobAvailable);
+    _tpGLMutexUnlock(&_pool->mutex);
+
+    for (i = 0; i < _pool->threadCount; ++i)
+        _tpGLThreadJoin(_pool->threads[i]);
+
+    _tpGLConditionDestroy(&_pool->jobsDone);
+    _tpGLConditionDestroy(&_pool->jobAvailable);
+    _tpGLMutexDestroy(&_pool->mutex);
+    TARP_FREE(_pool->threads);
+    TARP_FREE(_pool);
+}
+
+TARP_LOCAL _tpGLThreadPool * _tpGLThreadPoolCreate(int _threadCount)
+{
+    _tpGLThreadPool * pool;
+
+    pool = (_tpGLThreadPool *)TARP_MALLOC(sizeof(_tpGLThreadPool));
+    assert(pool);
+    pool->threads = (_tpGLThread *)TARP_MALLOC(sizeof(_tpGLThread) * _threadCount);
+    assert(pool->threads);
+    pool->threadCount = 0;
+    pool->jobCount = 0;
+    pool->nextJob = 0;
+    pool->unfinishedJobCount = 0;
+    pool->bShutdown = tpFalse;
+    _tpGLMutexInit(&pool->mutex);
+    _tpGLConditionInit(&pool->jobAvailable);
+    _tpGLConditionInit(&pool->jobsDone);
+
+    for (; pool->threadCount < _threadCount; ++pool->threadCount)
+    {
+        if (!_tpGLThreadStart(
+                &pool->threads[pool->threadCount], _tpGLThreadPoolWorker, (void *)pool))
+        {
+            _tpGLThreadPoolDestroy(pool);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+#endif /* defined(TARP_THREADS_PTHREAD) || defined(TARP_THREADS_WIN32) */
+
+TARP_LOCAL void _tpGLGradientCacheDataInit(_tpGLGradientCacheData * _gd, _tpGLRect * _bounds)
+{
+    _gd->bounds = _bounds;
+    _gd->vertexOffset = 0;
+    _gd->vertexCount = 0;
+}
+
+/* @TODO: Get rid of all the _ErrorMessage things and call
+ * _tpGLSetErrorMessage instead? */
+TARP_LOCAL tpBool _compileShader(const char * _shaderCode,
+                                 GLenum _shaderType,
+                                 GLuint * _outHandle,
+                                 _ErrorMessage * _outError)
+{
+    GLenum glHandle;
+    GLint state, len, infologLength;
+
+    glHandle = glCreateShader(_shaderType);
+    len = (GLint)strlen(_shaderCode);
+    _TARP_ASSERT_NO_GL_ERROR(glShaderSource(glHandle, 1, &_shaderCode, &len));
+    _TARP_ASSERT_NO_GL_ERROR(glCompileShader(glHandle));
+
+    /* check if the shader compiled */
+    _TARP_ASSERT_NO_GL_ERROR(glGetShaderiv(glHandle, GL_COMPILE_STATUS, &state));
     if (state == GL_FALSE)
     {
         if (_outError)
@@ -1614,6 +2559,15 @@ TARP_LOCAL tpBool _createProgram(const char * _vertexShader,
     _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 0, "vertex"));
     if (_bTexProgram)
         _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 1, "tc"));
+    else
+        _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 1, "extrusion"));
+    /* only used by the batch program */
+    _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 2, "drawIndex"));
+    /* only used by the instancing program */
+    _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 3, "im"));
+    _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 4, "it"));
+    _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 5, "fill"));
+    _TARP_ASSERT_NO_GL_ERROR(glBindAttribLocation(program, 6, "stroke"));
 
     _TARP_ASSERT_NO_GL_ERROR(glLinkProgram(program));
 
@@ -1659,6 +2613,117 @@ TARP_API const char * tpImplementationName()
     return "OpenGL";
 }
 
+/* adds the element range [_start, _end) to _ranges. If all ranges are in use, they are merged
+ * into a single one */
+TARP_LOCAL void _tpGLDirtyRangesAdd(_tpGLDirtyRanges * _ranges, int _start, int _end)
+{
+    int i, last;
+
+    if (_start >= _end)
+        return;
+
+    /* ranges are mostly added in ascending order, so try to extend the last one */
+    last = _ranges->count - 1;
+    if (last >= 0 && _start <= _ranges->ends[last] && _end >= _ranges->starts[last])
+    {
+        _ranges->starts[last] = TARP_MIN(_ranges->starts[last], _start);
+        _ranges->ends[last] = TARP_MAX(_ranges->ends[last], _end);
+        return;
+    }
+
+    if (_ranges->count == TARP_GL_MAX_DIRTY_RANGES)
+    {
+        for (i = 0; i < _ranges->count; ++i)
+        {
+            _start = TARP_MIN(_ranges->starts[i], _start);
+            _end = TARP_MAX(_ranges->ends[i], _end);
+        }
+        _ranges->count = 0;
+    }
+
+    _ranges->starts[_ranges->count] = _start;
+    _ranges->ends[_ranges->count++] = _end;
+}
+
+TARP_LOCAL void _tpGLDirtyRangesAddAll(_tpGLDirtyRanges * _ranges)
+{
+    _ranges->starts[0] = 0;
+    _ranges->ends[0] = INT_MAX;
+    _ranges->count = 1;
+}
+
+/* marks all data of the cache as changed, i.e. it is uploaded completely before drawing it */
+TARP_LOCAL void _tpGLRenderCacheMarkDirty(_tpGLRenderCache * _cache)
+{
+    _tpGLDirtyRangesAddAll(&_cache->dirtyVertices);
+    _tpGLDirtyRangesAddAll(&_cache->dirtyIndices);
+    _cache->bTextureGeometryDirty = tpTrue;
+    _cache->generation++;
+}
+
+/* marks the vertices [_start, _end) of the cache (and their extrusions) as changed */
+TARP_LOCAL void _tpGLRenderCacheMarkDirtyVertices(_tpGLRenderCache * _cache, int _start, int _end)
+{
+    _tpGLDirtyRangesAdd(&_cache->dirtyVertices, _start, _end);
+    _cache->generation++;
+}
+
+/* marks the stroke indices [_start, _end) of the cache as changed */
+TARP_LOCAL void _tpGLRenderCacheMarkDirtyIndices(_tpGLRenderCache * _cache, int _start, int _end)
+{
+    _tpGLDirtyRangesAdd(&_cache->dirtyIndices, _start, _end);
+    _cache->generation++;
+}
+
+/* checks if all contours are convex and don't overlap, in which case their fans don't either */
+TARP_LOCAL tpBool _tpGLIsConvexFill(const _tpGLRenderCacheContourArray * _contours)
+{
+    int i, j;
+    const _tpGLRenderCacheContour *c, *other;
+
+    /* the bounds of the contours are compared pairwise, so only do it for a few contours */
+    if (!_contours->count || _contours->count > TARP_GL_MAX_CONVEX_FILL_CONTOURS)
+        return tpFalse;
+
+    for (i = 0; i < _contours->count; ++i)
+    {
+        c = &_contours->array[i];
+        if (!c->bIsConvex)
+            return tpFalse;
+        for (j = 0; j < i; ++j)
+        {
+            other = &_contours->array[j];
+            if (c->bounds.min.x <= other->bounds.max.x && other->bounds.min.x <= c->bounds.max.x &&
+                c->bounds.min.y <= other->bounds.max.y && other->bounds.min.y <= c->bounds.max.y)
+                return tpFalse;
+        }
+    }
+    return tpTrue;
+}
+
+/* collects the fans of the contours for glMultiDrawArrays and checks if they can be drawn
+ * directly */
+TARP_LOCAL void _tpGLRenderCacheUpdateFillRanges(_tpGLRenderCache * _cache)
+{
+    int i;
+    _tpGLRenderCacheContour * c;
+
+    _tpGLIntArrayClear(&_cache->fillFirsts);
+    _tpGLSizeiArrayClear(&_cache->fillCounts);
+    _tpGLIntArrayReserveAdditional(&_cache->fillFirsts, _cache->contours.count);
+    _tpGLSizeiArrayReserveAdditional(&_cache->fillCounts, _cache->contours.count);
+    for (i = 0; i < _cache->contours.count; ++i)
+    {
+        c = &_cache->contours.array[i];
+        _cache->fillFirsts.array[i] = c->fillVertexOffset;
+        _cache->fillCounts.array[i] = c->fillVertexCount;
+    }
+    _cache->fillFirsts.count = _cache->contours.count;
+    _cache->fillCounts.count = _cache->contours.count;
+
+    _cache->bConvexFill = _tpGLIsConvexFill(&_cache->contours);
+}
+
 TARP_API tpRenderCache tpRenderCacheCreate()
 {
     tpRenderCache ret;
@@ -1666,9 +2731,29 @@ TARP_API tpRenderCache tpRenderCacheCreate()
     _tpGLRenderCache * renderCache = (_tpGLRenderCache *)TARP_MALLOC(sizeof(_tpGLRenderCache));
 
     _tpGLRenderCacheContourArrayInit(&renderCache->contours, 4);
+    _tpGLIntArrayInit(&renderCache->fillFirsts, 4);
+    _tpGLSizeiArrayInit(&renderCache->fillCounts, 4);
+    renderCache->bConvexFill = tpFalse;
+    _tpGLIntArrayInit(&renderCache->fillCoverFirsts, 1);
+    _tpGLSizeiArrayInit(&renderCache->fillCoverCounts, 1);
+    _tpGLIntArrayInit(&renderCache->strokeCoverFirsts, 1);
+    _tpGLSizeiArrayInit(&renderCache->strokeCoverCounts, 1);
+    _tpGLRectArrayInit(&renderCache->contourBounds, 1);
+    renderCache->contourGridSize = 0;
+    _tpGLIntArrayInit(&renderCache->contourGridCells, 1);
+    _tpGLIntArrayInit(&renderCache->contourGridItems, 1);
+    renderCache->fillTriangleOffset = 0;
+    renderCache->fillTriangleCount = 0;
     _tpVec2ArrayInit(&renderCache->geometryCache, 128);
     _tpGLTextureVertexArrayInit(&renderCache->textureGeometryCache, 8);
     _tpBoolArrayInit(&renderCache->jointCache, 128);
+    _tpGLIndexArrayInit(&renderCache->indexCache, 8);
+    _tpGLShortIndexArrayInit(&renderCache->shortIndexCache, 128);
+    renderCache->indexType = GL_UNSIGNED_SHORT;
+    _tpVec2ArrayInit(&renderCache->extrusionCache, 8);
+    renderCache->bExtrudeStrokeOnGPU = tpFalse;
+    renderCache->strokeHalfWidth = 0;
+    renderCache->roundSegmentCount = 0;
 
     _tpGLGradientCacheDataInit(&renderCache->fillGradientData, &renderCache->boundsCache);
     _tpGLGradientCacheDataInit(&renderCache->strokeGradientData, &renderCache->strokeBoundsCache);
@@ -1677,7 +2762,24 @@ TARP_API tpRenderCache tpRenderCacheCreate()
 
     renderCache->strokeVertexOffset = 0;
     renderCache->strokeVertexCount = 0;
+    renderCache->strokeIndexCount = 0;
     renderCache->boundsVertexOffset = 0;
+    renderCache->bIsLocalSpace = tpTrue;
+    renderCache->renderMatrix = tpMat4MakeIdentity();
+    renderCache->renderProjection = tpMat4MakeIdentity();
+    renderCache->renderTransform = tpMat4MakeIdentity();
+    renderCache->strokeScale = 1.0f;
+
+    /* the gpu buffers are only created once the cache is drawn, as it might be built on a
+     * different thread (see tpGeometryBuilder) */
+    memset(&renderCache->vao, 0, sizeof(renderCache->vao));
+    memset(&renderCache->textureVao, 0, sizeof(renderCache->textureVao));
+    renderCache->generation = 0;
+    renderCache->uploadedGeneration = -1;
+    renderCache->uploadedIndexType = GL_UNSIGNED_SHORT;
+    renderCache->dirtyVertices.count = 0;
+    renderCache->dirtyIndices.count = 0;
+    _tpGLRenderCacheMarkDirty(renderCache);
 
     ret.pointer = renderCache;
     return ret;
@@ -1686,12 +2788,30 @@ TARP_API tpRenderCache tpRenderCacheCreate()
 TARP_LOCAL void _tpGLRenderCacheClear(_tpGLRenderCache * _cache)
 {
     _tpGLRenderCacheContourArrayClear(&_cache->contours);
+    _tpGLIntArrayClear(&_cache->fillFirsts);
+    _tpGLSizeiArrayClear(&_cache->fillCounts);
+    _cache->bConvexFill = tpFalse;
+    _tpGLIntArrayClear(&_cache->fillCoverFirsts);
+    _tpGLSizeiArrayClear(&_cache->fillCoverCounts);
+    _tpGLIntArrayClear(&_cache->strokeCoverFirsts);
+    _tpGLSizeiArrayClear(&_cache->strokeCoverCounts);
+    _tpGLRectArrayClear(&_cache->contourBounds);
+    _cache->contourGridSize = 0;
+    _tpGLIntArrayClear(&_cache->contourGridCells);
+    _tpGLIntArrayClear(&_cache->contourGridItems);
+    _cache->fillTriangleOffset = 0;
+    _cache->fillTriangleCount = 0;
     _tpVec2ArrayClear(&_cache->geometryCache);
     _tpGLTextureVertexArrayClear(&_cache->textureGeometryCache);
     _tpBoolArrayClear(&_cache->jointCache);
+    _tpGLIndexArrayClear(&_cache->indexCache);
+    _tpGLShortIndexArrayClear(&_cache->shortIndexCache);
+    _tpVec2ArrayClear(&_cache->extrusionCache);
     _tpFloatArrayClear(&_cache->dashArrayStorage);
+    _tpGLRenderCacheMarkDirty(_cache);
     _cache->strokeVertexOffset = 0;
     _cache->strokeVertexCount = 0;
+    _cache->strokeIndexCount = 0;
     _cache->boundsVertexOffset = 0;
 }
 
@@ -1711,38 +2831,372 @@ TARP_LOCAL void _tpGLRenderCacheCopyTo(const _tpGLRenderCache * _from, _tpGLRend
 {
     _tpGLRenderCacheContourArrayClear(&_to->contours);
     _tpGLRenderCacheContourArrayAppendArray(&_to->contours, &_from->contours);
+    _tpGLIntArrayClear(&_to->fillFirsts);
+    _tpGLIntArrayAppendArray(&_to->fillFirsts, &_from->fillFirsts);
+    _tpGLSizeiArrayClear(&_to->fillCounts);
+    _tpGLSizeiArrayAppendArray(&_to->fillCounts, &_from->fillCounts);
+    _to->bConvexFill = _from->bConvexFill;
+    _tpGLIntArrayClear(&_to->fillCoverFirsts);
+    _tpGLIntArrayAppendArray(&_to->fillCoverFirsts, &_from->fillCoverFirsts);
+    _tpGLSizeiArrayClear(&_to->fillCoverCounts);
+    _tpGLSizeiArrayAppendArray(&_to->fillCoverCounts, &_from->fillCoverCounts);
+    _tpGLIntArrayClear(&_to->strokeCoverFirsts);
+    _tpGLIntArrayAppendArray(&_to->strokeCoverFirsts, &_from->strokeCoverFirsts);
+    _tpGLSizeiArrayClear(&_to->strokeCoverCounts);
+    _tpGLSizeiArrayAppendArray(&_to->strokeCoverCounts, &_from->strokeCoverCounts);
+    _tpGLRectArrayClear(&_to->contourBounds);
+    _tpGLRectArrayAppendArray(&_to->contourBounds, &_from->contourBounds);
+    _to->contourGridBounds = _from->contourGridBounds;
+    _to->contourGridSize = _from->contourGridSize;
+    _tpGLIntArrayClear(&_to->contourGridCells);
+    _tpGLIntArrayAppendArray(&_to->contourGridCells, &_from->contourGridCells);
+    _tpGLIntArrayClear(&_to->contourGridItems);
+    _tpGLIntArrayAppendArray(&_to->contourGridItems, &_from->contourGridItems);
+    _to->fillTriangleOffset = _from->fillTriangleOffset;
+    _to->fillTriangleCount = _from->fillTriangleCount;
     _tpVec2ArrayClear(&_to->geometryCache);
     _tpVec2ArrayAppendArray(&_to->geometryCache, &_from->geometryCache);
     _tpGLTextureVertexArrayClear(&_to->textureGeometryCache);
     _tpGLTextureVertexArrayAppendArray(&_to->textureGeometryCache, &_from->textureGeometryCache);
     _tpBoolArrayClear(&_to->jointCache);
     _tpBoolArrayAppendArray(&_to->jointCache, &_from->jointCache);
+    _tpGLIndexArrayClear(&_to->indexCache);
+    _tpGLIndexArrayAppendArray(&_to->indexCache, &_from->indexCache);
+    _tpGLShortIndexArrayClear(&_to->shortIndexCache);
+    _tpGLShortIndexArrayAppendArray(&_to->shortIndexCache, &_from->shortIndexCache);
+    _to->indexType = _from->indexType;
+    _tpVec2ArrayClear(&_to->extrusionCache);
+    _tpVec2ArrayAppendArray(&_to->extrusionCache, &_from->extrusionCache);
+    _to->bExtrudeStrokeOnGPU = _from->bExtrudeStrokeOnGPU;
+    _to->strokeHalfWidth = _from->strokeHalfWidth;
+    _to->roundSegmentCount = _from->roundSegmentCount;
     _to->boundsCache = _from->boundsCache;
     _to->strokeBoundsCache = _from->strokeBoundsCache;
     _to->fillGradientData.vertexOffset = _from->fillGradientData.vertexOffset;
     _to->fillGradientData.vertexCount = _from->fillGradientData.vertexCount;
     _to->strokeGradientData.vertexOffset = _from->strokeGradientData.vertexOffset;
     _to->strokeGradientData.vertexCount = _from->strokeGradientData.vertexCount;
-    _to->strokeVertexOffset = _from->strokeVertexCount;
+    _to->strokeVertexOffset = _from->strokeVertexOffset;
     _to->strokeVertexCount = _from->strokeVertexCount;
+    _to->strokeIndexCount = _from->strokeIndexCount;
     _to->boundsVertexOffset = _from->boundsVertexOffset;
     _to->renderMatrix = _from->renderMatrix;
+    _to->renderProjection = _from->renderProjection;
+    _to->renderTransform = _from->renderTransform;
+    _to->bIsLocalSpace = _from->bIsLocalSpace;
+    _to->strokeScale = _from->strokeScale;
     _tpGLRenderCacheCopyStyle(&_from->style, _to);
+    _tpGLRenderCacheMarkDirty(_to);
 }
 
 TARP_LOCAL void _tpGLRenderCacheDestroyImpl(_tpGLRenderCache * _cache)
 {
     if (_cache)
     {
+        if (_cache->vao.vao)
+        {
+            glDeleteBuffers(1, &_cache->vao.vbo);
+            glDeleteBuffers(1, &_cache->vao.ebo);
+            glDeleteBuffers(1, &_cache->vao.extrusionVbo);
+            glDeleteVertexArrays(1, &_cache->vao.vao);
+            glDeleteBuffers(1, &_cache->textureVao.vbo);
+            glDeleteVertexArrays(1, &_cache->textureVao.vao);
+        }
         _tpBoolArrayDeallocate(&_cache->jointCache);
+        _tpGLIndexArrayDeallocate(&_cache->indexCache);
+        _tpGLShortIndexArrayDeallocate(&_cache->shortIndexCache);
+        _tpVec2ArrayDeallocate(&_cache->extrusionCache);
         _tpGLTextureVertexArrayDeallocate(&_cache->textureGeometryCache);
         _tpVec2ArrayDeallocate(&_cache->geometryCache);
         _tpGLRenderCacheContourArrayDeallocate(&_cache->contours);
+        _tpGLIntArrayDeallocate(&_cache->fillFirsts);
+        _tpGLSizeiArrayDeallocate(&_cache->fillCounts);
+        _tpGLIntArrayDeallocate(&_cache->fillCoverFirsts);
+        _tpGLSizeiArrayDeallocate(&_cache->fillCoverCounts);
+        _tpGLIntArrayDeallocate(&_cache->strokeCoverFirsts);
+        _tpGLSizeiArrayDeallocate(&_cache->strokeCoverCounts);
+        _tpGLRectArrayDeallocate(&_cache->contourBounds);
+        _tpGLIntArrayDeallocate(&_cache->contourGridCells);
+        _tpGLIntArrayDeallocate(&_cache->contourGridItems);
         _tpFloatArrayDeallocate(&_cache->dashArrayStorage);
         TARP_FREE(_cache);
     }
 }
 
+TARP_LOCAL void _tpGLGeometryBuilderInit(_tpGLGeometryBuilder * _builder)
+{
+    int i;
+
+    _builder->flatteningMode = kTpFlatteningModeForwardDifferencing;
+    _builder->flatteningTolerance = 0.15f;
+    _builder->strokeExtrusionMode = kTpStrokeExtrusionModeCPU;
+    _builder->fillMode = kTpFillModeStencil;
+    _builder->viewport[0] = _builder->viewport[1] = 0;
+    _builder->viewport[2] = _builder->viewport[3] = 1;
+    _builder->transform = tpTransformMakeIdentity();
+    _builder->projection = tpMat4MakeIdentity();
+    _builder->transformProjection = tpMat4MakeIdentity();
+    _builder->transformScale = 1.0;
+    _builder->projectionScale = 1.0;
+    _builder->jobSystem.userData = NULL;
+    _builder->jobSystem.submit = NULL;
+    _builder->jobSystem.wait = NULL;
+
+    for (i = 0; i < TARP_GL_MAX_GEOMETRY_JOBS; ++i)
+    {
+        _tpVec2ArrayInit(&_builder->geometryJobs[i].vertices, 64);
+        _tpBoolArrayInit(&_builder->geometryJobs[i].joints, 64);
+        _tpVec2ArrayInit(&_builder->geometryJobs[i].extrusions, 64);
+        _tpGLIndexArrayInit(&_builder->geometryJobs[i].indices, 64);
+        _tpGLRenderCacheContourArrayInit(&_builder->geometryJobs[i].contours, 16);
+    }
+
+    _tpVec2ArrayInit(&_builder->tmpVertices, 512);
+    _tpBoolArrayInit(&_builder->tmpJoints, 256);
+    _tpGLIndexArrayInit(&_builder->tmpIndices, 512);
+    _tpVec2ArrayInit(&_builder->tmpExtrusions, 64);
+    _tpGLTextureVertexArrayInit(&_builder->tmpTexVertices, 64);
+    _tpColorStopArrayInit(&_builder->tmpColorStops, 16);
+    _tpGLRenderCacheContourArrayInit(&_builder->tmpRcContours, 16);
+    _tpGLSweepEdgeArrayInit(&_builder->sweepEdges, 16);
+    _tpFloatArrayInit(&_builder->sweepYs, 16);
+    _tpGLIntArrayInit(&_builder->sweepActive, 16);
+    _tpFloatArrayInit(&_builder->sweepXs, 16);
+    _tpGLSweepSpanArrayInit(&_builder->sweepSpans, 16);
+    _tpGLSweepSpanArrayInit(&_builder->sweepNextSpans, 16);
+}
+
+TARP_LOCAL void _tpGLGeometryBuilderDeallocate(_tpGLGeometryBuilder * _builder)
+{
+    int i;
+
+    for (i = 0; i < TARP_GL_MAX_GEOMETRY_JOBS; ++i)
+    {
+        _tpVec2ArrayDeallocate(&_builder->geometryJobs[i].vertices);
+        _tpBoolArrayDeallocate(&_builder->geometryJobs[i].joints);
+        _tpVec2ArrayDeallocate(&_builder->geometryJobs[i].extrusions);
+        _tpGLIndexArrayDeallocate(&_builder->geometryJobs[i].indices);
+        _tpGLRenderCacheContourArrayDeallocate(&_builder->geometryJobs[i].contours);
+    }
+
+    _tpBoolArrayDeallocate(&_builder->tmpJoints);
+    _tpGLIndexArrayDeallocate(&_builder->tmpIndices);
+    _tpVec2ArrayDeallocate(&_builder->tmpExtrusions);
+    _tpVec2ArrayDeallocate(&_builder->tmpVertices);
+    _tpGLTextureVertexArrayDeallocate(&_builder->tmpTexVertices);
+    _tpColorStopArrayDeallocate(&_builder->tmpColorStops);
+    _tpGLRenderCacheContourArrayDeallocate(&_builder->tmpRcContours);
+    _tpGLSweepEdgeArrayDeallocate(&_builder->sweepEdges);
+    _tpFloatArrayDeallocate(&_builder->sweepYs);
+    _tpGLIntArrayDeallocate(&_builder->sweepActive);
+    _tpFloatArrayDeallocate(&_builder->sweepXs);
+    _tpGLSweepSpanArrayDeallocate(&_builder->sweepSpans);
+    _tpGLSweepSpanArrayDeallocate(&_builder->sweepNextSpans);
+}
+
+/* checks if the buffer of the ring buffer can be persistently mapped */
+TARP_LOCAL tpBool _tpGLStreamSupportsPersistentMapping()
+{
+#ifdef GL_MAP_PERSISTENT_BIT
+    GLint i, major, minor, count;
+    const char * ext;
+
+    major = minor = count = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major > 4 || (major == 4 && minor >= 4))
+        return tpTrue;
+
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (i = 0; i < count; ++i)
+    {
+        ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && strcmp(ext, "GL_ARB_buffer_storage") == 0)
+            return tpTrue;
+    }
+#endif
+    return tpFalse;
+}
+
+/*
+(re)allocates the buffer of the ring buffer with sections of _sectionSize bytes and leaves it bound
+to GL_ARRAY_BUFFER. A buffer that is replaced stays alive until the gpu is done with it.
+*/
+TARP_LOCAL void _tpGLStreamBufferAllocate(_tpGLStreamBuffer * _stream, GLsizeiptr _sectionSize)
+{
+    int i;
+    GLsizeiptr size = _sectionSize * TARP_GL_STREAM_FRAME_COUNT;
+
+    for (i = 0; i < TARP_GL_STREAM_FRAME_COUNT; ++i)
+    {
+        if (_stream->fences[i])
+            glDeleteSync(_stream->fences[i]);
+        _stream->fences[i] = 0;
+    }
+    if (_stream->buffer)
+        _TARP_ASSERT_NO_GL_ERROR(glDeleteBuffers(1, &_stream->buffer));
+
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_stream->buffer));
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _stream->buffer));
+    _stream->sectionSize = _sectionSize;
+    _stream->mapped = NULL;
+
+#ifdef GL_MAP_PERSISTENT_BIT
+    if (_stream->bPersistent)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glBufferStorage(GL_ARRAY_BUFFER,
+                                                 size,
+                                                 NULL,
+                                                 GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                                                     GL_MAP_COHERENT_BIT));
+        _stream->mapped = (char *)glMapBufferRange(GL_ARRAY_BUFFER,
+                                                   0,
+                                                   size,
+                                                   GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                                                       GL_MAP_COHERENT_BIT);
+        if (!_stream->mapped)
+        {
+            /* the storage of the buffer is immutable, so fall back to a new one */
+            _stream->bPersistent = tpFalse;
+            _TARP_ASSERT_NO_GL_ERROR(glDeleteBuffers(1, &_stream->buffer));
+            _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_stream->buffer));
+            _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _stream->buffer));
+        }
+    }
+#endif
+
+    if (!_stream->mapped)
+        _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW));
+
+    /* the element buffer binding is part of the vao state */
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_stream->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _stream->buffer));
+
+    /* start writing at the beginning of the new buffer */
+    _stream->section = 0;
+    _stream->head = 0;
+    _stream->end = _stream->mapped ? _sectionSize : size;
+}
+
+TARP_LOCAL void _tpGLStreamBufferInit(_tpGLStreamBuffer * _stream)
+{
+    int i;
+
+    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &_stream->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_stream->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
+    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &_stream->textureVao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_stream->textureVao));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+
+    _stream->buffer = 0;
+    for (i = 0; i < TARP_GL_STREAM_FRAME_COUNT; ++i)
+        _stream->fences[i] = 0;
+    _stream->bPersistent = _tpGLStreamSupportsPersistentMapping();
+    _tpGLStreamBufferAllocate(_stream, TARP_GL_STREAM_SECTION_SIZE);
+}
+
+TARP_LOCAL void _tpGLStreamBufferDeallocate(_tpGLStreamBuffer * _stream)
+{
+    int i;
+
+    if (!_stream->vao)
+        return;
+
+    for (i = 0; i < TARP_GL_STREAM_FRAME_COUNT; ++i)
+    {
+        if (_stream->fences[i])
+            glDeleteSync(_stream->fences[i]);
+    }
+    /* deleting the buffer also unmaps it */
+    glDeleteBuffers(1, &_stream->buffer);
+    glDeleteVertexArrays(1, &_stream->vao);
+    glDeleteVertexArrays(1, &_stream->textureVao);
+    _stream->vao = 0;
+}
+
+/* moves on to the section of the next frame, waiting for the gpu if it still reads from it */
+TARP_LOCAL void _tpGLStreamBufferBeginFrame(_tpGLStreamBuffer * _stream)
+{
+    GLsync fence;
+
+    if (!_stream->mapped)
+        return;
+
+    _stream->section = (_stream->section + 1) % TARP_GL_STREAM_FRAME_COUNT;
+    fence = _stream->fences[_stream->section];
+    if (fence)
+    {
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) ==
+               GL_TIMEOUT_EXPIRED)
+            ;
+        glDeleteSync(fence);
+        _stream->fences[_stream->section] = 0;
+    }
+    _stream->head = _stream->section * _stream->sectionSize;
+    _stream->end = _stream->head + _stream->sectionSize;
+}
+
+TARP_LOCAL void _tpGLStreamBufferEndFrame(_tpGLStreamBuffer * _stream)
+{
+    if (!_stream->mapped)
+        return;
+
+    /* the buffer might have been reallocated during the frame */
+    if (_stream->fences[_stream->section])
+        glDeleteSync(_stream->fences[_stream->section]);
+    _stream->fences[_stream->section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+TARP_LOCAL void _tpGLDrawBatchInit(_tpGLDrawBatch * _batch)
+{
+    /* the attribute pointers are set when the batch is drawn, see _tpGLDrawBatchFlush */
+    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &_batch->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_batch->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(2));
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_batch->vbo));
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_batch->dataBuffer));
+    _TARP_ASSERT_NO_GL_ERROR(glGenTextures(1, &_batch->dataTexture));
+
+    _tpVec2ArrayInit(&_batch->vertices, 1024);
+    _tpVec2ArrayInit(&_batch->extrusions, 1024);
+    _tpFloatArrayInit(&_batch->drawIndices, 1024);
+    _tpGLIndexArrayInit(&_batch->indices, 1024);
+    _tpFloatArrayInit(&_batch->drawData, 64 * _kTpGLBatchTexelsPerDraw * 4);
+    _tpGLIntArrayInit(&_batch->fillFirsts, 64);
+    _tpGLSizeiArrayInit(&_batch->fillCounts, 64);
+    _tpGLIntArrayInit(&_batch->fillCoverFirsts, 64);
+    _tpGLSizeiArrayInit(&_batch->fillCoverCounts, 64);
+    _tpGLRectArrayInit(&_batch->deviceBounds, 64);
+    _batch->fillRule = kTpFillRuleEvenOdd;
+    _batch->drawCount = 0;
+}
+
+TARP_LOCAL void _tpGLDrawBatchDeallocate(_tpGLDrawBatch * _batch)
+{
+    if (!_batch->vao)
+        return;
+
+    glDeleteBuffers(1, &_batch->vbo);
+    glDeleteBuffers(1, &_batch->dataBuffer);
+    glDeleteTextures(1, &_batch->dataTexture);
+    glDeleteVertexArrays(1, &_batch->vao);
+    _tpVec2ArrayDeallocate(&_batch->vertices);
+    _tpVec2ArrayDeallocate(&_batch->extrusions);
+    _tpFloatArrayDeallocate(&_batch->drawIndices);
+    _tpGLIndexArrayDeallocate(&_batch->indices);
+    _tpFloatArrayDeallocate(&_batch->drawData);
+    _tpGLIntArrayDeallocate(&_batch->fillFirsts);
+    _tpGLSizeiArrayDeallocate(&_batch->fillCounts);
+    _tpGLIntArrayDeallocate(&_batch->fillCoverFirsts);
+    _tpGLSizeiArrayDeallocate(&_batch->fillCoverCounts);
+    _tpGLRectArrayDeallocate(&_batch->deviceBounds);
+    _batch->vao = 0;
+}
+
 TARP_API tpContext tpContextCreate()
 {
     _ErrorMessage msg;
@@ -1770,52 +3224,83 @@ TARP_API tpContext tpContextCreate()
 
     ctx->tpLoc = glGetUniformLocation(ctx->program, "transformProjection");
     ctx->meshColorLoc = glGetUniformLocation(ctx->program, "meshColor");
+    ctx->strokeHalfWidthLoc = glGetUniformLocation(ctx->program, "strokeHalfWidth");
 
     ctx->opacityTextureLoc = glGetUniformLocation(ctx->textureProgram, "meshOpacity");
     ctx->tpTextureLoc = glGetUniformLocation(ctx->textureProgram, "transformProjection");
 
-    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &ctx->vao.vao));
-    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(ctx->vao.vao));
-    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &ctx->vao.vbo));
-    ctx->vao.vboSize = 0;
-    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, ctx->vao.vbo));
-    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
-    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
+    err = _createProgram(
+        _vertexShaderCodeBatch, _fragmentShaderCodeBatch, 0, &ctx->batchProgram, &msg);
+    if (err)
+    {
+        _tpGLSetErrorMessage(msg.message);
+        return ret;
+    }
+    ctx->drawDataLoc = glGetUniformLocation(ctx->batchProgram, "drawData");
+    ctx->colorSlotLoc = glGetUniformLocation(ctx->batchProgram, "colorSlot");
 
-    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &ctx->textureVao.vao));
-    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(ctx->textureVao.vao));
-    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &ctx->textureVao.vbo));
-    ctx->textureVao.vboSize = 0;
-    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, ctx->textureVao.vbo));
-    _TARP_ASSERT_NO_GL_ERROR(
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)0)));
-    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
-    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(
-        1, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)(2 * sizeof(float)))));
-    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+    err = _createProgram(
+        _vertexShaderCodeInstanced, _fragmentShaderCodeBatch, 0, &ctx->instanceProgram, &msg);
+    if (err)
+    {
+        _tpGLSetErrorMessage(msg.message);
+        return ret;
+    }
+    ctx->instanceProjectionLoc = glGetUniformLocation(ctx->instanceProgram, "projection");
+    ctx->instanceRenderTransformLoc = glGetUniformLocation(ctx->instanceProgram, "renderTransform");
+    ctx->instanceStrokeHalfWidthLoc = glGetUniformLocation(ctx->instanceProgram, "strokeHalfWidth");
+    ctx->instanceColorSlotLoc = glGetUniformLocation(ctx->instanceProgram, "colorSlot");
 
-    for (i = 0; i < TARP_GL_MAX_CLIPPING_STACK_DEPTH; ++i)
+    for (i = 0; i < _kTpGLMaxClippingDepth; ++i)
     {
-        ctx->clippingRenderCaches[i] = (_tpGLRenderCache *)tpRenderCacheCreate().pointer;
+        ctx->clippingRenderCaches[i] = NULL;
     }
 
     ctx->clippingStackDepth = 0;
-    ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
-    ctx->bCanSwapStencilPlanes = tpTrue;
+    _tpGLClipArrayInit(&ctx->clips, 8);
+    _tpVec2ArrayInit(&ctx->clipMaskKey.vertices, 64);
+    _tpGLSizeiArrayInit(&ctx->clipMaskKey.fillCounts, 4);
+    ctx->bHasRetainedClipMask = tpFalse;
+    ctx->bRetainClippingMasks = tpFalse;
+    ctx->bScissorTest = GL_FALSE;
+    memset(ctx->scissorBox, 0, sizeof(ctx->scissorBox));
+    ctx->clipBounds.min = tpVec2Make(-1.0f, -1.0f);
+    ctx->clipBounds.max = tpVec2Make(1.0f, 1.0f);
     ctx->transform = tpTransformMakeIdentity();
     ctx->renderTransform = tpMat4MakeIdentity();
     ctx->transformScale = 1.0;
+    ctx->projectionScale = 1.0;
     ctx->transformID = 0;
     ctx->projection = tpMat4MakeIdentity();
     ctx->projectionID = 0;
-    ctx->bTransformProjDirty = tpFalse;
+    ctx->bTransformProjDirty = tpTrue;
     ctx->transformProjection = tpMat4MakeIdentity();
-
-    _tpVec2ArrayInit(&ctx->tmpVertices, 512);
-    _tpBoolArrayInit(&ctx->tmpJoints, 256);
-    _tpGLTextureVertexArrayInit(&ctx->tmpTexVertices, 64);
-    _tpColorStopArrayInit(&ctx->tmpColorStops, 16);
-    _tpGLRenderCacheContourArrayInit(&ctx->tmpRcContours, 16);
+    glGetIntegerv(GL_VIEWPORT, ctx->viewport);
+    _tpGLGeometryBuilderInit(&ctx->builder);
+    ctx->geometrySettingsID = 0;
+    ctx->threadPool = NULL;
+    ctx->uploadMode = kTpGeometryUploadModeRetained;
+    ctx->requestedUploadMode = kTpGeometryUploadModeRetained;
+    ctx->stream.vao = 0;
+    ctx->drawVao = 0;
+    ctx->drawTextureVao = 0;
+    ctx->drawIndexOffset = 0;
+    ctx->bBatchDraws = tpFalse;
+    ctx->batch.vao = 0;
+    ctx->batch.drawCount = 0;
+    ctx->instanceVbo = 0;
+    _tpFloatArrayInit(&ctx->instanceData, 64);
+    _tpGLIntArrayInit(&ctx->instanceRuns, 4);
+    _tpGLRectArrayInit(&ctx->instanceRunBounds, 4);
+    memset(ctx->instanceGrid, 0, sizeof(ctx->instanceGrid));
+    ctx->instanceRunStamp = 0;
+    ctx->bCullContours = tpFalse;
+    _tpGLIntArrayInit(&ctx->visibleFillFirsts, 64);
+    _tpGLSizeiArrayInit(&ctx->visibleFillCounts, 64);
+    _tpGLSizeiArrayInit(&ctx->visibleStrokeCounts, 64);
+    _tpGLBufferOffsetArrayInit(&ctx->visibleStrokeOffsets, 64);
+    _tpGLIntArrayInit(&ctx->contourStamps, 64);
+    ctx->contourStamp = 0;
 
     ctx->clippingStyle = tpStyleMake();
     ctx->clippingStyle.stroke.type = kTpPaintTypeNone;
@@ -1831,22 +3316,37 @@ TARP_API void tpContextDestroy(tpContext _ctx)
 
     /* free all opengl resources */
     glDeleteProgram(ctx->program);
-    glDeleteBuffers(1, &ctx->vao.vbo);
-    glDeleteVertexArrays(1, &ctx->vao.vao);
     glDeleteProgram(ctx->textureProgram);
-    glDeleteBuffers(1, &ctx->textureVao.vbo);
-    glDeleteVertexArrays(1, &ctx->textureVao.vao);
+    glDeleteProgram(ctx->batchProgram);
+    glDeleteProgram(ctx->instanceProgram);
+    if (ctx->instanceVbo)
+        glDeleteBuffers(1, &ctx->instanceVbo);
+    _tpFloatArrayDeallocate(&ctx->instanceData);
+    _tpGLIntArrayDeallocate(&ctx->instanceRuns);
+    _tpGLRectArrayDeallocate(&ctx->instanceRunBounds);
+    _tpGLIntArrayDeallocate(&ctx->visibleFillFirsts);
+    _tpGLSizeiArrayDeallocate(&ctx->visibleFillCounts);
+    _tpGLSizeiArrayDeallocate(&ctx->visibleStrokeCounts);
+    _tpGLBufferOffsetArrayDeallocate(&ctx->visibleStrokeOffsets);
+    _tpGLIntArrayDeallocate(&ctx->contourStamps);
+
+#if defined(TARP_THREADS_PTHREAD) || defined(TARP_THREADS_WIN32)
+    if (ctx->threadPool)
+        _tpGLThreadPoolDestroy(ctx->threadPool);
+#endif
 
-    _tpBoolArrayDeallocate(&ctx->tmpJoints);
-    _tpVec2ArrayDeallocate(&ctx->tmpVertices);
-    _tpGLTextureVertexArrayDeallocate(&ctx->tmpTexVertices);
-    _tpColorStopArrayDeallocate(&ctx->tmpColorStops);
-    _tpGLRenderCacheContourArrayDeallocate(&ctx->tmpRcContours);
+    _tpGLGeometryBuilderDeallocate(&ctx->builder);
+    _tpGLStreamBufferDeallocate(&ctx->stream);
+    _tpGLDrawBatchDeallocate(&ctx->batch);
 
-    for (i = 0; i < TARP_GL_MAX_CLIPPING_STACK_DEPTH; ++i)
+    for (i = 0; i < _kTpGLMaxClippingDepth; ++i)
     {
-        _tpGLRenderCacheDestroyImpl(ctx->clippingRenderCaches[i]);
+        if (ctx->clippingRenderCaches[i])
+            _tpGLRenderCacheDestroyImpl(ctx->clippingRenderCaches[i]);
     }
+    _tpGLClipArrayDeallocate(&ctx->clips);
+    _tpVec2ArrayDeallocate(&ctx->clipMaskKey.vertices);
+    _tpGLSizeiArrayDeallocate(&ctx->clipMaskKey.fillCounts);
 
     TARP_FREE(ctx);
 }
@@ -1859,11 +3359,92 @@ TARP_API void tpRenderCacheDestroy(tpRenderCache _cache)
 TARP_LOCAL _tpGLRenderCache * _tpGLPathEnsureRenderCache(_tpGLPath * _path)
 {
     if (!_path->renderCache)
+    {
         _path->renderCache = (_tpGLRenderCache *)tpRenderCacheCreate().pointer;
+        _path->lodCaches[0] = _path->renderCache;
+        _path->lodBands[0] = _kTpGLInvalidLodBand;
+        _path->lodCacheCount = 1;
+        _path->lodIndex = 0;
+    }
 
     return _path->renderCache;
 }
 
+/*
+Flattened geometry is cached in discrete scale bands at powers of sqrt(2) so that zooming does not
+reflatten the path on every frame. Returns the band that the device scale _scale falls into.
+*/
+TARP_LOCAL int _tpGLLodBand(tpFloat _scale)
+{
+    int band = (int)floor(log(TARP_MAX(_scale, FLT_MIN)) * 2.0 / log(2.0));
+    return TARP_CLAMP(band, _kTpGLMinLodBand, _kTpGLMaxLodBand);
+}
+
+/* the largest scale of a band, which is what the geometry of the band gets flattened for */
+TARP_LOCAL tpFloat _tpGLLodBandScale(int _band)
+{
+    return pow(2.0, (_band + 1) * 0.5);
+}
+
+/* the geometry cached for the other bands is stale, i.e. because the path changed */
+TARP_LOCAL void _tpGLPathInvalidateLodCaches(_tpGLPath * _path)
+{
+    int i;
+    for (i = 0; i < _path->lodCacheCount; ++i)
+    {
+        if (i != _path->lodIndex)
+            _path->lodBands[i] = _kTpGLInvalidLodBand;
+    }
+}
+
+/*
+Makes the render cache of _band the current render cache of the path. Returns tpTrue if the band
+was not cached, in which case a new render cache (or the one of the band furthest away from _band
+if TARP_GL_MAX_LOD_BANDS is reached) is used and needs to be rebuilt.
+*/
+TARP_LOCAL tpBool _tpGLPathSelectLodCache(_tpGLPath * _path, int _band)
+{
+    int i, dist, maxDist;
+    _tpGLRenderCache * last = _path->renderCache;
+
+    for (i = 0; i < _path->lodCacheCount; ++i)
+    {
+        if (_path->lodBands[i] == _band)
+        {
+            _path->lodIndex = i;
+            _path->renderCache = _path->lodCaches[i];
+            return tpFalse;
+        }
+    }
+
+    if (_path->lodCacheCount < TARP_GL_MAX_LOD_BANDS)
+    {
+        _path->lodIndex = _path->lodCacheCount++;
+        _path->lodCaches[_path->lodIndex] = (_tpGLRenderCache *)tpRenderCacheCreate().pointer;
+        /* initialize the style so it can be compared against */
+        _tpGLRenderCacheCopyStyle(&last->style, _path->lodCaches[_path->lodIndex]);
+    }
+    else
+    {
+        maxDist = -1;
+        for (i = 0; i < _path->lodCacheCount; ++i)
+        {
+            dist = _path->lodBands[i] == _kTpGLInvalidLodBand
+                       ? _kTpGLMaxLodBand - _kTpGLMinLodBand + 1
+                       : abs(_path->lodBands[i] - _band);
+            if (i != _path->lodIndex && dist > maxDist)
+            {
+                maxDist = dist;
+                _path->lodIndex = i;
+            }
+        }
+    }
+
+    _path->lodBands[_path->lodIndex] = _kTpGLInvalidLodBand;
+    _path->renderCache = _path->lodCaches[_path->lodIndex];
+    return tpTrue;
+}
+
 TARP_API tpPath tpPathCreate()
 {
     tpPath ret;
@@ -1873,11 +3454,12 @@ TARP_API tpPath tpPathCreate()
     path->currentContourIndex = -1;
 
     path->bPathGeometryDirty = tpTrue;
-    path->lastTransformScale = 1.0;
+    path->bSegmentBoundsDirty = tpTrue;
 
     path->lastDrawContext = NULL;
     path->lastTransformID = 0;
     path->lastProjectionID = 0;
+    path->lastGeometrySettingsID = 0;
 
     path->lastFillGradientID = -1;
     path->lastStrokeGradientID = -1;
@@ -1888,6 +3470,8 @@ TARP_API tpPath tpPathCreate()
     path->bStrokePaintTransformDirty = tpFalse;
 
     path->renderCache = NULL;
+    path->lodCacheCount = 0;
+    path->lodIndex = 0;
 
     ret.pointer = path;
     return ret;
@@ -1933,7 +3517,8 @@ TARP_API tpPath tpPathClone(tpPath _path)
     path->currentContourIndex = from->currentContourIndex;
 
     path->bPathGeometryDirty = from->bPathGeometryDirty;
-    path->lastTransformScale = from->lastTransformScale;
+    path->segmentBounds = from->segmentBounds;
+    path->bSegmentBoundsDirty = from->bSegmentBoundsDirty;
 
     path->fillPaintTransform = from->fillPaintTransform;
     path->strokePaintTransform = from->strokePaintTransform;
@@ -1943,6 +3528,7 @@ TARP_API tpPath tpPathClone(tpPath _path)
     path->lastDrawContext = from->lastDrawContext;
     path->lastTransformID = from->lastTransformID;
     path->lastProjectionID = from->lastProjectionID;
+    path->lastGeometrySettingsID = from->lastGeometrySettingsID;
 
     return ret;
 }
@@ -1958,7 +3544,8 @@ TARP_API void tpPathDestroy(tpPath _path)
             _tpSegmentArrayDeallocate(&_tpGLContourArrayAtPtr(&p->contours, i)->segments);
         }
         _tpGLContourArrayDeallocate(&p->contours);
-        _tpGLRenderCacheDestroyImpl(p->renderCache);
+        for (i = 0; i < p->lodCacheCount; ++i)
+            _tpGLRenderCacheDestroyImpl(p->lodCaches[i]);
 
         TARP_FREE(p);
     }
@@ -2013,6 +3600,7 @@ TARP_LOCAL tpBool _tpGLContourAddSegments(_tpGLPath * _p,
     _c->lastSegmentIndex = _c->segments.count - 1;
     _c->bDirty = tpTrue;
     _p->bPathGeometryDirty = tpTrue;
+    _p->bSegmentBoundsDirty = tpTrue;
 
     return tpFalse;
 }
@@ -2081,6 +3669,7 @@ TARP_API tpBool tpPathClear(tpPath _path)
     }
     _tpGLContourArrayClear(&p->contours);
     p->bPathGeometryDirty = tpTrue;
+    p->bSegmentBoundsDirty = tpTrue;
 
     return tpFalse;
 }
@@ -2134,6 +3723,7 @@ TARP_API tpBool tpPathClose(tpPath _path)
         c->bDirty = tpTrue;
         p->currentContourIndex = -1;
         p->bPathGeometryDirty = tpTrue;
+        p->bSegmentBoundsDirty = tpTrue;
     }
     else
     {
@@ -2151,6 +3741,7 @@ TARP_API tpBool tpPathRemoveContour(tpPath _path, int _index)
     _tpSegmentArrayDeallocate(&c->segments);
     _tpGLContourArrayRemove(&p->contours, _index);
     p->bPathGeometryDirty = tpTrue;
+    p->bSegmentBoundsDirty = tpTrue;
     p->currentContourIndex = p->contours.count - 1;
     return tpFalse;
 }
@@ -2161,6 +3752,7 @@ TARP_API tpBool tpPathRemoveSegment(tpPath _path, int _contourIndex, int _index)
     _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, _contourIndex);
     _tpSegmentArrayRemove(&c->segments, _index);
     p->bPathGeometryDirty = tpTrue;
+    p->bSegmentBoundsDirty = tpTrue;
     c->bDirty = tpTrue;
     return tpFalse;
 }
@@ -2171,6 +3763,7 @@ TARP_API tpBool tpPathRemoveSegments(tpPath _path, int _contourIndex, int _from,
     _tpGLContour * c = _tpGLContourArrayAtPtr(&p->contours, _contourIndex);
     _tpSegmentArrayRemoveRange(&c->segments, _from, _to);
     p->bPathGeometryDirty = tpTrue;
+    p->bSegmentBoundsDirty = tpTrue;
     c->bDirty = tpTrue;
     return tpFalse;
 }
@@ -2190,6 +3783,7 @@ TARP_LOCAL tpBool _tpGLPathAddSegmentsToCurrentContour(_tpGLPath * _p,
     _c->lastSegmentIndex = _c->segments.count - 1;
     _c->bDirty = tpTrue;
     _p->bPathGeometryDirty = tpTrue;
+    _p->bSegmentBoundsDirty = tpTrue;
     return tpFalse;
 }
 
@@ -2239,6 +3833,7 @@ TARP_API tpBool tpPathSetContour(
         c->bIsClosed = _bClosed;
         c->bDirty = tpTrue;
         p->bPathGeometryDirty = tpTrue;
+        p->bSegmentBoundsDirty = tpTrue;
         return tpFalse;
     }
     else
@@ -2373,6 +3968,7 @@ TARP_LOCAL _tpGLGradient * tpGradientCreate()
 
     _tpGLGradient * ret = (_tpGLGradient *)TARP_MALLOC(sizeof(_tpGLGradient));
     ret->bDirty = tpTrue;
+    ret->bRampDirty = tpFalse;
     /*
     @TODO: the static id and incrementing is not multi threadding friendly...no
     care for now thread local storage will most likely be the nicest way to
@@ -2577,63 +4173,130 @@ tpFloat _tpGLShortestAngle(tpVec2 _d0, tpVec2 _d1)
     return theta;
 }
 
-TARP_LOCAL void _tpGLPushTriangle(_tpVec2Array * _vertices, tpVec2 _a, tpVec2 _b, tpVec2 _c)
+/*
+appends a stroke vertex that is extruded from _center by _extrusion and returns its index. If the
+stroke is extruded on the gpu, only the center is added to the vertices (see tpStrokeExtrusionMode).
+*/
+TARP_LOCAL GLuint _tpGLPushStrokeVertex(_tpGLStrokeBuffers * _out,
+                                        tpVec2 _center,
+                                        tpVec2 _extrusion)
 {
-    _tpVec2ArrayAppendPtr(_vertices, &_a);
-    _tpVec2ArrayAppendPtr(_vertices, &_b);
-    _tpVec2ArrayAppendPtr(_vertices, &_c);
+    tpVec2 v;
+    v = _out->bExtrudeOnGPU ? _center : tpVec2Add(_center, _extrusion);
+    _tpVec2ArrayAppendPtr(_out->vertices, &v);
+    _tpVec2ArrayAppendPtr(_out->extrusions, &_extrusion);
+    return (GLuint)(_out->vertices->count - 1);
 }
 
-TARP_LOCAL void _tpGLPushQuad(_tpVec2Array * _vertices, tpVec2 _a, tpVec2 _b, tpVec2 _c, tpVec2 _d)
+TARP_LOCAL tpVec2 _tpGLStrokeExtrusionAt(_tpGLStrokeBuffers * _out, GLuint _index)
 {
-    _tpVec2ArrayAppendPtr(_vertices, &_a);
-    _tpVec2ArrayAppendPtr(_vertices, &_b);
-    _tpVec2ArrayAppendPtr(_vertices, &_c);
-    _tpVec2ArrayAppendPtr(_vertices, &_c);
-    _tpVec2ArrayAppendPtr(_vertices, &_d);
-    _tpVec2ArrayAppendPtr(_vertices, &_a);
+    return _tpVec2ArrayAt(_out->extrusions, (int)_index - _out->extrusionOffset);
 }
 
-TARP_LOCAL void _tpGLMakeCircleSector(
-    tpVec2 _center, tpVec2 _r0, tpVec2 _r1, tpFloat _levelOfDetail, _tpVec2Array * _outVertices)
+TARP_LOCAL void _tpGLPushTriangle(_tpGLIndexArray * _indices, GLuint _a, GLuint _b, GLuint _c)
 {
-    tpMat2 rot;
-    tpVec2 r, current, last;
+    GLuint * idx;
+    _tpGLIndexArrayReserveAdditional(_indices, 3);
+    idx = _indices->array + _indices->count;
+    idx[0] = _a;
+    idx[1] = _b;
+    idx[2] = _c;
+    _indices->count += 3;
+}
+
+TARP_LOCAL void
+_tpGLPushQuad(_tpGLIndexArray * _indices, GLuint _a, GLuint _b, GLuint _c, GLuint _d)
+{
+    GLuint * idx;
+    _tpGLIndexArrayReserveAdditional(_indices, 6);
+    idx = _indices->array + _indices->count;
+    idx[0] = _a;
+    idx[1] = _b;
+    idx[2] = _c;
+    idx[3] = _c;
+    idx[4] = _d;
+    idx[5] = _a;
+    _indices->count += 6;
+}
+
+/*
+the number of segments of a full circle with _radius (in device pixels), so that its tessellation
+deviates at most _tolerance pixels from the circle.
+*/
+TARP_LOCAL int _tpGLRoundSegmentCount(tpFloat _radius, tpFloat _tolerance)
+{
+    double count;
+    if (_tolerance >= _radius)
+        return 4;
+
+    /* the angle becomes 0 (and the count inf) once the ratio drops below the float precision, so
+     * clamp before converting to int. Also catches nan */
+    count = TARP_PI / acos(1.0f - _tolerance / _radius);
+    if (!(count < TARP_MAX_ROUND_SEGMENTS))
+        return TARP_MAX_ROUND_SEGMENTS;
+    return TARP_MAX((int)ceil(count), 4);
+}
+
+TARP_LOCAL void _tpGLRoundTableInit(_tpGLRoundTable * _table, int _count)
+{
+    int i;
     tpFloat stepSize;
+
+    assert(_count > 0 && _count <= TARP_MAX_ROUND_SEGMENTS);
+    stepSize = TARP_PI * 2.0f / (tpFloat)_count;
+    _table->count = _count;
+    for (i = 0; i < _count; ++i)
+    {
+        _table->rotations[i].x = cos(stepSize * (i + 1));
+        _table->rotations[i].y = sin(stepSize * (i + 1));
+    }
+}
+
+/*
+adds a fan of triangles around _center from the vertex at index _i0 to the vertex at index _i1,
+going counter clockwise. The end vertices are shared with the adjacent stroke geometry.
+*/
+TARP_LOCAL void _tpGLMakeCircleSector(tpVec2 _center,
+                                      GLuint _i0,
+                                      GLuint _i1,
+                                      const _tpGLRoundTable * _roundTable,
+                                      _tpGLStrokeBuffers * _out)
+{
+    const tpVec2 * rot;
+    tpVec2 r, r0, r1;
+    GLuint center, current, last;
     int i;
 
-    /* @TODO: The step size should depend on _levelOfDetail. */
-    stepSize = TARP_PI / 16;
-    rot = tpMat2MakeRotation(stepSize);
-    r = _r0;
-    last = tpVec2Add(_center, r);
-    /* @NOTE: Hardcoded the number of segments to prevent potential infinite loop due to numeric
-     * inaccuracies. Once the circle sector segment count is not hardcoded anymore, change it here,
-     * too!!
-     */
-    for (i = 0; i <= 16; ++i)
+    r0 = _tpGLStrokeExtrusionAt(_out, _i0);
+    r1 = _tpGLStrokeExtrusionAt(_out, _i1);
+    center = _tpGLPushStrokeVertex(_out, _center, tpVec2Make(0, 0));
+    last = _i0;
+    /* rotate r0 by the multiples of the step angle until we pass r1. Rotating r0 directly
+     * instead of the previous vector does not accumulate any error. */
+    for (i = 0; i < _roundTable->count; ++i)
     {
-        r = tpMat2MultVec2(&rot, r);
-        if (tpVec2Cross(r, _r1) < 0)
+        rot = &_roundTable->rotations[i];
+        r.x = r0.x * rot->x - r0.y * rot->y;
+        r.y = r0.x * rot->y + r0.y * rot->x;
+        if (tpVec2Cross(r, r1) < 0)
         {
             break;
         }
-        current = tpVec2Add(_center, r);
-        _tpGLPushTriangle(_outVertices, _center, last, current);
+        current = _tpGLPushStrokeVertex(_out, _center, r);
+        _tpGLPushTriangle(_out->indices, center, last, current);
         last = current;
     }
-    current = tpVec2Add(_center, _r1);
-    _tpGLPushTriangle(_outVertices, _center, last, current);
+    _tpGLPushTriangle(_out->indices, center, last, _i1);
 }
 
-TARP_LOCAL void _tpGLMakeJoinBevel(tpVec2 _lePrev,
-                                   tpVec2 _rePrev,
-                                   tpVec2 _le,
-                                   tpVec2 _re,
+TARP_LOCAL void _tpGLMakeJoinBevel(GLuint _lePrev,
+                                   GLuint _rePrev,
+                                   GLuint _le,
+                                   GLuint _re,
                                    tpFloat _cross,
-                                   _tpVec2Array * _outVertices)
+                                   _tpGLIndexArray * _indices)
 {
-    _tpGLPushTriangle(_outVertices, _lePrev, (_cross < 0) ? _le : _re, _rePrev);
+    _tpGLPushTriangle(_indices, _lePrev, (_cross < 0) ? _le : _re, _rePrev);
 }
 
 TARP_LOCAL tpBool
@@ -2657,55 +4320,57 @@ _tpGLIntersectLines(tpVec2 _p0, tpVec2 _d0, tpVec2 _p1, tpVec2 _d1, tpVec2 * _ou
 }
 
 TARP_LOCAL void _tpGLMakeJoinMiter(tpVec2 _p,
-                                   tpVec2 _e0,
-                                   tpVec2 _e1,
+                                   GLuint _e0,
+                                   GLuint _e1,
                                    tpVec2 _dir0,
                                    tpVec2 _dir1,
                                    tpFloat _cross,
-                                   _tpVec2Array * _outVertices)
+                                   _tpGLStrokeBuffers * _out)
 {
     tpVec2 intersection;
 
-    /* tpVec2 inv = tpVec2MultScalar(_dir1, -1); */
-    _tpGLIntersectLines(_e0, _dir0, _e1, _dir1, &intersection);
+    /* intersect the edges relative to _p, which gives the extrusion of the miter tip */
+    _tpGLIntersectLines(_tpGLStrokeExtrusionAt(_out, _e0),
+                        _dir0,
+                        _tpGLStrokeExtrusionAt(_out, _e1),
+                        _dir1,
+                        &intersection);
 
-    _tpGLPushQuad(_outVertices, _p, _e0, intersection, _e1);
+    _tpGLPushQuad(_out->indices,
+                  _tpGLPushStrokeVertex(_out, _p, tpVec2Make(0, 0)),
+                  _e0,
+                  _tpGLPushStrokeVertex(_out, _p, intersection),
+                  _e1);
 }
 
 TARP_LOCAL void _tpGLMakeJoin(tpStrokeJoin _type,
                               tpVec2 _p,
                               tpVec2 _dir0,
                               tpVec2 _dir1,
-                              tpVec2 _perp0,
-                              tpVec2 _perp1,
-                              tpVec2 _lePrev,
-                              tpVec2 _rePrev,
-                              tpVec2 _le,
-                              tpVec2 _re,
+                              GLuint _lePrev,
+                              GLuint _rePrev,
+                              GLuint _le,
+                              GLuint _re,
                               tpFloat _cross,
                               tpFloat _miterLimit,
-                              _tpVec2Array * _outVertices)
+                              const _tpGLRoundTable * _roundTable,
+                              _tpGLStrokeBuffers * _out)
 {
     tpVec2 nperp0, nperp1;
-    tpFloat miterLen, theta, levelOfDetail;
+    tpFloat miterLen, theta;
 
     switch (_type)
     {
     case kTpStrokeJoinRound:
-        levelOfDetail = 0; /* TODO: levelOfDetail should depend on the
-                              stroke width and the transform */
         if (_cross < 0.0f)
         {
-            _tpGLMakeCircleSector(_p, _perp0, _perp1, levelOfDetail, _outVertices);
+            _tpGLMakeCircleSector(_p, _lePrev, _le, _roundTable, _out);
         }
         else
         {
-            /* negate the perpendicular vectors and reorder function
-             * arguments */
-            tpVec2 flippedPerp0, flippedPerp1;
-            flippedPerp0 = tpVec2Make(-_perp0.x, -_perp0.y);
-            flippedPerp1 = tpVec2Make(-_perp1.x, -_perp1.y);
-            _tpGLMakeCircleSector(_p, flippedPerp1, flippedPerp0, levelOfDetail, _outVertices);
+            /* on the other side the sector goes from the right edge of the current segment to
+             * the right edge of the previous one */
+            _tpGLMakeCircleSector(_p, _re, _rePrev, _roundTable, _out);
         }
         break;
     case kTpStrokeJoinMiter:
@@ -2722,54 +4387,53 @@ TARP_LOCAL void _tpGLMakeJoin(tpStrokeJoin _type,
         {
             if (_cross < 0.0f)
             {
-                _tpGLMakeJoinMiter(_p, _lePrev, _le, _dir0, _dir1, _cross, _outVertices);
+                _tpGLMakeJoinMiter(_p, _lePrev, _le, _dir0, _dir1, _cross, _out);
             }
             else
             {
-                _tpGLMakeJoinMiter(_p, _rePrev, _re, _dir0, _dir1, _cross, _outVertices);
+                _tpGLMakeJoinMiter(_p, _rePrev, _re, _dir0, _dir1, _cross, _out);
             }
             break;
         }
     /* fall back to bevel */
     case kTpStrokeJoinBevel:
     default:
-        _tpGLMakeJoinBevel(_lePrev, _rePrev, _le, _re, _cross, _outVertices);
+        _tpGLMakeJoinBevel(_lePrev, _rePrev, _le, _re, _cross, _out->indices);
         break;
     }
 }
 
-TARP_LOCAL void _tpGLMakeCapSquare(
-    tpVec2 _p, tpVec2 _dir, tpVec2 _le, tpVec2 _re, _tpVec2Array * _outVertices)
+TARP_LOCAL void
+_tpGLMakeCapSquare(tpVec2 _p, tpVec2 _dir, GLuint _le, GLuint _re, _tpGLStrokeBuffers * _out)
 {
-    tpVec2 a, b;
-    a = tpVec2Add(_re, _dir);
-    b = tpVec2Add(_le, _dir);
+    GLuint a, b;
+    a = _tpGLPushStrokeVertex(_out, _p, tpVec2Add(_tpGLStrokeExtrusionAt(_out, _re), _dir));
+    b = _tpGLPushStrokeVertex(_out, _p, tpVec2Add(_tpGLStrokeExtrusionAt(_out, _le), _dir));
 
-    _tpGLPushQuad(_outVertices, _re, a, b, _le);
+    _tpGLPushQuad(_out->indices, _re, a, b, _le);
 }
 
 TARP_LOCAL void _tpGLMakeCap(tpStrokeCap _type,
                              tpVec2 _p,
                              tpVec2 _dir,
-                             tpVec2 _perp,
-                             tpVec2 _le,
-                             tpVec2 _re,
+                             GLuint _le,
+                             GLuint _re,
                              tpBool _bStart,
-                             _tpVec2Array * _outVertices)
+                             const _tpGLRoundTable * _roundTable,
+                             _tpGLStrokeBuffers * _out)
 {
-    tpFloat levelOfDetail;
-    tpVec2 flippedPerp;
     switch (_type)
     {
     case kTpStrokeCapRound:
-        /* TODO: levelOfDetail should depend on the stroke width and the
-         * transform */
-        levelOfDetail = 0;
-        flippedPerp = tpVec2Make(-_perp.x, -_perp.y);
-        _tpGLMakeCircleSector(_p, _perp, flippedPerp, levelOfDetail, _outVertices);
+        /* start caps go around the beginning of the segment from right to left, end caps around
+         * its end from left to right */
+        if (_bStart)
+            _tpGLMakeCircleSector(_p, _re, _le, _roundTable, _out);
+        else
+            _tpGLMakeCircleSector(_p, _le, _re, _roundTable, _out);
         break;
     case kTpStrokeCapSquare:
-        _tpGLMakeCapSquare(_p, _dir, _le, _re, _outVertices);
+        _tpGLMakeCapSquare(_p, _dir, _le, _re, _out);
         break;
     case kTpStrokeCapButt:
     default:
@@ -2779,23 +4443,26 @@ TARP_LOCAL void _tpGLMakeCap(tpStrokeCap _type,
 
 TARP_LOCAL void _tpGLRenderCacheContourContinuousStrokeGeometry(_tpGLRenderCacheContour * _contour,
                                                                 const tpStyle * _style,
-                                                                _tpVec2Array * _outVertices,
-                                                                _tpBoolArray * _outJoints)
+                                                                const _tpGLRoundTable * _roundTable,
+                                                                _tpBoolArray * _joints,
+                                                                _tpGLStrokeBuffers * _out)
 {
     int j, voff;
     tpVec2 p0, p1, dir, perp, dirPrev, perpPrev;
-    tpVec2 le0, le1, re0, re1, lePrev, rePrev;
-    tpVec2 firstDir, firstPerp, firstLe, firstRe;
+    tpVec2 firstDir, firstPerp;
+    GLuint le0, le1, re0, re1, lePrev, rePrev, firstLe, firstRe;
     tpFloat cross, halfSw;
 
-    voff = _outVertices->count;
+    voff = _out->vertices->count;
     halfSw = _style->strokeWidth * 0.5;
     _contour->strokeVertexOffset = voff;
+    _contour->strokeIndexOffset = _out->indices->count;
 
     /* @TODO: This needed? */
     if (_contour->fillVertexCount <= 1)
     {
         _contour->strokeVertexCount = 0;
+        _contour->strokeIndexCount = 0;
         return;
     }
 
@@ -2803,17 +4470,17 @@ TARP_LOCAL void _tpGLRenderCacheContourContinuousStrokeGeometry(_tpGLRenderCache
          j < _contour->fillVertexOffset + _contour->fillVertexCount - 1;
          ++j)
     {
-        p0 = _tpVec2ArrayAt(_outVertices, j);
-        p1 = _tpVec2ArrayAt(_outVertices, j + 1);
+        p0 = _tpVec2ArrayAt(_out->fillVertices, j);
+        p1 = _tpVec2ArrayAt(_out->fillVertices, j + 1);
         dir = tpVec2Sub(p1, p0);
         tpVec2NormalizeSelf(&dir);
         perp.x = dir.y * halfSw;
         perp.y = -dir.x * halfSw;
 
-        le0 = tpVec2Add(p0, perp);
-        re0 = tpVec2Sub(p0, perp);
-        le1 = tpVec2Add(p1, perp);
-        re1 = tpVec2Sub(p1, perp);
+        le0 = _tpGLPushStrokeVertex(_out, p0, perp);
+        re0 = _tpGLPushStrokeVertex(_out, p0, tpVec2MultScalar(perp, -1));
+        le1 = _tpGLPushStrokeVertex(_out, p1, perp);
+        re1 = _tpGLPushStrokeVertex(_out, p1, tpVec2MultScalar(perp, -1));
 
         /* check if this is the first segment / dash start */
         if (j == _contour->fillVertexOffset)
@@ -2822,10 +4489,14 @@ TARP_LOCAL void _tpGLRenderCacheContourContinuousStrokeGeometry(_tpGLRenderCache
             {
                 /* start cap? */
                 firstDir = tpVec2MultScalar(dir, -1 * halfSw);
-                firstPerp.x = firstDir.y;
-                firstPerp.y = -firstDir.x;
-                _tpGLMakeCap(
-                    _style->strokeCap, p0, firstDir, firstPerp, le0, re0, tpTrue, _outVertices);
+                _tpGLMakeCap(_style->strokeCap,
+                             p0,
+                             firstDir,
+                             le0,
+                             re0,
+                             tpTrue,
+                             _roundTable,
+                             _out);
             }
             else if (j == _contour->fillVertexOffset)
             {
@@ -2844,38 +4515,37 @@ TARP_LOCAL void _tpGLRenderCacheContourContinuousStrokeGeometry(_tpGLRenderCache
         {
             cross = tpVec2Cross(perp, perpPrev);
             /* check if this is a joint */
-            if (_tpBoolArrayAt(_outJoints, j))
+            if (_tpBoolArrayAt(_joints, j))
             {
                 _tpGLMakeJoin(_style->strokeJoin,
                               p0,
                               dirPrev,
                               dir,
-                              perpPrev,
-                              perp,
                               lePrev,
                               rePrev,
                               le0,
                               re0,
                               cross,
                               _style->miterLimit,
-                              _outVertices);
+                              _roundTable,
+                              _out);
             }
             else
             {
                 /* by default we join consecutive segment quads with a
                  * bevel */
-                _tpGLMakeJoinBevel(lePrev, rePrev, le0, re0, cross, _outVertices);
+                _tpGLMakeJoinBevel(lePrev, rePrev, le0, re0, cross, _out->indices);
             }
         }
 
         /* add the quad for the current segment */
-        _tpGLPushQuad(_outVertices, le1, le0, re0, re1);
+        _tpGLPushQuad(_out->indices, le1, le0, re0, re1);
 
         /* check if we need to do the end cap / join */
         if (j == _contour->fillVertexOffset + _contour->fillVertexCount - 2 ||
             _contour->fillVertexCount == 2)
         {
-            if (_tpBoolArrayAt(_outJoints, j + 1) && _contour->bIsClosed)
+            if (_tpBoolArrayAt(_joints, j + 1) && _contour->bIsClosed)
             {
                 /* last join */
                 cross = tpVec2Cross(firstPerp, perp);
@@ -2883,22 +4553,27 @@ TARP_LOCAL void _tpGLRenderCacheContourContinuousStrokeGeometry(_tpGLRenderCache
                               p1,
                               dir,
                               firstDir,
-                              perp,
-                              firstPerp,
                               le1,
                               re1,
                               firstLe,
                               firstRe,
                               cross,
                               _style->miterLimit,
-                              _outVertices);
+                              _roundTable,
+                              _out);
             }
             else
             {
                 /* end cap */
                 firstDir = tpVec2MultScalar(dir, halfSw);
-                _tpGLMakeCap(
-                    _style->strokeCap, p1, firstDir, perp, le1, re1, tpFalse, _outVertices);
+                _tpGLMakeCap(_style->strokeCap,
+                             p1,
+                             firstDir,
+                             le1,
+                             re1,
+                             tpFalse,
+                             _roundTable,
+                             _out);
             }
         }
 
@@ -2908,7 +4583,8 @@ TARP_LOCAL void _tpGLRenderCacheContourContinuousStrokeGeometry(_tpGLRenderCache
         rePrev = re1;
     }
 
-    _contour->strokeVertexCount = _outVertices->count - voff;
+    _contour->strokeVertexCount = _out->vertices->count - voff;
+    _contour->strokeIndexCount = _out->indices->count - _contour->strokeIndexOffset;
 }
 
 /* helper struct that encapsulates helper info about the start of the dash pattern */
@@ -2924,20 +4600,23 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
     _tpGLRenderCacheContour * _contour,
     const tpStyle * _style,
     const _tpGLDashStartState * _startDashState,
-    _tpVec2Array * _vertices,
-    _tpBoolArray * _joints)
+    const _tpGLRoundTable * _roundTable,
+    _tpBoolArray * _joints,
+    _tpGLStrokeBuffers * _out)
 {
     int j, dashIndex, voff;
     tpVec2 p0, p1, dir, perp, dirPrev, perpPrev;
-    tpVec2 le0, le1, re0, re1, lePrev, rePrev;
-    tpVec2 firstDir, firstPerp, firstLe, firstRe;
+    tpVec2 prevCenter;
+    tpVec2 firstDir, firstPerp;
+    GLuint le0, le1, re0, re1, lePrev, rePrev, firstLe, firstRe;
     tpVec2 dirr;
     tpFloat cross, halfSw, dashOffset, dashLen, segmentOff, segmentLen;
     tpBool bDashStart, bFirstDashMightNeedJoin, bLastSegment;
-    tpBool bOnDash, bBarelyJoined;
+    tpBool bOnDash, bBarelyJoined, bPrevEdgesPushed, bJoinEdgesPushed;
 
-    voff = _vertices->count;
+    voff = _out->vertices->count;
     _contour->strokeVertexOffset = voff;
+    _contour->strokeIndexOffset = _out->indices->count;
     dashIndex = _startDashState->startDashIndex;
     dashOffset = 0;
     dashLen = _startDashState->startDashLen;
@@ -2945,6 +4624,7 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
     bDashStart = tpTrue;
     bFirstDashMightNeedJoin = tpFalse;
     bBarelyJoined = tpFalse;
+    bPrevEdgesPushed = tpFalse;
     halfSw = _style->strokeWidth * 0.5f;
 
     for (j = _contour->fillVertexOffset;
@@ -2952,9 +4632,10 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
          ++j)
     {
         bLastSegment = (tpBool)(j == _contour->fillVertexOffset + _contour->fillVertexCount - 2);
+        bJoinEdgesPushed = tpFalse;
 
-        p0 = _tpVec2ArrayAt(_vertices, j);
-        p1 = _tpVec2ArrayAt(_vertices, j + 1);
+        p0 = _tpVec2ArrayAt(_out->fillVertices, j);
+        p1 = _tpVec2ArrayAt(_out->fillVertices, j + 1);
         dir = tpVec2Sub(p1, p0);
         segmentLen = tpVec2Length(dir);
         segmentOff = 0;
@@ -2968,21 +4649,28 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
         /* check if this is a joint */
         if (bOnDash && _tpBoolArrayAt(_joints, j))
         {
-            le0 = tpVec2Add(p0, perp);
-            re0 = tpVec2Sub(p0, perp);
+            /* the previous edges are only added if the previous dash was on */
+            if (!bPrevEdgesPushed)
+            {
+                lePrev = _tpGLPushStrokeVertex(_out, prevCenter, perpPrev);
+                rePrev = _tpGLPushStrokeVertex(_out, prevCenter, tpVec2MultScalar(perpPrev, -1));
+            }
+            /* the edges of the join are shared with the first dash of the segment */
+            le0 = _tpGLPushStrokeVertex(_out, p0, perp);
+            re0 = _tpGLPushStrokeVertex(_out, p0, tpVec2MultScalar(perp, -1));
+            bJoinEdgesPushed = tpTrue;
             _tpGLMakeJoin(_style->strokeJoin,
                           p0,
                           dirPrev,
                           dir,
-                          perpPrev,
-                          perp,
                           lePrev,
                           rePrev,
                           le0,
                           re0,
                           cross,
                           _style->miterLimit,
-                          _vertices);
+                          _roundTable,
+                          _out);
         }
 
         do
@@ -2991,10 +4679,19 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
             dirr = tpVec2MultScalar(dir, left);
             p1 = tpVec2Add(p0, dirr);
 
-            le0 = tpVec2Add(p0, perp);
-            re0 = tpVec2Sub(p0, perp);
-            le1 = tpVec2Add(p1, perp);
-            re1 = tpVec2Sub(p1, perp);
+            /* only add the vertices of dashes that are on */
+            if (bOnDash)
+            {
+                if (!bJoinEdgesPushed)
+                {
+                    le0 = _tpGLPushStrokeVertex(_out, p0, perp);
+                    re0 = _tpGLPushStrokeVertex(_out, p0, tpVec2MultScalar(perp, -1));
+                }
+                le1 = _tpGLPushStrokeVertex(_out, p1, perp);
+                re1 = _tpGLPushStrokeVertex(_out, p1, tpVec2MultScalar(perp, -1));
+            }
+            bJoinEdgesPushed = tpFalse;
+            bPrevEdgesPushed = bOnDash;
 
             if (bDashStart && bOnDash)
             {
@@ -3007,12 +4704,16 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
                 */
                 if (!_contour->bIsClosed || j != _contour->fillVertexOffset || segmentOff > 0)
                 {
-                    tpVec2 tmpDir, tmpPerp;
+                    tpVec2 tmpDir;
                     tmpDir = tpVec2MultScalar(dir, -1 * halfSw);
-                    tmpPerp.x = tmpDir.y;
-                    tmpPerp.y = -tmpDir.x;
-                    _tpGLMakeCap(
-                        _style->strokeCap, p0, tmpDir, tmpPerp, le0, re0, tpTrue, _vertices);
+                    _tpGLMakeCap(_style->strokeCap,
+                                 p0,
+                                 tmpDir,
+                                 le0,
+                                 re0,
+                                 tpTrue,
+                                 _roundTable,
+                                 _out);
                 }
                 /*
                 ...otherwise cache the initial values for the cap
@@ -3031,14 +4732,14 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
             }
             else if (!bDashStart && bOnDash)
             {
-                _tpGLMakeJoinBevel(lePrev, rePrev, le0, re0, cross, _vertices);
+                _tpGLMakeJoinBevel(lePrev, rePrev, le0, re0, cross, _out->indices);
             }
 
             if (bOnDash)
             {
                 /* add the quad for the current dash on the current
                  * segment */
-                _tpGLPushQuad(_vertices, le1, le0, re0, re1);
+                _tpGLPushQuad(_out->indices, le1, le0, re0, re1);
             }
 
             dashOffset += left;
@@ -3054,8 +4755,14 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
                      */
                     if (!bFirstDashMightNeedJoin || !bLastSegment || segmentLen - segmentOff > 0)
                     {
-                        _tpGLMakeCap(
-                            _style->strokeCap, p1, dir, perp, le1, re1, tpFalse, _vertices);
+                        _tpGLMakeCap(_style->strokeCap,
+                                     p1,
+                                     dir,
+                                     le1,
+                                     re1,
+                                     tpFalse,
+                                     _roundTable,
+                                     _out);
                     }
                     else
                     {
@@ -3085,37 +4792,41 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
                                   p1,
                                   dir,
                                   firstDir,
-                                  perp,
-                                  firstPerp,
                                   le1,
                                   re1,
                                   firstLe,
                                   firstRe,
                                   cross,
                                   _style->miterLimit,
-                                  _vertices);
+                                  _roundTable,
+                                  _out);
                 }
                 else
                 {
                     /* otherwise we simply add a starting cap to the
                      * first dash of the contour... */
-                    tpVec2 tmpDir, tmpPerp;
+                    tpVec2 tmpDir;
                     tmpDir = tpVec2MultScalar(firstDir, -1 * halfSw);
-                    tmpPerp.x = tmpDir.y;
-                    tmpPerp.y = -tmpDir.x;
                     _tpGLMakeCap(_style->strokeCap,
                                  p1,
                                  tmpDir,
-                                 tmpPerp,
                                  firstRe,
                                  firstLe,
                                  tpFalse,
-                                 _vertices);
+                                 _roundTable,
+                                 _out);
                 }
             }
             else if (dashOffset > 0 && bOnDash)
             {
-                _tpGLMakeCap(_style->strokeCap, p1, dir, perp, le1, re1, tpFalse, _vertices);
+                _tpGLMakeCap(_style->strokeCap,
+                             p1,
+                             dir,
+                             le1,
+                             re1,
+                             tpFalse,
+                             _roundTable,
+                             _out);
             }
         }
 
@@ -3124,28 +4835,339 @@ TARP_LOCAL void _tpGLRenderCacheContourDashedStrokeGeometry(
 
         perpPrev = perp;
         dirPrev = dir;
+        prevCenter = p1;
         lePrev = le1;
         rePrev = re1;
     }
 
-    _contour->strokeVertexCount = _vertices->count - voff;
+    _contour->strokeVertexCount = _out->vertices->count - voff;
+    _contour->strokeIndexCount = _out->indices->count - _contour->strokeIndexOffset;
+}
+
+/* appends _count indices of _cache starting at _offset to _outIndices, adding _delta to each */
+TARP_LOCAL void _tpGLRenderCacheCopyIndices(const _tpGLRenderCache * _cache,
+                                            int _offset,
+                                            int _count,
+                                            int _delta,
+                                            _tpGLIndexArray * _outIndices)
+{
+    int i;
+    GLuint * dst;
+
+    if (!_count)
+        return;
+
+    _tpGLIndexArrayReserveAdditional(_outIndices, _count);
+    dst = _outIndices->array + _outIndices->count;
+    if (_cache->indexType == GL_UNSIGNED_SHORT)
+    {
+        const GLushort * src = _cache->shortIndexCache.array + _offset;
+        for (i = 0; i < _count; ++i)
+            dst[i] = (GLuint)((int)src[i] + _delta);
+    }
+    else
+    {
+        const GLuint * src = _cache->indexCache.array + _offset;
+        for (i = 0; i < _count; ++i)
+            dst[i] = (GLuint)((int)src[i] + _delta);
+    }
+    _outIndices->count += _count;
+}
+
+/*
+moves the stroke indices (and extrusions if the stroke is extruded on the gpu) that were generated
+into _buffers to the render cache. If all vertices can be addressed with 16 bit, the indices are
+stored as such to half the memory and upload size.
+*/
+TARP_LOCAL void _tpGLRenderCacheSetStrokeBuffers(_tpGLRenderCache * _cache,
+                                                 _tpGLStrokeBuffers * _buffers)
+{
+    int i;
+    _tpGLIndexArray * _indices = _buffers->indices;
+
+    _tpVec2ArrayClear(&_cache->extrusionCache);
+    if (_buffers->bExtrudeOnGPU)
+        _tpVec2ArraySwap(&_cache->extrusionCache, _buffers->extrusions);
+    _cache->bExtrudeStrokeOnGPU = _buffers->bExtrudeOnGPU;
+
+    _tpGLIndexArrayClear(&_cache->indexCache);
+    _tpGLShortIndexArrayClear(&_cache->shortIndexCache);
+    if (_cache->strokeVertexOffset + _cache->strokeVertexCount <= 0xFFFF + 1)
+    {
+        _cache->indexType = GL_UNSIGNED_SHORT;
+        if (_indices->count)
+        {
+            _tpGLShortIndexArrayReserveAdditional(&_cache->shortIndexCache, _indices->count);
+            for (i = 0; i < _indices->count; ++i)
+                _cache->shortIndexCache.array[i] = (GLushort)_indices->array[i];
+            _cache->shortIndexCache.count = _indices->count;
+        }
+    }
+    else
+    {
+        _cache->indexType = GL_UNSIGNED_INT;
+        _tpGLIndexArraySwap(&_cache->indexCache, _indices);
+    }
+    _tpGLIndexArrayClear(_indices);
+}
+
+/* checks if the cache holds the same vertices (and extrusions if _extrusions is not NULL) at
+ * [_offset, _offset + _count) as _vertices */
+TARP_LOCAL tpBool _tpGLRenderCacheVerticesEqual(const _tpGLRenderCache * _cache,
+                                                const _tpVec2Array * _vertices,
+                                                const _tpVec2Array * _extrusions,
+                                                int _strokeVertexOffset,
+                                                int _offset,
+                                                int _count)
+{
+    if (_offset + _count > _cache->geometryCache.count ||
+        memcmp(_cache->geometryCache.array + _offset,
+               _vertices->array + _offset,
+               sizeof(tpVec2) * _count))
+        return tpFalse;
+
+    if (!_extrusions)
+        return tpTrue;
+
+    /* the extrusions of both are compared at the same vertex position */
+    return (tpBool)(_cache->bExtrudeStrokeOnGPU && _offset >= _cache->strokeVertexOffset &&
+                    _offset + _count <= _cache->strokeVertexOffset + _cache->extrusionCache.count &&
+                    !memcmp(_cache->extrusionCache.array + _offset - _cache->strokeVertexOffset,
+                            _extrusions->array + _offset - _strokeVertexOffset,
+                            sizeof(tpVec2) * _count));
+}
+
+/* checks if the cache holds the same stroke indices at [_offset, _offset + _count) as _indices */
+TARP_LOCAL tpBool _tpGLRenderCacheIndicesEqual(const _tpGLRenderCache * _cache,
+                                               const _tpGLIndexArray * _indices,
+                                               int _offset,
+                                               int _count)
+{
+    int i;
+
+    if (_cache->indexType == GL_UNSIGNED_INT)
+        return (tpBool)(_offset + _count <= _cache->indexCache.count &&
+                        !memcmp(_cache->indexCache.array + _offset,
+                                _indices->array + _offset,
+                                sizeof(GLuint) * _count));
+
+    if (_offset + _count > _cache->shortIndexCache.count)
+        return tpFalse;
+    for (i = _offset; i < _offset + _count; ++i)
+    {
+        if (_cache->shortIndexCache.array[i] != _indices->array[i])
+            return tpFalse;
+    }
+    return tpTrue;
+}
+
+/*
+marks the vertex and index ranges of the contours in _contours (the geometry that is about to
+replace the one of the cache) that differ from what the cache holds at the same position, so that
+only the contours that changed or moved are uploaded again.
+*/
+TARP_LOCAL void _tpGLRenderCacheMarkDirtyContours(_tpGLRenderCache * _cache,
+                                                  const _tpGLRenderCacheContourArray * _contours,
+                                                  const _tpVec2Array * _vertices,
+                                                  const _tpVec2Array * _extrusions,
+                                                  int _strokeVertexOffset,
+                                                  const _tpGLIndexArray * _indices)
+{
+    int i;
+    const _tpGLRenderCacheContour * rc;
+
+    for (i = 0; i < _contours->count; ++i)
+    {
+        rc = &_contours->array[i];
+        if (!_tpGLRenderCacheVerticesEqual(
+                _cache, _vertices, NULL, 0, rc->fillVertexOffset, rc->fillVertexCount))
+            _tpGLRenderCacheMarkDirtyVertices(
+                _cache, rc->fillVertexOffset, rc->fillVertexOffset + rc->fillVertexCount);
+
+        if (!rc->strokeVertexCount)
+            continue;
+
+        if (!_tpGLRenderCacheVerticesEqual(_cache,
+                                           _vertices,
+                                           _extrusions,
+                                           _strokeVertexOffset,
+                                           rc->strokeVertexOffset,
+                                           rc->strokeVertexCount))
+            _tpGLRenderCacheMarkDirtyVertices(
+                _cache, rc->strokeVertexOffset, rc->strokeVertexOffset + rc->strokeVertexCount);
+
+        if (!_tpGLRenderCacheIndicesEqual(
+                _cache, _indices, rc->strokeIndexOffset, rc->strokeIndexCount))
+            _tpGLRenderCacheMarkDirtyIndices(
+                _cache, rc->strokeIndexOffset, rc->strokeIndexOffset + rc->strokeIndexCount);
+    }
+}
+
+struct _tpGLStrokeJobInput
+{
+    _tpGLPath * path;
+    _tpGLRenderCacheContourArray * contours;
+    tpBool bIsRebuildingInternalCache;
+    _tpGLRenderCache * oldCache;
+    const tpStyle * style;
+    const _tpGLDashStartState * dashStartState;
+    const _tpGLRoundTable * roundTable;
+    _tpBoolArray * joints;
+    _tpVec2Array * fillVertices;
+    tpBool bExtrudeOnGPU;
+};
+
+/* generates the stroke geometry of the contours in [_from, _to) */
+TARP_LOCAL void _tpGLStrokeContours(const _tpGLStrokeJobInput * _input,
+                                    int _from,
+                                    int _to,
+                                    _tpGLStrokeBuffers * _out)
+{
+    int i;
+    _tpGLContour * c;
+    _tpGLRenderCacheContour *rc, *oldRc;
+    _tpGLRenderCache * oldCache = _input->oldCache;
+
+    for (i = _from; i < _to; ++i)
+    {
+        rc = _tpGLRenderCacheContourArrayAtPtr(_input->contours, i);
+        c = _tpGLContourArrayAtPtr(&_input->path->contours, i);
+
+        if (c->bDirty || !oldCache)
+        {
+            /* only undo the dirty flag if the internal path cache is currently being rebuild! */
+            if (_input->bIsRebuildingInternalCache)
+                c->bDirty = tpFalse;
+
+            /* if the stroke is extruded on the cpu, the extrusions are only needed while the
+             * geometry of a contour is generated */
+            if (!_out->bExtrudeOnGPU)
+            {
+                _tpVec2ArrayClear(_out->extrusions);
+                _out->extrusionOffset = _out->vertices->count;
+            }
+
+            if (_input->style->dashCount)
+            {
+                _tpGLRenderCacheContourDashedStrokeGeometry(rc,
+                                                            _input->style,
+                                                            _input->dashStartState,
+                                                            _input->roundTable,
+                                                            _input->joints,
+                                                            _out);
+            }
+            else
+            {
+                _tpGLRenderCacheContourContinuousStrokeGeometry(
+                    rc, _input->style, _input->roundTable, _input->joints, _out);
+            }
+        }
+        else
+        {
+            /* grab the contour from the old cache and copy the old stroke data for the contour */
+            rc->strokeVertexOffset = _out->vertices->count;
+            oldRc = _tpGLRenderCacheContourArrayAtPtr(&oldCache->contours, i);
+            rc->strokeVertexCount = oldRc->strokeVertexCount;
+            _tpVec2ArrayAppendCArray(
+                _out->vertices,
+                _tpVec2ArrayAtPtr(&oldCache->geometryCache, oldRc->strokeVertexOffset),
+                oldRc->strokeVertexCount);
+            if (_out->bExtrudeOnGPU && oldRc->strokeVertexCount)
+            {
+                assert(oldCache->bExtrudeStrokeOnGPU);
+                _tpVec2ArrayAppendCArray(
+                    _out->extrusions,
+                    _tpVec2ArrayAtPtr(&oldCache->extrusionCache,
+                                      oldRc->strokeVertexOffset - oldCache->strokeVertexOffset),
+                    oldRc->strokeVertexCount);
+            }
+
+            /* the indices of the contour only reference its own stroke vertices, rebase them to
+             * where the vertices were copied to */
+            rc->strokeIndexOffset = _out->indices->count;
+            rc->strokeIndexCount = oldRc->strokeIndexCount;
+            _tpGLRenderCacheCopyIndices(oldCache,
+                                        oldRc->strokeIndexOffset,
+                                        oldRc->strokeIndexCount,
+                                        rc->strokeVertexOffset - oldRc->strokeVertexOffset,
+                                        _out->indices);
+        }
+    }
+}
+
+/* the number of chunks the contours of a path are split into (see tpSetJobSystem) */
+TARP_LOCAL int _tpGLGeometryJobCount(_tpGLGeometryBuilder * _builder, int _contourCount)
+{
+    if (!_builder->jobSystem.submit)
+        return 1;
+    return TARP_CLAMP(_contourCount / TARP_GL_MIN_CONTOURS_PER_JOB, 1, TARP_GL_MAX_GEOMETRY_JOBS);
+}
+
+/* splits _contourCount contours into _jobCount chunks and runs _fn for each of them using the job
+ * system of the builder */
+TARP_LOCAL void _tpGLRunGeometryJobs(_tpGLGeometryBuilder * _builder,
+                                     int _jobCount,
+                                     int _contourCount,
+                                     tpJobFunction _fn)
+{
+    int i;
+    _tpGLGeometryJob * job;
+
+    for (i = 0; i < _jobCount; ++i)
+    {
+        job = &_builder->geometryJobs[i];
+        job->contourStart = (int)((long)_contourCount * i / _jobCount);
+        job->contourEnd = (int)((long)_contourCount * (i + 1) / _jobCount);
+        _tpVec2ArrayClear(&job->vertices);
+        _tpBoolArrayClear(&job->joints);
+        _tpVec2ArrayClear(&job->extrusions);
+        _tpGLIndexArrayClear(&job->indices);
+        _tpGLRenderCacheContourArrayClear(&job->contours);
+        _builder->jobSystem.submit(_builder->jobSystem.userData, _fn, job);
+    }
+    _builder->jobSystem.wait(_builder->jobSystem.userData);
+}
+
+TARP_LOCAL void _tpGLStrokeJob(void * _data)
+{
+    _tpGLGeometryJob * job = (_tpGLGeometryJob *)_data;
+    _tpGLStrokeBuffers out;
+
+    out.fillVertices = job->strokeInput->fillVertices;
+    out.vertices = &job->vertices;
+    out.extrusions = &job->extrusions;
+    out.extrusionOffset = 0;
+    out.indices = &job->indices;
+    out.bExtrudeOnGPU = job->strokeInput->bExtrudeOnGPU;
+    _tpGLStrokeContours(job->strokeInput, job->contourStart, job->contourEnd, &out);
 }
 
-TARP_LOCAL void _tpGLStroke(_tpGLPath * _path,
+TARP_LOCAL void _tpGLStroke(_tpGLGeometryBuilder * _builder,
+                            _tpGLPath * _path,
                             _tpGLRenderCacheContourArray * _contours,
                             tpBool _bIsRebuildingInternalCache,
                             _tpGLRenderCache * _oldCache,
                             const tpStyle * _style,
-                            _tpVec2Array * _vertices,
+                            const _tpGLRoundTable * _roundTable,
                             _tpBoolArray * _joints,
-                            int * _outStrokeVertexCount)
+                            _tpGLStrokeBuffers * _out,
+                            int * _outStrokeVertexCount,
+                            int * _outStrokeIndexCount)
 {
-    int i;
-    _tpGLContour * c;
-    _tpGLRenderCacheContour *rc, *oldRc;
+    int i, j, jobCount, vertexOffset, indexOffset;
     _tpGLDashStartState dashStartState;
-
-    assert(_vertices->count == _joints->count);
+    _tpGLStrokeJobInput input;
+    _tpGLGeometryJob * job;
+    _tpGLRenderCacheContour * rc;
+    GLuint * indices;
+
+    /* the flattened contours can be followed by the triangles of the fill (or the cover
+     * geometry), the joints only cover the former */
+    assert(_joints->count <= _out->fillVertices->count);
+    assert(!_contours->count ||
+           _contours->array[_contours->count - 1].fillVertexOffset +
+                   _contours->array[_contours->count - 1].fillVertexCount ==
+               _joints->count);
 
     /* compute the start of the dash pattern if needed */
     if (_style->dashCount)
@@ -3202,42 +5224,61 @@ TARP_LOCAL void _tpGLStroke(_tpGLPath * _path,
         }
     }
 
-    *_outStrokeVertexCount = 0;
-    for (i = 0; i < _contours->count; ++i)
+    input.path = _path;
+    input.contours = _contours;
+    input.bIsRebuildingInternalCache = _bIsRebuildingInternalCache;
+    input.oldCache = _oldCache;
+    input.style = _style;
+    input.dashStartState = &dashStartState;
+    input.roundTable = _roundTable;
+    input.joints = _joints;
+    input.fillVertices = _out->fillVertices;
+    input.bExtrudeOnGPU = _out->bExtrudeOnGPU;
+
+    vertexOffset = _out->vertices->count;
+    indexOffset = _out->indices->count;
+    _tpVec2ArrayClear(_out->extrusions);
+    _out->extrusionOffset = vertexOffset;
+
+    jobCount = _tpGLGeometryJobCount(_builder, _contours->count);
+    if (jobCount > 1)
     {
-        rc = _tpGLRenderCacheContourArrayAtPtr(_contours, i);
-        c = _tpGLContourArrayAtPtr(&_path->contours, i);
+        for (i = 0; i < jobCount; ++i)
+            _builder->geometryJobs[i].strokeInput = &input;
+        _tpGLRunGeometryJobs(_builder, jobCount, _contours->count, _tpGLStrokeJob);
 
-        if (c->bDirty || !_oldCache)
+        /* merge the chunks in order and rebase their vertex offsets and indices */
+        for (i = 0; i < jobCount; ++i)
         {
-            /* only undo the dirty flag if the internal path cache is currently being rebuild! */
-            if (_bIsRebuildingInternalCache)
-                c->bDirty = tpFalse;
+            GLuint vertexBase = (GLuint)_out->vertices->count;
+            int indexBase = _out->indices->count;
 
-            if (_style->dashCount)
-            {
-                _tpGLRenderCacheContourDashedStrokeGeometry(
-                    rc, _style, &dashStartState, _vertices, _joints);
-            }
-            else
+            job = &_builder->geometryJobs[i];
+            _tpVec2ArrayAppendArray(_out->vertices, &job->vertices);
+            if (_out->bExtrudeOnGPU)
+                _tpVec2ArrayAppendArray(_out->extrusions, &job->extrusions);
+
+            _tpGLIndexArrayReserveAdditional(_out->indices, job->indices.count);
+            indices = _out->indices->array + _out->indices->count;
+            for (j = 0; j < job->indices.count; ++j)
+                indices[j] = job->indices.array[j] + vertexBase;
+            _out->indices->count += job->indices.count;
+
+            for (j = job->contourStart; j < job->contourEnd; ++j)
             {
-                _tpGLRenderCacheContourContinuousStrokeGeometry(rc, _style, _vertices, _joints);
+                rc = _tpGLRenderCacheContourArrayAtPtr(_contours, j);
+                rc->strokeVertexOffset += (int)vertexBase;
+                rc->strokeIndexOffset += indexBase;
             }
         }
-        else
-        {
-            /* grab the contour from the old cache and copy the old stroke data for the contour */
-            rc->strokeVertexOffset = _vertices->count;
-            oldRc = _tpGLRenderCacheContourArrayAtPtr(&_oldCache->contours, i);
-            rc->strokeVertexCount = oldRc->strokeVertexCount;
-            _tpVec2ArrayAppendCArray(
-                _vertices,
-                _tpVec2ArrayAtPtr(&_oldCache->geometryCache, oldRc->strokeVertexOffset),
-                oldRc->strokeVertexCount);
-        }
-
-        *_outStrokeVertexCount += rc->strokeVertexCount;
     }
+    else
+    {
+        _tpGLStrokeContours(&input, 0, _contours->count, _out);
+    }
+
+    *_outStrokeVertexCount = _out->vertices->count - vertexOffset;
+    *_outStrokeIndexCount = _out->indices->count - indexOffset;
 }
 
 TARP_LOCAL void _tpGLFlattenCurve(const _tpGLCurve * _curve,
@@ -3306,84 +5347,435 @@ TARP_LOCAL void _tpGLFlattenCurve(const _tpGLCurve * _curve,
     }
 }
 
-TARP_LOCAL void _tpGLInitBounds(_tpGLRect * _bounds)
+/*
+four wide float vector used to flatten curves in batches. Without simd support the plain C
+version below is used, which also serves as the reference implementation. The two only match
+within rounding, as the compiler may contract the plain C version into fused multiply adds (e.g.
+with -ffp-contract=fast). That changes the last bits of the points and can change a segment count
+that lands right on an integer by one.
+*/
+#if defined(TARP_SIMD_SSE2)
+
+typedef __m128 _tpFloat4;
+#define _tpFloat4Load(_ptr) _mm_loadu_ps(_ptr)
+#define _tpFloat4Store(_ptr, _a) _mm_storeu_ps(_ptr, _a)
+#define _tpFloat4Set(_f) _mm_set1_ps(_f)
+#define _tpFloat4Add(_a, _b) _mm_add_ps(_a, _b)
+#define _tpFloat4Sub(_a, _b) _mm_sub_ps(_a, _b)
+#define _tpFloat4Mul(_a, _b) _mm_mul_ps(_a, _b)
+#define _tpFloat4Max(_a, _b) _mm_max_ps(_a, _b)
+#define _tpFloat4Sqrt(_a) _mm_sqrt_ps(_a)
+
+#elif defined(TARP_SIMD_NEON)
+
+typedef float32x4_t _tpFloat4;
+#define _tpFloat4Load(_ptr) vld1q_f32(_ptr)
+#define _tpFloat4Store(_ptr, _a) vst1q_f32(_ptr, _a)
+#define _tpFloat4Set(_f) vdupq_n_f32(_f)
+#define _tpFloat4Add(_a, _b) vaddq_f32(_a, _b)
+#define _tpFloat4Sub(_a, _b) vsubq_f32(_a, _b)
+#define _tpFloat4Mul(_a, _b) vmulq_f32(_a, _b)
+#define _tpFloat4Max(_a, _b) vmaxq_f32(_a, _b)
+#define _tpFloat4Sqrt(_a) vsqrtq_f32(_a)
+
+#else
+
+typedef struct TARP_LOCAL
 {
-    _bounds->min.x = FLT_MAX;
-    _bounds->min.y = FLT_MAX;
-    _bounds->max.x = -FLT_MAX;
-    _bounds->max.y = -FLT_MAX;
+    tpFloat v[4];
+} _tpFloat4;
+
+TARP_LOCAL _tpFloat4 _tpFloat4Load(const tpFloat * _ptr)
+{
+    _tpFloat4 ret;
+    memcpy(ret.v, _ptr, sizeof(ret.v));
+    return ret;
 }
 
-TARP_LOCAL void _tpGLMergeBounds(_tpGLRect * _a, const _tpGLRect * _b)
+TARP_LOCAL void _tpFloat4Store(tpFloat * _ptr, _tpFloat4 _a)
 {
-    _tpGLEvaluatePointForBounds(_b->min, _a);
-    _tpGLEvaluatePointForBounds(_b->max, _a);
+    memcpy(_ptr, _a.v, sizeof(_a.v));
 }
 
-TARP_LOCAL tpBool _tpGLFlattenContour(_tpGLContour * _contour,
-                                      tpFloat _angleTolerance,
-                                      const tpTransform * _transform,
-                                      _tpVec2Array * _outVertices,
-                                      _tpBoolArray * _outJoints,
-                                      _tpGLRect * _mergeBounds,
-                                      _tpGLRenderCacheContour * _outContour)
+TARP_LOCAL _tpFloat4 _tpFloat4Set(tpFloat _f)
 {
-    int off, vcount, j;
-    _tpGLRect contourBounds;
-    _tpGLCurve curve;
-    _tpGLRenderCacheContour renderContour;
-    tpVec2 lastTransformedPos;
-    tpSegment *last = NULL, *current = NULL;
+    _tpFloat4 ret;
+    ret.v[0] = ret.v[1] = ret.v[2] = ret.v[3] = _f;
+    return ret;
+}
 
-    vcount = 0;
-    off = _outVertices->count;
-    _tpGLInitBounds(&contourBounds);
+TARP_LOCAL _tpFloat4 _tpFloat4Add(_tpFloat4 _a, _tpFloat4 _b)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+        _a.v[i] += _b.v[i];
+    return _a;
+}
 
-    last = _tpSegmentArrayAtPtr(&_contour->segments, 0);
-    for (j = 1; j < _contour->segments.count; ++j)
-    {
-        current = _tpSegmentArrayAtPtr(&_contour->segments, j);
+TARP_LOCAL _tpFloat4 _tpFloat4Sub(_tpFloat4 _a, _tpFloat4 _b)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+        _a.v[i] -= _b.v[i];
+    return _a;
+}
 
-        curve.p0 = tpVec2Make(last->position.x, last->position.y);
-        curve.h0 = tpVec2Make(last->handleOut.x, last->handleOut.y);
-        curve.h1 = tpVec2Make(current->handleIn.x, current->handleIn.y);
-        curve.p1 = tpVec2Make(current->position.x, current->position.y);
+TARP_LOCAL _tpFloat4 _tpFloat4Mul(_tpFloat4 _a, _tpFloat4 _b)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+        _a.v[i] *= _b.v[i];
+    return _a;
+}
 
-        if (_transform)
-        {
-            curve.p0 = j > 1 ? lastTransformedPos : tpTransformApply(_transform, curve.p0);
-            curve.h0 = tpTransformApply(_transform, curve.h0);
-            curve.h1 = tpTransformApply(_transform, curve.h1);
-            curve.p1 = tpTransformApply(_transform, curve.p1);
-            lastTransformedPos = curve.p1;
-        }
+TARP_LOCAL _tpFloat4 _tpFloat4Max(_tpFloat4 _a, _tpFloat4 _b)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+        _a.v[i] = TARP_MAX(_a.v[i], _b.v[i]);
+    return _a;
+}
 
-        _tpGLFlattenCurve(&curve,
-                          _angleTolerance,
-                          _contour->bIsClosed,
-                          j == 1,
-                          tpFalse,
-                          _outVertices,
-                          _outJoints,
-                          &contourBounds,
-                          &vcount);
+TARP_LOCAL _tpFloat4 _tpFloat4Sqrt(_tpFloat4 _a)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+        _a.v[i] = (tpFloat)sqrt(_a.v[i]);
+    return _a;
+}
 
-        last = current;
-    }
+#endif /* TARP_SIMD_SSE2 */
 
-    /* if the contour is closed, flatten the last closing curve */
-    if (_contour->bIsClosed && _contour->segments.count &&
-        tpVec2Distance(
-            _tpSegmentArrayAtPtr(&_contour->segments, 0)->position,
-            _tpSegmentArrayAtPtr(&_contour->segments, _contour->segments.count - 1)->position) >
-            FLT_EPSILON)
-    {
-        tpSegment * fs = _tpSegmentArrayAtPtr(&_contour->segments, 0);
+TARP_LOCAL void _tpGLTransformBatchPoints(tpFloat * _x, tpFloat * _y, const _tpFloat4 * _matrix)
+{
+    _tpFloat4 x, y;
+    x = _tpFloat4Load(_x);
+    y = _tpFloat4Load(_y);
+    _tpFloat4Store(
+        _x,
+        _tpFloat4Add(_tpFloat4Add(_tpFloat4Mul(x, _matrix[0]), _tpFloat4Mul(y, _matrix[2])),
+                     _matrix[4]));
+    _tpFloat4Store(
+        _y,
+        _tpFloat4Add(_tpFloat4Add(_tpFloat4Mul(x, _matrix[1]), _tpFloat4Mul(y, _matrix[3])),
+                     _matrix[5]));
+}
 
-        curve.p0 = tpVec2Make(last->position.x, last->position.y);
-        curve.h0 = tpVec2Make(last->handleOut.x, last->handleOut.y);
-        curve.h1 = tpVec2Make(fs->handleIn.x, fs->handleIn.y);
-        curve.p1 = tpVec2Make(fs->position.x, fs->position.y);
+/*
+the number of segments for a curve from the estimate of Wang's formula. It is clamped before
+converting it to int, as it is inf or nan for huge scales or tiny tolerances. In doubt (nan), the
+curve gets the most segments.
+*/
+TARP_LOCAL int _tpGLCurveSegmentCount(tpFloat _estimate)
+{
+    if (!(_estimate < (tpFloat)TARP_MAX_CURVE_SEGMENTS))
+        return TARP_MAX_CURVE_SEGMENTS;
+    return TARP_MAX((int)ceil(_estimate), 1);
+}
+
+/*
+Flattens the first _curveCount curves of _batch. Each curve is split into a number of
+segments of equal parameter length that is computed up front (Wang's formula) and the points
+are generated by forward differencing all curves of the batch in lockstep. For the first
+batch of a contour the start point of the first curve is added, too.
+*/
+TARP_LOCAL void _tpGLFlattenCurveBatch(_tpGLCurveBatch * _batch,
+                                       int _curveCount,
+                                       const tpTransform * _transform,
+                                       tpFloat _tolerance,
+                                       int _bFirstBatch,
+                                       _tpVec2Array * _outVertices,
+                                       _tpBoolArray * _outJoints,
+                                       _tpGLRect * _bounds,
+                                       int * _vertexCount)
+{
+    int i, j, total, maxCount;
+    int counts[4], offsets[4];
+    tpFloat steps[4], xs[4], ys[4];
+    _tpFloat4 matrix[6], three, six;
+    _tpFloat4 p0x, p0y, h0x, h0y, h1x, h1y, p1x, p1y;
+    _tpFloat4 ddx0, ddy0, ddx1, ddy1, ax, ay, bx, by, cx, cy;
+    _tpFloat4 step, step2, step3, fx, fy, dfx, dfy, ddfx, ddfy, dddfx, dddfy;
+    tpVec2 * vertices;
+    tpBool * joints;
+
+    assert(_curveCount > 0 && _curveCount <= 4);
+
+    /* fill the unused lanes with the first curve so they don't compute garbage */
+    for (i = _curveCount; i < 4; ++i)
+    {
+        _batch->p0x[i] = _batch->p0x[0];
+        _batch->p0y[i] = _batch->p0y[0];
+        _batch->h0x[i] = _batch->h0x[0];
+        _batch->h0y[i] = _batch->h0y[0];
+        _batch->h1x[i] = _batch->h1x[0];
+        _batch->h1y[i] = _batch->h1y[0];
+        _batch->p1x[i] = _batch->p1x[0];
+        _batch->p1y[i] = _batch->p1y[0];
+    }
+
+    if (_transform)
+    {
+        matrix[0] = _tpFloat4Set(_transform->m.v[0]);
+        matrix[1] = _tpFloat4Set(_transform->m.v[1]);
+        matrix[2] = _tpFloat4Set(_transform->m.v[2]);
+        matrix[3] = _tpFloat4Set(_transform->m.v[3]);
+        matrix[4] = _tpFloat4Set(_transform->t.x);
+        matrix[5] = _tpFloat4Set(_transform->t.y);
+
+        _tpGLTransformBatchPoints(_batch->p0x, _batch->p0y, matrix);
+        _tpGLTransformBatchPoints(_batch->h0x, _batch->h0y, matrix);
+        _tpGLTransformBatchPoints(_batch->h1x, _batch->h1y, matrix);
+        _tpGLTransformBatchPoints(_batch->p1x, _batch->p1y, matrix);
+    }
+
+    p0x = _tpFloat4Load(_batch->p0x);
+    p0y = _tpFloat4Load(_batch->p0y);
+    h0x = _tpFloat4Load(_batch->h0x);
+    h0y = _tpFloat4Load(_batch->h0y);
+    h1x = _tpFloat4Load(_batch->h1x);
+    h1y = _tpFloat4Load(_batch->h1y);
+    p1x = _tpFloat4Load(_batch->p1x);
+    p1y = _tpFloat4Load(_batch->p1y);
+
+    /*
+    Wang's formula: a cubic bezier flattened into n segments of equal parameter length stays
+    within _tolerance of the curve if n >= sqrt(3 * 2 / 8 * M / _tolerance) where M is the
+    largest second difference of its control points.
+    */
+    ddx0 = _tpFloat4Add(_tpFloat4Sub(p0x, _tpFloat4Add(h0x, h0x)), h1x);
+    ddy0 = _tpFloat4Add(_tpFloat4Sub(p0y, _tpFloat4Add(h0y, h0y)), h1y);
+    ddx1 = _tpFloat4Add(_tpFloat4Sub(h0x, _tpFloat4Add(h1x, h1x)), p1x);
+    ddy1 = _tpFloat4Add(_tpFloat4Sub(h0y, _tpFloat4Add(h1y, h1y)), p1y);
+    _tpFloat4Store(
+        steps,
+        _tpFloat4Sqrt(_tpFloat4Mul(
+            _tpFloat4Sqrt(_tpFloat4Max(
+                _tpFloat4Add(_tpFloat4Mul(ddx0, ddx0), _tpFloat4Mul(ddy0, ddy0)),
+                _tpFloat4Add(_tpFloat4Mul(ddx1, ddx1), _tpFloat4Mul(ddy1, ddy1)))),
+            _tpFloat4Set(0.75f / _tolerance))));
+
+    total = _bFirstBatch ? 1 : 0;
+    maxCount = 1;
+    for (i = 0; i < 4; ++i)
+    {
+        if (_tpGLIsClose(_batch->p0x[i], _batch->h0x[i], FLT_EPSILON) &&
+            _tpGLIsClose(_batch->p0y[i], _batch->h0y[i], FLT_EPSILON) &&
+            _tpGLIsClose(_batch->p1x[i], _batch->h1x[i], FLT_EPSILON) &&
+            _tpGLIsClose(_batch->p1y[i], _batch->h1y[i], FLT_EPSILON))
+            counts[i] = 1;
+        else
+            counts[i] = _tpGLCurveSegmentCount(steps[i]);
+
+        steps[i] = 1.0f / (tpFloat)counts[i];
+        if (i < _curveCount)
+        {
+            offsets[i] = total;
+            total += counts[i];
+            maxCount = TARP_MAX(maxCount, counts[i]);
+        }
+    }
+
+    if (_tpVec2ArrayReserveAdditional(_outVertices, total) ||
+        _tpBoolArrayReserveAdditional(_outJoints, total))
+        return;
+
+    vertices = _outVertices->array + _outVertices->count;
+    joints = _outJoints->array + _outJoints->count;
+
+    if (_bFirstBatch)
+    {
+        vertices[0] = tpVec2Make(_batch->p0x[0], _batch->p0y[0]);
+        joints[0] = tpFalse;
+    }
+
+    /* polynomial coefficients of the curves, i.e. B(t) = a * t^3 + b * t^2 + c * t + p0 */
+    three = _tpFloat4Set(3.0f);
+    six = _tpFloat4Set(6.0f);
+    cx = _tpFloat4Mul(_tpFloat4Sub(h0x, p0x), three);
+    cy = _tpFloat4Mul(_tpFloat4Sub(h0y, p0y), three);
+    bx = _tpFloat4Mul(ddx0, three);
+    by = _tpFloat4Mul(ddy0, three);
+    ax = _tpFloat4Add(_tpFloat4Sub(p1x, p0x), _tpFloat4Mul(_tpFloat4Sub(h0x, h1x), three));
+    ay = _tpFloat4Add(_tpFloat4Sub(p1y, p0y), _tpFloat4Mul(_tpFloat4Sub(h0y, h1y), three));
+
+    /* initial forward differences */
+    step = _tpFloat4Load(steps);
+    step2 = _tpFloat4Mul(step, step);
+    step3 = _tpFloat4Mul(step2, step);
+    fx = p0x;
+    fy = p0y;
+    dfx = _tpFloat4Add(_tpFloat4Add(_tpFloat4Mul(ax, step3), _tpFloat4Mul(bx, step2)),
+                       _tpFloat4Mul(cx, step));
+    dfy = _tpFloat4Add(_tpFloat4Add(_tpFloat4Mul(ay, step3), _tpFloat4Mul(by, step2)),
+                       _tpFloat4Mul(cy, step));
+    dddfx = _tpFloat4Mul(_tpFloat4Mul(ax, six), step3);
+    dddfy = _tpFloat4Mul(_tpFloat4Mul(ay, six), step3);
+    ddfx = _tpFloat4Add(dddfx, _tpFloat4Mul(_tpFloat4Add(bx, bx), step2));
+    ddfy = _tpFloat4Add(dddfy, _tpFloat4Mul(_tpFloat4Add(by, by), step2));
+
+    for (j = 1; j < maxCount; ++j)
+    {
+        fx = _tpFloat4Add(fx, dfx);
+        fy = _tpFloat4Add(fy, dfy);
+        dfx = _tpFloat4Add(dfx, ddfx);
+        dfy = _tpFloat4Add(dfy, ddfy);
+        ddfx = _tpFloat4Add(ddfx, dddfx);
+        ddfy = _tpFloat4Add(ddfy, dddfy);
+
+        _tpFloat4Store(xs, fx);
+        _tpFloat4Store(ys, fy);
+        for (i = 0; i < _curveCount; ++i)
+        {
+            if (j < counts[i])
+            {
+                vertices[offsets[i] + j - 1] = tpVec2Make(xs[i], ys[i]);
+                joints[offsets[i] + j - 1] = tpFalse;
+            }
+        }
+    }
+
+    /* the end points are taken as is to not accumulate any error at the curve ends */
+    for (i = 0; i < _curveCount; ++i)
+    {
+        vertices[offsets[i] + counts[i] - 1] = tpVec2Make(_batch->p1x[i], _batch->p1y[i]);
+        joints[offsets[i] + counts[i] - 1] = tpTrue;
+    }
+
+    for (i = 0; i < total; ++i)
+        _tpGLEvaluatePointForBounds(vertices[i], _bounds);
+
+    _outVertices->count += total;
+    _outJoints->count += total;
+    *_vertexCount += total;
+}
+
+TARP_LOCAL void _tpGLFlattenContourBatched(_tpGLContour * _contour,
+                                           tpFloat _tolerance,
+                                           const tpTransform * _transform,
+                                           _tpVec2Array * _outVertices,
+                                           _tpBoolArray * _outJoints,
+                                           _tpGLRect * _bounds,
+                                           int * _vertexCount)
+{
+    _tpGLCurveBatch batch;
+    tpSegment *last, *current;
+    int i, j, curveCount;
+
+    curveCount = _contour->segments.count - 1;
+    if (curveCount < 1)
+        return;
+
+    /* if the contour is closed, we need to flatten the closing curve, too */
+    if (_contour->bIsClosed &&
+        tpVec2Distance(
+            _tpSegmentArrayAtPtr(&_contour->segments, 0)->position,
+            _tpSegmentArrayAtPtr(&_contour->segments, _contour->segments.count - 1)->position) >
+            FLT_EPSILON)
+        ++curveCount;
+
+    for (i = 0; i < curveCount; i += 4)
+    {
+        for (j = 0; j < 4 && i + j < curveCount; ++j)
+        {
+            last = _tpSegmentArrayAtPtr(&_contour->segments, i + j);
+            current =
+                _tpSegmentArrayAtPtr(&_contour->segments, (i + j + 1) % _contour->segments.count);
+
+            batch.p0x[j] = last->position.x;
+            batch.p0y[j] = last->position.y;
+            batch.h0x[j] = last->handleOut.x;
+            batch.h0y[j] = last->handleOut.y;
+            batch.h1x[j] = current->handleIn.x;
+            batch.h1y[j] = current->handleIn.y;
+            batch.p1x[j] = current->position.x;
+            batch.p1y[j] = current->position.y;
+        }
+
+        _tpGLFlattenCurveBatch(&batch,
+                               j,
+                               _transform,
+                               _tolerance,
+                               i == 0,
+                               _outVertices,
+                               _outJoints,
+                               _bounds,
+                               _vertexCount);
+    }
+}
+
+TARP_LOCAL void _tpGLInitBounds(_tpGLRect * _bounds)
+{
+    _bounds->min.x = FLT_MAX;
+    _bounds->min.y = FLT_MAX;
+    _bounds->max.x = -FLT_MAX;
+    _bounds->max.y = -FLT_MAX;
+}
+
+TARP_LOCAL void _tpGLMergeBounds(_tpGLRect * _a, const _tpGLRect * _b)
+{
+    _tpGLEvaluatePointForBounds(_b->min, _a);
+    _tpGLEvaluatePointForBounds(_b->max, _a);
+}
+
+TARP_LOCAL void _tpGLFlattenContourSubdivision(_tpGLContour * _contour,
+                                               tpFloat _angleTolerance,
+                                               const tpTransform * _transform,
+                                               _tpVec2Array * _outVertices,
+                                               _tpBoolArray * _outJoints,
+                                               _tpGLRect * _bounds,
+                                               int * _vertexCount)
+{
+    int j;
+    _tpGLCurve curve;
+    tpVec2 lastTransformedPos;
+    tpSegment *last = NULL, *current = NULL;
+
+    last = _tpSegmentArrayAtPtr(&_contour->segments, 0);
+    for (j = 1; j < _contour->segments.count; ++j)
+    {
+        current = _tpSegmentArrayAtPtr(&_contour->segments, j);
+
+        curve.p0 = tpVec2Make(last->position.x, last->position.y);
+        curve.h0 = tpVec2Make(last->handleOut.x, last->handleOut.y);
+        curve.h1 = tpVec2Make(current->handleIn.x, current->handleIn.y);
+        curve.p1 = tpVec2Make(current->position.x, current->position.y);
+
+        if (_transform)
+        {
+            curve.p0 = j > 1 ? lastTransformedPos : tpTransformApply(_transform, curve.p0);
+            curve.h0 = tpTransformApply(_transform, curve.h0);
+            curve.h1 = tpTransformApply(_transform, curve.h1);
+            curve.p1 = tpTransformApply(_transform, curve.p1);
+            lastTransformedPos = curve.p1;
+        }
+
+        _tpGLFlattenCurve(&curve,
+                          _angleTolerance,
+                          _contour->bIsClosed,
+                          j == 1,
+                          tpFalse,
+                          _outVertices,
+                          _outJoints,
+                          _bounds,
+                          _vertexCount);
+
+        last = current;
+    }
+
+    /* if the contour is closed, flatten the last closing curve */
+    if (_contour->bIsClosed && _contour->segments.count &&
+        tpVec2Distance(
+            _tpSegmentArrayAtPtr(&_contour->segments, 0)->position,
+            _tpSegmentArrayAtPtr(&_contour->segments, _contour->segments.count - 1)->position) >
+            FLT_EPSILON)
+    {
+        tpSegment * fs = _tpSegmentArrayAtPtr(&_contour->segments, 0);
+
+        curve.p0 = tpVec2Make(last->position.x, last->position.y);
+        curve.h0 = tpVec2Make(last->handleOut.x, last->handleOut.y);
+        curve.h1 = tpVec2Make(fs->handleIn.x, fs->handleIn.y);
+        curve.p1 = tpVec2Make(fs->position.x, fs->position.y);
 
         if (_transform)
         {
@@ -3402,20 +5794,289 @@ TARP_LOCAL tpBool _tpGLFlattenContour(_tpGLContour * _contour,
                           tpTrue,
                           _outVertices,
                           _outJoints,
-                          &contourBounds,
-                          &vcount);
+                          _bounds,
+                          _vertexCount);
+    }
+}
+
+/*
+classifies the flattened fill of a contour as convex or not and computes its orientation. A contour
+is convex if it only turns in one direction and its edges change their direction along each axis at
+most twice, which rules out contours that wind around more than once.
+*/
+TARP_LOCAL void _tpGLClassifyContour(const tpVec2 * _vertices,
+                                     int _count,
+                                     _tpGLRenderCacheContour * _outContour)
+{
+    int i, xFlips, yFlips, xSign, ySign, firstXSign, firstYSign, lastXSign, lastYSign;
+    tpBool bTurnsLeft, bTurnsRight;
+    tpFloat area, cross;
+    tpVec2 edge, prevEdge;
+
+    area = 0;
+    xFlips = yFlips = 0;
+    firstXSign = firstYSign = lastXSign = lastYSign = 0;
+    bTurnsLeft = bTurnsRight = tpFalse;
+    _outContour->bIsConvex = tpTrue;
+
+    /* find the last edge that has a length to compare the first one against */
+    prevEdge = tpVec2Make(0, 0);
+    for (i = _count - 1; i > 0; --i)
+    {
+        prevEdge = tpVec2Sub(_vertices[(i + 1) % _count], _vertices[i]);
+        if (prevEdge.x != 0 || prevEdge.y != 0)
+            break;
+    }
+
+    for (i = 0; i < _count; ++i)
+    {
+        area += tpVec2Cross(_vertices[i], _vertices[(i + 1) % _count]);
+        edge = tpVec2Sub(_vertices[(i + 1) % _count], _vertices[i]);
+        if (edge.x == 0 && edge.y == 0)
+            continue;
+
+        /* treat nearly collinear edges as straight, unless they turn around */
+        cross = tpVec2Cross(prevEdge, edge);
+        if (cross * cross > 1e-10f * tpVec2Dot(prevEdge, prevEdge) * tpVec2Dot(edge, edge))
+        {
+            if (cross > 0)
+                bTurnsLeft = tpTrue;
+            else
+                bTurnsRight = tpTrue;
+        }
+        else if (tpVec2Dot(prevEdge, edge) < 0)
+            bTurnsLeft = bTurnsRight = tpTrue;
+        prevEdge = edge;
+
+        xSign = edge.x > 0 ? 1 : edge.x < 0 ? -1 : 0;
+        ySign = edge.y > 0 ? 1 : edge.y < 0 ? -1 : 0;
+        if (xSign)
+        {
+            if (!firstXSign)
+                firstXSign = xSign;
+            else if (xSign != lastXSign)
+                xFlips++;
+            lastXSign = xSign;
+        }
+        if (ySign)
+        {
+            if (!firstYSign)
+                firstYSign = ySign;
+            else if (ySign != lastYSign)
+                yFlips++;
+            lastYSign = ySign;
+        }
+    }
+
+    /* the flips between the last and the first edge */
+    if (lastXSign != firstXSign)
+        xFlips++;
+    if (lastYSign != firstYSign)
+        yFlips++;
+
+    if ((bTurnsLeft && bTurnsRight) || xFlips > 2 || yFlips > 2)
+        _outContour->bIsConvex = tpFalse;
+    _outContour->orientation = area > 0 ? 1 : area < 0 ? -1 : 0;
+}
+
+TARP_LOCAL tpBool _tpGLFlattenContour(_tpGLContour * _contour,
+                                      tpFlatteningMode _mode,
+                                      tpFloat _angleTolerance,
+                                      const tpTransform * _transform,
+                                      _tpVec2Array * _outVertices,
+                                      _tpBoolArray * _outJoints,
+                                      _tpGLRect * _mergeBounds,
+                                      _tpGLRect * _outContourBounds,
+                                      _tpGLRenderCacheContour * _outContour)
+{
+    int off, vcount;
+    _tpGLRect contourBounds;
+    _tpGLRenderCacheContour renderContour;
+
+    vcount = 0;
+    off = _outVertices->count;
+    _tpGLInitBounds(&contourBounds);
+
+    if (_mode == kTpFlatteningModeForwardDifferencing)
+    {
+        _tpGLFlattenContourBatched(_contour,
+                                   _angleTolerance,
+                                   _transform,
+                                   _outVertices,
+                                   _outJoints,
+                                   &contourBounds,
+                                   &vcount);
+    }
+    else
+    {
+        _tpGLFlattenContourSubdivision(_contour,
+                                       _angleTolerance,
+                                       _transform,
+                                       _outVertices,
+                                       _outJoints,
+                                       &contourBounds,
+                                       &vcount);
     }
 
     renderContour.fillVertexOffset = off;
     renderContour.fillVertexCount = vcount;
+    renderContour.strokeVertexOffset = 0;
+    renderContour.strokeVertexCount = 0;
+    renderContour.strokeIndexOffset = 0;
+    renderContour.strokeIndexCount = 0;
     renderContour.bIsClosed = _contour->bIsClosed;
-    _contour->bounds = contourBounds;
+    renderContour.bounds = contourBounds;
+    _tpGLClassifyContour(_outVertices->array + off, vcount, &renderContour);
+    if (_outContourBounds)
+        *_outContourBounds = contourBounds;
 
     *_outContour = renderContour;
     _tpGLMergeBounds(_mergeBounds, &contourBounds);
     return tpFalse;
 }
 
+struct _tpGLFlattenJobInput
+{
+    _tpGLPath * path;
+    _tpGLRenderCache * oldCache;
+    tpFlatteningMode mode;
+    tpFloat tolerance;
+    const tpTransform * transform; /* NULL if the contours are flattened in path space */
+    tpBool bClearDirtyFlags;
+    /* the bounds stored in the contours belong to the internal render cache of the path, other
+     * caches must not touch them so that they can be generated without modifying the path */
+    tpBool bUpdateContourBounds;
+};
+
+/* flattens the contours in [_from, _to) or copies them from the old cache if they are unchanged */
+TARP_LOCAL void _tpGLFlattenContours(const _tpGLFlattenJobInput * _input,
+                                     int _from,
+                                     int _to,
+                                     _tpVec2Array * _outVertices,
+                                     _tpBoolArray * _outJoints,
+                                     _tpGLRenderCacheContourArray * _outContours,
+                                     _tpGLRect * _bounds)
+{
+    int i;
+    _tpGLContour * c;
+    _tpGLRenderCacheContour rc;
+    _tpGLRenderCache * oldCache = _input->oldCache;
+
+    for (i = _from; i < _to; ++i)
+    {
+        c = _tpGLContourArrayAtPtr(&_input->path->contours, i);
+        if (c->bDirty || !oldCache || !oldCache->contours.count)
+        {
+            _tpGLFlattenContour(c,
+                                _input->mode,
+                                _input->tolerance,
+                                _input->transform,
+                                _outVertices,
+                                _outJoints,
+                                _bounds,
+                                _input->bUpdateContourBounds ? &c->bounds : NULL,
+                                &rc);
+
+            /* only clear the dirty flag here, if there is no stroke, otherwise this will be
+             * done during stroking. We also ignore the dirty flag if this is not the internal
+             * path render cache */
+            if (_input->bClearDirtyFlags)
+                c->bDirty = tpFalse;
+        }
+        else
+        {
+            _tpGLRenderCacheContour * rcc =
+                _tpGLRenderCacheContourArrayAtPtr(&oldCache->contours, i);
+
+            rc.fillVertexOffset = _outVertices->count;
+            rc.fillVertexCount = rcc->fillVertexCount;
+            rc.strokeVertexOffset = 0;
+            rc.strokeVertexCount = 0;
+            rc.strokeIndexOffset = 0;
+            rc.strokeIndexCount = 0;
+            rc.bIsClosed = c->bIsClosed;
+            rc.bIsConvex = rcc->bIsConvex;
+            rc.orientation = rcc->orientation;
+            rc.bounds = rcc->bounds;
+
+            /* otherwise we just copy the contour to the tmpbuffer... */
+            _tpVec2ArrayAppendCArray(
+                _outVertices,
+                _tpVec2ArrayAtPtr(&oldCache->geometryCache, rcc->fillVertexOffset),
+                rcc->fillVertexCount);
+
+            _tpBoolArrayAppendCArray(
+                _outJoints,
+                _tpBoolArrayAtPtr(&oldCache->jointCache, rcc->fillVertexOffset),
+                rcc->fillVertexCount);
+
+            /* ...and merge the cached contour bounds with the path bounds
+             */
+            _tpGLMergeBounds(_bounds, &c->bounds);
+        }
+
+        _tpGLRenderCacheContourArrayAppendPtr(_outContours, &rc);
+    }
+}
+
+TARP_LOCAL void _tpGLFlattenJob(void * _data)
+{
+    _tpGLGeometryJob * job = (_tpGLGeometryJob *)_data;
+
+    _tpGLInitBounds(&job->bounds);
+    _tpGLFlattenContours(job->flattenInput,
+                         job->contourStart,
+                         job->contourEnd,
+                         &job->vertices,
+                         &job->joints,
+                         &job->contours,
+                         &job->bounds);
+}
+
+/* flattens all contours of a path, in parallel chunks if the context has a job system */
+TARP_LOCAL void _tpGLFlattenPath(_tpGLGeometryBuilder * _builder,
+                                 const _tpGLFlattenJobInput * _input,
+                                 _tpVec2Array * _outVertices,
+                                 _tpBoolArray * _outJoints,
+                                 _tpGLRenderCacheContourArray * _outContours,
+                                 _tpGLRect * _bounds)
+{
+    int i, j, jobCount, contourCount;
+    _tpGLGeometryJob * job;
+    _tpGLRenderCacheContour * rc;
+
+    contourCount = _input->path->contours.count;
+    jobCount = _tpGLGeometryJobCount(_builder, contourCount);
+    if (jobCount > 1)
+    {
+        for (i = 0; i < jobCount; ++i)
+            _builder->geometryJobs[i].flattenInput = _input;
+        _tpGLRunGeometryJobs(_builder, jobCount, contourCount, _tpGLFlattenJob);
+
+        /* merge the chunks in order and rebase their vertex offsets */
+        for (i = 0; i < jobCount; ++i)
+        {
+            int vertexBase = _outVertices->count;
+
+            job = &_builder->geometryJobs[i];
+            _tpVec2ArrayAppendArray(_outVertices, &job->vertices);
+            _tpBoolArrayAppendArray(_outJoints, &job->joints);
+            for (j = 0; j < job->contours.count; ++j)
+            {
+                rc = _tpGLRenderCacheContourArrayAtPtr(&job->contours, j);
+                rc->fillVertexOffset += vertexBase;
+                _tpGLRenderCacheContourArrayAppendPtr(_outContours, rc);
+            }
+            _tpGLMergeBounds(_bounds, &job->bounds);
+        }
+    }
+    else
+    {
+        _tpGLFlattenContours(
+            _input, 0, contourCount, _outVertices, _outJoints, _outContours, _bounds);
+    }
+}
+
 TARP_LOCAL int _tpGLColorStopComp(const void * _a, const void * _b)
 {
     if (((tpColorStop *)_a)->offset < ((tpColorStop *)_b)->offset)
@@ -3423,7 +6084,7 @@ TARP_LOCAL int _tpGLColorStopComp(const void * _a, const void * _b)
     return 1;
 }
 
-TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLContext * _ctx, _tpGLGradient * _grad)
+TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLGeometryBuilder * _builder, _tpGLGradient * _grad)
 {
     int i, j;
     tpColorStop * current;
@@ -3432,7 +6093,7 @@ TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLContext * _ctx, _tpGLGradient * _gr
     if (!_grad->stops.count)
         return;
 
-    _tpColorStopArrayClear(&_ctx->tmpColorStops);
+    _tpColorStopArrayClear(&_builder->tmpColorStops);
 
     bHasStartStop = tpFalse;
     bHasEndStop = tpFalse;
@@ -3447,9 +6108,9 @@ TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLContext * _ctx, _tpGLGradient * _gr
         else if (current->offset == 1)
             bHasEndStop = tpTrue;
 
-        for (j = 0; j < _ctx->tmpColorStops.count; ++j)
+        for (j = 0; j < _builder->tmpColorStops.count; ++j)
         {
-            if (current->offset == _tpColorStopArrayAtPtr(&_ctx->tmpColorStops, j)->offset)
+            if (current->offset == _tpColorStopArrayAtPtr(&_builder->tmpColorStops, j)->offset)
             {
                 bAdd = tpFalse;
                 break;
@@ -3457,12 +6118,12 @@ TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLContext * _ctx, _tpGLGradient * _gr
         }
 
         if (bAdd && current->offset >= 0 && current->offset <= 1)
-            _tpColorStopArrayAppendPtr(&_ctx->tmpColorStops, current);
+            _tpColorStopArrayAppendPtr(&_builder->tmpColorStops, current);
     }
 
     /* sort from 0 - 1 by offset */
-    qsort(_ctx->tmpColorStops.array,
-          _ctx->tmpColorStops.count,
+    qsort(_builder->tmpColorStops.array,
+          _builder->tmpColorStops.count,
           sizeof(tpColorStop),
           _tpGLColorStopComp);
 
@@ -3474,16 +6135,16 @@ TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLContext * _ctx, _tpGLGradient * _gr
         _tpColorStopArrayClear(&_grad->stops);
         if (!bHasStartStop)
         {
-            tmp.color = _tpColorStopArrayAtPtr(&_ctx->tmpColorStops, 0)->color;
+            tmp.color = _tpColorStopArrayAtPtr(&_builder->tmpColorStops, 0)->color;
             tmp.offset = 0;
             _tpColorStopArrayAppendPtr(&_grad->stops, &tmp);
         }
 
-        _tpColorStopArrayAppendArray(&_grad->stops, &_ctx->tmpColorStops);
+        _tpColorStopArrayAppendArray(&_grad->stops, &_builder->tmpColorStops);
 
         if (!bHasEndStop)
         {
-            tmp.color = _tpColorStopArrayLastPtr(&_ctx->tmpColorStops)->color;
+            tmp.color = _tpColorStopArrayLastPtr(&_builder->tmpColorStops)->color;
             tmp.offset = 1;
             _tpColorStopArrayAppendPtr(&_grad->stops, &tmp);
         }
@@ -3491,7 +6152,7 @@ TARP_LOCAL void _tpGLFinalizeColorStops(_tpGLContext * _ctx, _tpGLGradient * _gr
     else
     {
         /* if they are already there, we can simply swap */
-        _tpColorStopArraySwap(&_grad->stops, &_ctx->tmpColorStops);
+        _tpColorStopArraySwap(&_grad->stops, &_builder->tmpColorStops);
     }
 }
 
@@ -3546,98 +6207,641 @@ TARP_LOCAL void _tpGLUpdateRampTexture(_tpGLGradient * _grad)
         GL_TEXTURE_1D, 0, 0, TARP_GL_RAMP_TEXTURE_SIZE, GL_RGBA, GL_FLOAT, &pixels[0].r));
 }
 
-TARP_LOCAL void _tpGLUpdateVAO(_tpGLVAO * _vao, void * _data, int _byteCount)
+/* creates the vaos and buffers of a render cache the first time it is drawn */
+TARP_LOCAL void _tpGLRenderCacheCreateBuffers(_tpGLRenderCache * _cache)
 {
-    /* @TODO: not sure if this buffer orphaning style data upload makes a
-     * difference these days anymore. (TEST??) */
-    if ((GLuint)_byteCount > _vao->vboSize)
-    {
-        _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_ARRAY_BUFFER, _byteCount, _data, GL_DYNAMIC_DRAW));
-        _vao->vboSize = _byteCount;
-    }
-    else
-    {
-        _TARP_ASSERT_NO_GL_ERROR(
-            glBufferData(GL_ARRAY_BUFFER, _vao->vboSize, NULL, GL_DYNAMIC_DRAW));
-        _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, 0, _byteCount, _data));
-    }
+    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &_cache->vao.vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_cache->vao.vao));
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_cache->vao.vbo));
+    _cache->vao.vboSize = 0;
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _cache->vao.vbo));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
+    /* the element buffer binding is part of the vao state */
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_cache->vao.ebo));
+    _cache->vao.eboSize = 0;
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _cache->vao.ebo));
+    /* the extrusions of strokes that are extruded on the gpu. The attribute is only enabled while
+     * drawing such a stroke, otherwise it is zero */
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_cache->vao.extrusionVbo));
+    _cache->vao.extrusionVboSize = 0;
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _cache->vao.extrusionVbo));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0)));
+
+    _TARP_ASSERT_NO_GL_ERROR(glGenVertexArrays(1, &_cache->textureVao.vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_cache->textureVao.vao));
+    _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_cache->textureVao.vbo));
+    _cache->textureVao.vboSize = 0;
+    _cache->textureVao.ebo = 0;
+    _cache->textureVao.eboSize = 0;
+    _cache->textureVao.extrusionVbo = 0;
+    _cache->textureVao.extrusionVboSize = 0;
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _cache->textureVao.vbo));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)0)));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(0));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(
+        1, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)(2 * sizeof(float)))));
+    _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+
+    /* the buffers are empty, so everything needs to be uploaded */
+    _tpGLRenderCacheMarkDirty(_cache);
 }
 
-TARP_LOCAL void _tpGLDrawPaint(_tpGLContext * _ctx,
-                               const _tpGLRenderCache * _cache,
-                               const tpPaint * _paint,
-                               const _tpGLGradientCacheData * _gradCache)
-{
-    if (_paint->type == kTpPaintTypeColor)
+/*
+uploads the _count elements of _elementSize bytes in _data to the buffer bound to _target, where
+they start at element _offset. If the buffer is too small, it is reallocated and filled completely,
+otherwise only the elements in _ranges are uploaded (or all of them if _bFull is set).
+*/
+TARP_LOCAL void _tpGLUploadRanges(GLenum _target,
+                                  GLuint * _bufferSize,
+                                  const _tpGLDirtyRanges * _ranges,
+                                  tpBool _bFull,
+                                  int _offset,
+                                  const void * _data,
+                                  int _count,
+                                  int _elementSize)
+{
+    int i, start, end;
+    GLuint byteCount = (GLuint)((_offset + _count) * _elementSize);
+
+    if (byteCount > *_bufferSize)
     {
-        _TARP_ASSERT_NO_GL_ERROR(glUniform4fv(_ctx->meshColorLoc, 1, &_paint->data.color.r));
-        _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(GL_TRIANGLE_STRIP, _cache->boundsVertexOffset, 4));
+        /* grow geometrically to not reallocate on every upload of a growing cache */
+        *_bufferSize = TARP_MAX(byteCount, *_bufferSize + *_bufferSize / 2);
+        _TARP_ASSERT_NO_GL_ERROR(glBufferData(_target, *_bufferSize, NULL, GL_DYNAMIC_DRAW));
+        _bFull = tpTrue;
     }
-    else if (_paint->type == kTpPaintTypeGradient)
-    {
-        _tpGLGradient * grad = (_tpGLGradient *)_paint->data.gradientData.gradient.pointer;
 
-        /* bind the gradient's texture */
-        _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
-        _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_1D, grad->rampTexture));
+    if (_bFull)
+    {
+        if (_count)
+            _TARP_ASSERT_NO_GL_ERROR(
+                glBufferSubData(_target, _offset * _elementSize, _count * _elementSize, _data));
+        return;
+    }
 
-        _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->textureProgram));
-        _TARP_ASSERT_NO_GL_ERROR(
-            glUniformMatrix4fv(_ctx->tpTextureLoc, 1, GL_FALSE, &_cache->renderMatrix.v[0]));
-        _TARP_ASSERT_NO_GL_ERROR(
-            glUniform1f(_ctx->opacityTextureLoc, _paint->data.gradientData.opacity));
-        _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->textureVao.vao));
-        _TARP_ASSERT_NO_GL_ERROR(
-            glDrawArrays(GL_TRIANGLE_FAN, _gradCache->vertexOffset, _gradCache->vertexCount));
-        _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
-        _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->vao.vao));
+    for (i = 0; i < _ranges->count; ++i)
+    {
+        start = TARP_MAX(_ranges->starts[i], _offset);
+        end = TARP_MIN(_ranges->ends[i], _offset + _count);
+        if (start < end)
+            _TARP_ASSERT_NO_GL_ERROR(
+                glBufferSubData(_target,
+                                start * _elementSize,
+                                (end - start) * _elementSize,
+                                (const char *)_data + (start - _offset) * _elementSize));
     }
 }
 
-TARP_LOCAL void _tpGLCacheBoundsGeometry(_tpGLRenderCache * _cache, const tpStyle * _style)
+/* makes sure that the gpu buffers of the cache hold its current data and binds its vao */
+TARP_LOCAL void _tpGLRenderCacheUpload(_tpGLRenderCache * _cache)
 {
-    _tpGLRect bounds;
-    _tpGLRect * bptr;
-    tpVec2 boundsData[4];
+    if (!_cache->vao.vao)
+        _tpGLRenderCacheCreateBuffers(_cache);
 
-    _cache->boundsVertexOffset = _cache->geometryCache.count;
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_cache->vao.vao));
+    if (_cache->uploadedGeneration == _cache->generation)
+        return;
 
-    /*
-    add the bounds geometry to the end of the geometry cache.
-    If there is a stroke, upload the stroke bounds instead
-    */
-    if (_style->stroke.type != kTpPaintTypeNone)
-    {
-        tpFloat adder;
-        bounds = _cache->boundsCache;
-        /*
-        for miter we don't calculate a tight bounding box but instead
-        increase it to cover the worst case based on the stroke width and
-        miter limit.
-        @TODO: Make sure that this is actually good enough of a solution
-        */
-        adder = _style->strokeJoin == kTpStrokeJoinMiter
-                    ? _style->miterLimit * _style->strokeWidth * 0.5f
-                    : _style->strokeWidth;
-        bounds.min.x -= adder;
-        bounds.min.y -= adder;
-        bounds.max.x += adder;
-        bounds.max.y += adder;
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _cache->vao.vbo));
+    _tpGLUploadRanges(GL_ARRAY_BUFFER,
+                      &_cache->vao.vboSize,
+                      &_cache->dirtyVertices,
+                      tpFalse,
+                      0,
+                      _cache->geometryCache.array,
+                      _cache->geometryCache.count,
+                      sizeof(tpVec2));
 
-        _cache->strokeBoundsCache = bounds;
-        bptr = &bounds;
-    }
-    else
+    /* the extrusions are uploaded to where the stroke vertices start so that they can be
+     * addressed with the same indices */
+    if (_cache->bExtrudeStrokeOnGPU)
     {
-        bptr = &_cache->boundsCache;
+        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _cache->vao.extrusionVbo));
+        _tpGLUploadRanges(GL_ARRAY_BUFFER,
+                          &_cache->vao.extrusionVboSize,
+                          &_cache->dirtyVertices,
+                          tpFalse,
+                          _cache->strokeVertexOffset,
+                          _cache->extrusionCache.array,
+                          _cache->extrusionCache.count,
+                          sizeof(tpVec2));
+    }
+
+    /* the element buffer is bound to the vao */
+    if (_cache->indexType == GL_UNSIGNED_SHORT)
+        _tpGLUploadRanges(GL_ELEMENT_ARRAY_BUFFER,
+                          &_cache->vao.eboSize,
+                          &_cache->dirtyIndices,
+                          (tpBool)(_cache->uploadedIndexType != GL_UNSIGNED_SHORT),
+                          0,
+                          _cache->shortIndexCache.array,
+                          _cache->shortIndexCache.count,
+                          sizeof(GLushort));
+    else
+        _tpGLUploadRanges(GL_ELEMENT_ARRAY_BUFFER,
+                          &_cache->vao.eboSize,
+                          &_cache->dirtyIndices,
+                          (tpBool)(_cache->uploadedIndexType != GL_UNSIGNED_INT),
+                          0,
+                          _cache->indexCache.array,
+                          _cache->indexCache.count,
+                          sizeof(GLuint));
+
+    if (_cache->bTextureGeometryDirty)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _cache->textureVao.vbo));
+        _tpGLUploadRanges(GL_ARRAY_BUFFER,
+                          &_cache->textureVao.vboSize,
+                          NULL,
+                          tpTrue,
+                          0,
+                          _cache->textureGeometryCache.array,
+                          _cache->textureGeometryCache.count,
+                          sizeof(_tpGLTextureVertex));
+    }
+
+    _cache->uploadedIndexType = _cache->indexType;
+    _cache->dirtyVertices.count = 0;
+    _cache->dirtyIndices.count = 0;
+    _cache->bTextureGeometryDirty = tpFalse;
+    _cache->uploadedGeneration = _cache->generation;
+}
+
+/*
+reserves _byteCount bytes in the ring buffer (which needs to be bound to GL_ARRAY_BUFFER) and
+returns their offset in the buffer.
+*/
+TARP_LOCAL GLsizeiptr _tpGLStreamBufferReserve(_tpGLStreamBuffer * _stream, GLsizeiptr _byteCount)
+{
+    GLsizeiptr ret, size;
+
+    if (_stream->head + _byteCount > _stream->end)
+    {
+        size = _stream->sectionSize * TARP_GL_STREAM_FRAME_COUNT;
+        if (_stream->mapped || _byteCount > size)
+        {
+            /* the section of this frame is full, replace the buffer with a bigger one */
+            _tpGLStreamBufferAllocate(
+                _stream, TARP_MAX(_stream->sectionSize * 2, _byteCount + _byteCount / 2));
+        }
+        else
+        {
+            /* orphan the storage, draws that still read from it are not affected */
+            _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW));
+            _stream->head = 0;
+        }
+    }
+
+    ret = _stream->head;
+    /* keep every block 16 byte aligned */
+    _stream->head += (_byteCount + 15) & ~((GLsizeiptr)15);
+    return ret;
+}
+
+TARP_LOCAL void _tpGLStreamBufferWrite(_tpGLStreamBuffer * _stream,
+                                       GLsizeiptr _offset,
+                                       const void * _data,
+                                       GLsizeiptr _byteCount)
+{
+    if (!_byteCount)
+        return;
+    if (_stream->mapped)
+        memcpy(_stream->mapped + _offset, _data, _byteCount);
+    else
+        _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER, _offset, _byteCount, _data));
+}
+
+/*
+writes the geometry of the cache to the ring buffer and points the vaos of the ring buffer at it.
+The blocks are laid out as vertices, extrusions, indices and texture vertices.
+*/
+TARP_LOCAL void _tpGLStreamRenderCache(_tpGLContext * _ctx, const _tpGLRenderCache * _cache)
+{
+    _tpGLStreamBuffer * stream = &_ctx->stream;
+    GLsizeiptr vertexBytes, extrusionBytes, indexBytes, paddedIndexBytes, textureBytes, offset;
+    const void * indices;
+
+    vertexBytes = _cache->geometryCache.count * sizeof(tpVec2);
+    extrusionBytes =
+        _cache->bExtrudeStrokeOnGPU ? _cache->extrusionCache.count * sizeof(tpVec2) : 0;
+    if (_cache->indexType == GL_UNSIGNED_SHORT)
+    {
+        indices = _cache->shortIndexCache.array;
+        indexBytes = _cache->shortIndexCache.count * sizeof(GLushort);
+    }
+    else
+    {
+        indices = _cache->indexCache.array;
+        indexBytes = _cache->indexCache.count * sizeof(GLuint);
+    }
+    /* keep the texture vertices aligned after 16 bit indices */
+    paddedIndexBytes = (indexBytes + 3) & ~((GLsizeiptr)3);
+    textureBytes = _cache->textureGeometryCache.count * sizeof(_tpGLTextureVertex);
+
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, stream->buffer));
+    offset = _tpGLStreamBufferReserve(
+        stream, vertexBytes + extrusionBytes + paddedIndexBytes + textureBytes);
+
+    _tpGLStreamBufferWrite(stream, offset, _cache->geometryCache.array, vertexBytes);
+    _tpGLStreamBufferWrite(
+        stream, offset + vertexBytes, _cache->extrusionCache.array, extrusionBytes);
+    _tpGLStreamBufferWrite(stream, offset + vertexBytes + extrusionBytes, indices, indexBytes);
+    _tpGLStreamBufferWrite(stream,
+                           offset + vertexBytes + extrusionBytes + paddedIndexBytes,
+                           _cache->textureGeometryCache.array,
+                           textureBytes);
+
+    if (textureBytes)
+    {
+        offset += vertexBytes + extrusionBytes + paddedIndexBytes;
+        _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(stream->textureVao));
+        _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(
+            0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(tpFloat), ((char *)0) + offset));
+        _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(1,
+                                                       1,
+                                                       GL_FLOAT,
+                                                       GL_FALSE,
+                                                       4 * sizeof(tpFloat),
+                                                       ((char *)0) + offset + 2 * sizeof(float)));
+        offset -= vertexBytes + extrusionBytes + paddedIndexBytes;
+    }
+
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(stream->vao));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0) + offset));
+    /* the extrusions are addressed with the same indices as the stroke vertices they belong to */
+    if (extrusionBytes)
+        _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(
+            1,
+            2,
+            GL_FLOAT,
+            GL_FALSE,
+            0,
+            ((char *)0) + offset + vertexBytes - _cache->strokeVertexOffset * sizeof(tpVec2)));
+
+    _ctx->drawVao = stream->vao;
+    _ctx->drawTextureVao = stream->textureVao;
+    _ctx->drawIndexOffset = offset + vertexBytes + extrusionBytes;
+}
+
+/* makes the geometry of the cache available to the draw calls that follow and binds its vao */
+TARP_LOCAL void _tpGLBindRenderCache(_tpGLContext * _ctx, _tpGLRenderCache * _cache)
+{
+    if (_ctx->uploadMode == kTpGeometryUploadModeStreaming)
+    {
+        _tpGLStreamRenderCache(_ctx, _cache);
+        return;
+    }
+
+    _tpGLRenderCacheUpload(_cache);
+    _ctx->drawVao = _cache->vao.vao;
+    _ctx->drawTextureVao = _cache->textureVao.vao;
+    _ctx->drawIndexOffset = 0;
+}
+
+TARP_LOCAL void _tpGLDrawPaint(_tpGLContext * _ctx,
+                               const _tpGLRenderCache * _cache,
+                               const tpPaint * _paint,
+                               const _tpGLGradientCacheData * _gradCache,
+                               const _tpGLIntArray * _coverFirsts,
+                               const _tpGLSizeiArray * _coverCounts)
+{
+    if (_paint->type == kTpPaintTypeColor)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glUniform4fv(_ctx->meshColorLoc, 1, &_paint->data.color.r));
+        _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(
+            GL_TRIANGLE_FAN, _coverFirsts->array, _coverCounts->array, _coverFirsts->count));
+    }
+    else if (_paint->type == kTpPaintTypeGradient)
+    {
+        _tpGLGradient * grad = (_tpGLGradient *)_paint->data.gradientData.gradient.pointer;
+
+        /* bind the gradient's texture, uploading the ramp if the color stops changed */
+        if (grad->bRampDirty)
+        {
+            grad->bRampDirty = tpFalse;
+            _tpGLUpdateRampTexture(grad);
+        }
+        else
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
+            _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_1D, grad->rampTexture));
+        }
+
+        _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->textureProgram));
+        _TARP_ASSERT_NO_GL_ERROR(
+            glUniformMatrix4fv(_ctx->tpTextureLoc, 1, GL_FALSE, &_cache->renderMatrix.v[0]));
+        _TARP_ASSERT_NO_GL_ERROR(
+            glUniform1f(_ctx->opacityTextureLoc, _paint->data.gradientData.opacity));
+        _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->drawTextureVao));
+        _TARP_ASSERT_NO_GL_ERROR(
+            glDrawArrays(GL_TRIANGLE_FAN, _gradCache->vertexOffset, _gradCache->vertexCount));
+        _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
+        _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(_ctx->drawVao));
+    }
+}
+
+/* the extents of a set of points along x, y, x + y and x - y. The octagon they span is a cheap
+ * approximation of the convex hull of the points */
+typedef struct TARP_LOCAL
+{
+    tpFloat min[4];
+    tpFloat max[4];
+} _tpGLCoverExtents;
+
+TARP_LOCAL void _tpGLCoverExtentsInit(_tpGLCoverExtents * _ext)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+    {
+        _ext->min[i] = FLT_MAX;
+        _ext->max[i] = -FLT_MAX;
+    }
+}
+
+TARP_LOCAL void _tpGLCoverExtentsAdd(_tpGLCoverExtents * _ext, tpVec2 _p)
+{
+    int i;
+    tpFloat v[4];
+
+    v[0] = _p.x;
+    v[1] = _p.y;
+    v[2] = _p.x + _p.y;
+    v[3] = _p.x - _p.y;
+    /* degenerate stroke geometry can contain NaNs, which the comparisons below skip */
+    for (i = 0; i < 4; ++i)
+    {
+        _ext->min[i] = TARP_MIN(v[i], _ext->min[i]);
+        _ext->max[i] = TARP_MAX(v[i], _ext->max[i]);
+    }
+}
+
+TARP_LOCAL void _tpGLCoverExtentsMerge(_tpGLCoverExtents * _ext, const _tpGLCoverExtents * _other)
+{
+    int i;
+    for (i = 0; i < 4; ++i)
+    {
+        _ext->min[i] = TARP_MIN(_ext->min[i], _other->min[i]);
+        _ext->max[i] = TARP_MAX(_ext->max[i], _other->max[i]);
+    }
+}
+
+/* computes the corners of the octagon spanned by _ext in counter clockwise order and returns its
+ * area. The octagon is padded a tiny bit so that rounding can't leave a covered pixel outside */
+TARP_LOCAL tpFloat _tpGLCoverOctagon(const _tpGLCoverExtents * _ext, tpVec2 * _outCorners)
+{
+    int i;
+    tpFloat pad, minX, minY, maxX, maxY, minS, maxS, minD, maxD, area;
+
+    pad = 1e-5f * (1.0f + TARP_MAX(TARP_MAX(fabs(_ext->min[0]), fabs(_ext->max[0])),
+                                   TARP_MAX(fabs(_ext->min[1]), fabs(_ext->max[1]))));
+    minX = _ext->min[0] - pad;
+    minY = _ext->min[1] - pad;
+    maxX = _ext->max[0] + pad;
+    maxY = _ext->max[1] + pad;
+    minS = _ext->min[2] - pad * 2.0f;
+    maxS = _ext->max[2] + pad * 2.0f;
+    minD = _ext->min[3] - pad * 2.0f;
+    maxD = _ext->max[3] + pad * 2.0f;
+
+    _outCorners[0] = tpVec2Make(minX, minS - minX);
+    _outCorners[1] = tpVec2Make(minS - minY, minY);
+    _outCorners[2] = tpVec2Make(maxD + minY, minY);
+    _outCorners[3] = tpVec2Make(maxX, maxX - maxD);
+    _outCorners[4] = tpVec2Make(maxX, maxS - maxX);
+    _outCorners[5] = tpVec2Make(maxS - maxY, maxY);
+    _outCorners[6] = tpVec2Make(minD + maxY, maxY);
+    _outCorners[7] = tpVec2Make(minX, minX - minD);
+
+    area = 0;
+    for (i = 0; i < 8; ++i)
+        area += tpVec2Cross(_outCorners[i], _outCorners[(i + 1) % 8]);
+    return area * 0.5f;
+}
+
+/*
+appends the fans that cover either the fill or the stroke vertices of the cache to the end of the
+geometry cache. Every contour gets its own octagon if that covers considerably less area than a
+single octagon around everything, i.e. for shapes made of several disjoint parts. The bounds of the
+vertices of every contour are merged into _outContourBounds if it is not NULL.
+*/
+TARP_LOCAL void _tpGLCacheCoverGeometry(_tpGLRenderCache * _cache,
+                                        tpBool _bStroke,
+                                        _tpGLIntArray * _outFirsts,
+                                        _tpGLSizeiArray * _outCounts,
+                                        _tpGLRect * _outBounds,
+                                        _tpGLRect * _outContourBounds)
+{
+    int i, j, offset, count, total;
+    tpFloat area;
+    tpVec2 p, corners[8];
+    _tpGLRect bounds;
+    _tpGLCoverExtents ext, whole;
+    _tpGLCoverExtents contourExtents[TARP_GL_MAX_COVER_CONTOURS];
+    _tpGLRenderCacheContour * c;
+    const tpVec2 * extrusions;
+    tpBool bPerContour;
+
+    /* stroke vertices that are extruded on the gpu are covered at their final position */
+    extrusions = _bStroke && _cache->bExtrudeStrokeOnGPU ? _cache->extrusionCache.array : NULL;
+
+    _tpGLCoverExtentsInit(&whole);
+    area = 0;
+    total = 0;
+    for (i = 0; i < _cache->contours.count; ++i)
+    {
+        c = &_cache->contours.array[i];
+        offset = _bStroke ? c->strokeVertexOffset : c->fillVertexOffset;
+        count = _bStroke ? c->strokeVertexCount : c->fillVertexCount;
+        _tpGLCoverExtentsInit(&ext);
+        for (j = offset; j < offset + count; ++j)
+        {
+            p = _cache->geometryCache.array[j];
+            if (extrusions)
+                p = tpVec2Add(p,
+                              tpVec2MultScalar(extrusions[j - _cache->strokeVertexOffset],
+                                               _cache->strokeHalfWidth));
+            _tpGLCoverExtentsAdd(&ext, p);
+        }
+        if (_outContourBounds && count)
+        {
+            bounds.min = tpVec2Make(ext.min[0], ext.min[1]);
+            bounds.max = tpVec2Make(ext.max[0], ext.max[1]);
+            _tpGLMergeBounds(&_outContourBounds[i], &bounds);
+        }
+        if (i < TARP_GL_MAX_COVER_CONTOURS)
+        {
+            contourExtents[i] = ext;
+            if (count)
+                area += _tpGLCoverOctagon(&ext, corners);
+        }
+        _tpGLCoverExtentsMerge(&whole, &ext);
+        total += count;
+    }
+
+    _tpGLIntArrayClear(_outFirsts);
+    _tpGLSizeiArrayClear(_outCounts);
+    if (!total)
+        return;
+
+    bPerContour = (tpBool)(_cache->contours.count > 1 &&
+                           _cache->contours.count <= TARP_GL_MAX_COVER_CONTOURS &&
+                           area < _tpGLCoverOctagon(&whole, corners) * 0.75f);
+    for (i = 0; i < (bPerContour ? _cache->contours.count : 1); ++i)
+    {
+        c = &_cache->contours.array[i];
+        if (bPerContour && !(_bStroke ? c->strokeVertexCount : c->fillVertexCount))
+            continue;
+        _tpGLCoverOctagon(bPerContour ? &contourExtents[i] : &whole, corners);
+        _tpGLIntArrayAppend(_outFirsts, _cache->geometryCache.count);
+        _tpGLSizeiArrayAppend(_outCounts, 8);
+        _tpVec2ArrayAppendCArray(&_cache->geometryCache, corners, 8);
+    }
+
+    _outBounds->min = tpVec2Make(whole.min[0], whole.min[1]);
+    _outBounds->max = tpVec2Make(whole.max[0], whole.max[1]);
+}
+
+/* the cells of the contour grid of _cache that _bounds overlap as min x, min y, max x and max y.
+ * Returns tpFalse if _bounds lie outside of the grid */
+TARP_LOCAL tpBool _tpGLContourGridRange(const _tpGLRenderCache * _cache,
+                                        const _tpGLRect * _bounds,
+                                        int * _outRange)
+{
+    const _tpGLRect * grid = &_cache->contourGridBounds;
+    tpFloat size = (tpFloat)_cache->contourGridSize;
+    tpFloat scaleX = size / TARP_MAX(grid->max.x - grid->min.x, FLT_MIN);
+    tpFloat scaleY = size / TARP_MAX(grid->max.y - grid->min.y, FLT_MIN);
+
+    if (_bounds->min.x > grid->max.x || _bounds->max.x < grid->min.x ||
+        _bounds->min.y > grid->max.y || _bounds->max.y < grid->min.y)
+        return tpFalse;
+
+    /* clamp before converting, the scale is huge for grids without extent */
+    _outRange[0] = (int)TARP_CLAMP((_bounds->min.x - grid->min.x) * scaleX, 0.0f, size - 1.0f);
+    _outRange[1] = (int)TARP_CLAMP((_bounds->min.y - grid->min.y) * scaleY, 0.0f, size - 1.0f);
+    _outRange[2] = (int)TARP_CLAMP((_bounds->max.x - grid->min.x) * scaleX, 0.0f, size - 1.0f);
+    _outRange[3] = (int)TARP_CLAMP((_bounds->max.y - grid->min.y) * scaleY, 0.0f, size - 1.0f);
+    return tpTrue;
+}
+
+/* builds the contour grid of the cache from its contour bounds. Every contour is added to all the
+ * cells that its bounds overlap */
+TARP_LOCAL void _tpGLRenderCacheBuildContourGrid(_tpGLRenderCache * _cache)
+{
+    int i, x, y, cell, cellCount, range[4];
+    int * cells;
+    const _tpGLRect * bounds;
+
+    _cache->contourGridSize = 0;
+    _tpGLIntArrayClear(&_cache->contourGridCells);
+    _tpGLIntArrayClear(&_cache->contourGridItems);
+
+    _tpGLInitBounds(&_cache->contourGridBounds);
+    for (i = 0; i < _cache->contourBounds.count; ++i)
+    {
+        bounds = &_cache->contourBounds.array[i];
+        if (bounds->min.x <= bounds->max.x)
+            _tpGLMergeBounds(&_cache->contourGridBounds, bounds);
+    }
+    if (_cache->contourGridBounds.min.x > _cache->contourGridBounds.max.x)
+        return;
+
+    /* roughly four contours per cell */
+    _cache->contourGridSize =
+        TARP_CLAMP((int)sqrt(_cache->contours.count * 0.25), 1, TARP_GL_MAX_CONTOUR_GRID_SIZE);
+    cellCount = _cache->contourGridSize * _cache->contourGridSize;
+    _tpGLIntArrayReserveAdditional(&_cache->contourGridCells, cellCount + 1);
+    cells = _cache->contourGridCells.array;
+    memset(cells, 0, sizeof(int) * (cellCount + 1));
+    _cache->contourGridCells.count = cellCount + 1;
+
+    /* count the contours of every cell and turn the counts into the end of the cell */
+    for (i = 0; i < _cache->contourBounds.count; ++i)
+    {
+        bounds = &_cache->contourBounds.array[i];
+        if (bounds->min.x > bounds->max.x || !_tpGLContourGridRange(_cache, bounds, range))
+            continue;
+        for (y = range[1]; y <= range[3]; ++y)
+        {
+            for (x = range[0]; x <= range[2]; ++x)
+                cells[y * _cache->contourGridSize + x + 1]++;
+        }
+    }
+    for (cell = 1; cell <= cellCount; ++cell)
+        cells[cell] += cells[cell - 1];
+
+    /* fill the cells back to front, which leaves every cell pointing at its start */
+    _tpGLIntArrayReserveAdditional(&_cache->contourGridItems, cells[cellCount]);
+    _cache->contourGridItems.count = cells[cellCount];
+    for (i = 0; i < _cache->contourBounds.count; ++i)
+    {
+        bounds = &_cache->contourBounds.array[i];
+        if (bounds->min.x > bounds->max.x || !_tpGLContourGridRange(_cache, bounds, range))
+            continue;
+        for (y = range[1]; y <= range[3]; ++y)
+        {
+            for (x = range[0]; x <= range[2]; ++x)
+            {
+                cell = y * _cache->contourGridSize + x + 1;
+                _cache->contourGridItems.array[--cells[cell]] = i;
+            }
+        }
+    }
+    for (cell = 0; cell < cellCount; ++cell)
+        cells[cell] = cells[cell + 1];
+    cells[cellCount] = _cache->contourGridItems.count;
+}
+
+/* adds the cover geometry of the fill and stroke to the end of the geometry cache and caches the
+ * exact bounds of the stroke and the contour grid */
+TARP_LOCAL void _tpGLCacheBoundsGeometry(_tpGLRenderCache * _cache, const tpStyle * _style)
+{
+    int i;
+    _tpGLRect bounds;
+    _tpGLRect * contourBounds;
+
+    /* the contour bounds are only needed for the contour grid */
+    _tpGLRectArrayClear(&_cache->contourBounds);
+    contourBounds = NULL;
+    if (_cache->contours.count >= TARP_GL_MIN_CULLED_CONTOURS)
+    {
+        _tpGLRectArrayReserveAdditional(&_cache->contourBounds, _cache->contours.count);
+        _cache->contourBounds.count = _cache->contours.count;
+        contourBounds = _cache->contourBounds.array;
+        for (i = 0; i < _cache->contours.count; ++i)
+            _tpGLInitBounds(&contourBounds[i]);
+    }
+
+    _cache->boundsVertexOffset = _cache->geometryCache.count;
+    _tpGLCacheCoverGeometry(_cache,
+                            tpFalse,
+                            &_cache->fillCoverFirsts,
+                            &_cache->fillCoverCounts,
+                            &bounds,
+                            contourBounds);
+    if (_style->stroke.type != kTpPaintTypeNone && _cache->strokeVertexCount)
+    {
+        _tpGLCacheCoverGeometry(_cache,
+                                tpTrue,
+                                &_cache->strokeCoverFirsts,
+                                &_cache->strokeCoverCounts,
+                                &_cache->strokeBoundsCache,
+                                contourBounds);
+    }
+    else
+    {
+        _tpGLIntArrayClear(&_cache->strokeCoverFirsts);
+        _tpGLSizeiArrayClear(&_cache->strokeCoverCounts);
     }
 
-    boundsData[0] = bptr->min;
-    boundsData[1] = tpVec2Make(bptr->min.x, bptr->max.y);
-    boundsData[2] = tpVec2Make(bptr->max.x, bptr->min.y);
-    boundsData[3] = bptr->max;
+    if (_cache->geometryCache.count > _cache->boundsVertexOffset)
+        _tpGLRenderCacheMarkDirtyVertices(
+            _cache, _cache->boundsVertexOffset, _cache->geometryCache.count);
 
-    _tpVec2ArrayAppendCArray(&_cache->geometryCache, boundsData, 4);
+    _tpGLRenderCacheBuildContourGrid(_cache);
 }
 
 typedef struct TARP_LOCAL
@@ -3646,7 +6850,7 @@ typedef struct TARP_LOCAL
     tpFloat tc;
 } TexVertex;
 
-TARP_LOCAL void _tpGLGradientLinearGeometry(_tpGLContext * _ctx,
+TARP_LOCAL void _tpGLGradientLinearGeometry(_tpGLGeometryBuilder * _builder,
                                             _tpGLGradient * _grad,
                                             const tpTransform * _paintTransform,
                                             const _tpGLRect * _bounds,
@@ -3670,8 +6874,8 @@ TARP_LOCAL void _tpGLGradientLinearGeometry(_tpGLContext * _ctx,
     geometry, too! */
     if (!_bIsScalingStroke)
     {
-        origin = tpTransformApply(&_ctx->transform, origin);
-        dest = tpTransformApply(&_ctx->transform, dest);
+        origin = tpTransformApply(&_builder->transform, origin);
+        dest = tpTransformApply(&_builder->transform, dest);
     }
 
     dir = tpVec2Sub(dest, origin);
@@ -3721,7 +6925,7 @@ TARP_LOCAL tpFloat _tpInvLerp(tpFloat _a, tpFloat _b, tpFloat _x)
     return (_x - _a) / (_b - _a);
 }
 
-TARP_LOCAL void _tpGLGradientRadialGeometry(_tpGLContext * _ctx,
+TARP_LOCAL void _tpGLGradientRadialGeometry(_tpGLGeometryBuilder * _builder,
                                             _tpGLGradient * _grad,
                                             const tpTransform * _paintTransform,
                                             const _tpGLRect * _bounds,
@@ -3747,7 +6951,7 @@ TARP_LOCAL void _tpGLGradientRadialGeometry(_tpGLContext * _ctx,
     ellipse = tpTransformCombine(_paintTransform, &ellipse);
 
     if (!_bIsScalingStroke)
-        ellipse = tpTransformCombine(&_ctx->transform, &ellipse);
+        ellipse = tpTransformCombine(&_builder->transform, &ellipse);
 
     a = tpVec2Make(ellipse.m.v[0], ellipse.m.v[1]);
     b = tpVec2Make(ellipse.m.v[2], ellipse.m.v[3]);
@@ -3761,7 +6965,7 @@ TARP_LOCAL void _tpGLGradientRadialGeometry(_tpGLContext * _ctx,
     focalPoint = tpTransformApply(_paintTransform, tmp);
 
     if (!_bIsScalingStroke)
-        focalPoint = tpTransformApply(&_ctx->transform, focalPoint);
+        focalPoint = tpTransformApply(&_builder->transform, focalPoint);
 
     /* avoid numerical instabilities for gradients of near-zero size */
     /* @TODO: The values of 0.1 are somewhat arbitrarily chosen. This might
@@ -3921,7 +7125,7 @@ TARP_LOCAL void _tpGLGradientRadialGeometry(_tpGLContext * _ctx,
     _tpGLTextureVertexArrayAppendCArray(_vertices, vertices, vertexCount);
 }
 
-TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLContext * _ctx,
+TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLGeometryBuilder * _builder,
                                            _tpGLGradient * _grad,
                                            _tpGLTextureVertexArray * _oldVertices,
                                            _tpGLGradientCacheData * _gradCache,
@@ -3936,11 +7140,10 @@ TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLContext * _ctx,
     {
         grad->bDirty = tpFalse;
         /* ensure that the color stops are valid/complete */
-        _tpGLFinalizeColorStops(_ctx, grad);
-        /* update the ramp texture */
-        /* TODO: update the ramp texture separately just before drawing to
-         * avoid multiple texture binds */
-        _tpGLUpdateRampTexture(grad);
+        _tpGLFinalizeColorStops(_builder, grad);
+        /* the ramp texture is updated in _tpGLDrawPaint, as the geometry might not be generated
+         * on the thread that owns the gl context */
+        grad->bRampDirty = tpTrue;
         _oldVertices = NULL;
     }
 
@@ -3951,7 +7154,7 @@ TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLContext * _ctx,
         /* rebuild the gradient */
         if (grad->type == kTpGradientTypeLinear)
         {
-            _tpGLGradientLinearGeometry(_ctx,
+            _tpGLGradientLinearGeometry(_builder,
                                         grad,
                                         _paintTransform,
                                         _gradCache->bounds,
@@ -3962,7 +7165,7 @@ TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLContext * _ctx,
         }
         else if (grad->type == kTpGradientTypeRadial)
         {
-            _tpGLGradientRadialGeometry(_ctx,
+            _tpGLGradientRadialGeometry(_builder,
                                         grad,
                                         _paintTransform,
                                         _gradCache->bounds,
@@ -3982,110 +7185,914 @@ TARP_LOCAL void _tpGLCacheGradientGeometry(_tpGLContext * _ctx,
     }
 }
 
-TARP_API tpBool tpPrepareDrawing(tpContext _ctx)
+/* the bounds of the cover geometry of the cache in normalized device coordinates if it is
+ * rendered with _matrix */
+TARP_LOCAL _tpGLRect _tpGLRenderCacheDeviceBoundsWithMatrix(const _tpGLRenderCache * _cache,
+                                                            const tpMat4 * _matrix)
 {
-    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
-
-    /* cache previous render state so we can reset it in tpFinishDrawing */
-    glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint *)&ctx->stateBackup.activeTexture);
-    ctx->stateBackup.depthTest = glIsEnabled(GL_DEPTH_TEST);
-    glGetBooleanv(GL_DEPTH_WRITEMASK, &ctx->stateBackup.depthMask);
-    ctx->stateBackup.multisample = glIsEnabled(GL_MULTISAMPLE);
-    ctx->stateBackup.stencilTest = glIsEnabled(GL_STENCIL_TEST);
-    glGetIntegerv(GL_STENCIL_WRITEMASK, (GLint *)&ctx->stateBackup.stencilMask);
-    glGetIntegerv(GL_STENCIL_FAIL, (GLint *)&ctx->stateBackup.stencilFail);
-    glGetIntegerv(GL_STENCIL_PASS_DEPTH_PASS, (GLint *)&ctx->stateBackup.stencilPassDepthPass);
-    glGetIntegerv(GL_STENCIL_PASS_DEPTH_FAIL, (GLint *)&ctx->stateBackup.stencilPassDepthFail);
-    glGetIntegerv(GL_STENCIL_CLEAR_VALUE, (GLint *)&ctx->stateBackup.clearStencil);
-    ctx->stateBackup.blending = glIsEnabled(GL_BLEND);
-    glGetIntegerv(GL_BLEND_SRC_RGB, (GLint *)&ctx->stateBackup.blendSrcRGB);
-    glGetIntegerv(GL_BLEND_DST_RGB, (GLint *)&ctx->stateBackup.blendDestRGB);
-    glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint *)&ctx->stateBackup.blendSrcAlpha);
-    glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint *)&ctx->stateBackup.blendDestAlpha);
-    glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint *)&ctx->stateBackup.blendEquationRGB);
-    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint *)&ctx->stateBackup.blendEquationAlpha);
-    ctx->stateBackup.cullFace = glIsEnabled(GL_CULL_FACE);
-    glGetIntegerv(GL_CULL_FACE_MODE, (GLint *)&ctx->stateBackup.cullFaceMode);
-    glGetIntegerv(GL_FRONT_FACE, (GLint *)&ctx->stateBackup.frontFace);
-    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint *)&ctx->stateBackup.vao);
-    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint *)&ctx->stateBackup.vbo);
-    glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *)&ctx->stateBackup.program);
-
-    _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
-
-    _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_DEPTH_TEST));
-    _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_FALSE));
-    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_MULTISAMPLE));
-
-    /* @TODO: Support different ways of blending?? */
-    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_BLEND));
-    _TARP_ASSERT_NO_GL_ERROR(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
-
-    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_STENCIL_TEST));
-    _TARP_ASSERT_NO_GL_ERROR(
-        glStencilMask(_kTpGLFillRasterStencilPlane | _kTpGLClippingStencilPlaneOne |
-                      _kTpGLClippingStencilPlaneTwo | _kTpGLStrokeRasterStencilPlane));
-    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
-    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
-
-    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(ctx->vao.vao));
-    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, ctx->vao.vbo));
-
-    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(ctx->program));
+    int i;
+    _tpGLRect ret;
+    const tpFloat * m = _matrix->v;
+    tpVec2 p;
+    tpFloat w;
 
-    ctx->bCanSwapStencilPlanes = tpTrue;
-    ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
-    ctx->clippingStackDepth = 0; /* reset clipping */
+    _tpGLInitBounds(&ret);
+    for (i = _cache->boundsVertexOffset; i < _cache->geometryCache.count; ++i)
+    {
+        p = _cache->geometryCache.array[i];
+        w = m[3] * p.x + m[7] * p.y + m[15];
+        if (w <= 0)
+        {
+            /* behind the camera, treat it as covering everything */
+            ret.min = tpVec2Make(-FLT_MAX, -FLT_MAX);
+            ret.max = tpVec2Make(FLT_MAX, FLT_MAX);
+            return ret;
+        }
+        _tpGLEvaluatePointForBounds(tpVec2Make((m[0] * p.x + m[4] * p.y + m[12]) / w,
+                                               (m[1] * p.x + m[5] * p.y + m[13]) / w),
+                                    &ret);
+    }
+    return ret;
+}
 
-    return tpFalse;
+/* the bounds of the cover geometry of the cache in normalized device coordinates */
+TARP_LOCAL _tpGLRect _tpGLRenderCacheDeviceBounds(const _tpGLRenderCache * _cache)
+{
+    return _tpGLRenderCacheDeviceBoundsWithMatrix(_cache, &_cache->renderMatrix);
 }
 
-TARP_API tpBool tpFinishDrawing(tpContext _ctx)
+TARP_LOCAL void _tpGLIntersectBounds(_tpGLRect * _a, const _tpGLRect * _b)
 {
-    /* reset gl state to what it was before we began drawing */
-    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _a->min.x = TARP_MAX(_a->min.x, _b->min.x);
+    _a->min.y = TARP_MAX(_a->min.y, _b->min.y);
+    _a->max.x = TARP_MIN(_a->max.x, _b->max.x);
+    _a->max.y = TARP_MIN(_a->max.y, _b->max.y);
+}
 
-    /* we dont assert gl errors here for now...should we? */
-    glActiveTexture(ctx->stateBackup.activeTexture);
-    ctx->stateBackup.depthTest ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
-    glDepthMask(ctx->stateBackup.depthMask);
-    ctx->stateBackup.multisample ? glEnable(GL_MULTISAMPLE) : glDisable(GL_MULTISAMPLE);
-    ctx->stateBackup.stencilTest ? glEnable(GL_STENCIL_TEST) : glDisable(GL_STENCIL_TEST);
-    glStencilMask(ctx->stateBackup.stencilMask);
-    glStencilOp(ctx->stateBackup.stencilFail,
-                ctx->stateBackup.stencilPassDepthPass,
-                ctx->stateBackup.stencilPassDepthFail);
-    glClearStencil(ctx->stateBackup.clearStencil);
-    ctx->stateBackup.blending ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
-    glBlendFuncSeparate(ctx->stateBackup.blendSrcRGB,
-                        ctx->stateBackup.blendDestRGB,
-                        ctx->stateBackup.blendSrcAlpha,
-                        ctx->stateBackup.blendDestAlpha);
-    glBlendEquationSeparate(ctx->stateBackup.blendEquationRGB, ctx->stateBackup.blendEquationAlpha);
+/* sets the clip bounds of the context to the viewport, intersected with the scissor box if the
+ * scissor test is enabled */
+TARP_LOCAL void _tpGLResetClipBounds(_tpGLContext * _ctx)
+{
+    _tpGLRect box;
+    const GLint * vp = _ctx->viewport;
+    const GLint * sb = _ctx->scissorBox;
 
-    ctx->stateBackup.cullFace ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
-    glCullFace(ctx->stateBackup.cullFaceMode);
-    glFrontFace(ctx->stateBackup.frontFace);
-    glBindVertexArray(ctx->stateBackup.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, ctx->stateBackup.vbo);
-    glUseProgram(ctx->stateBackup.program);
+    _ctx->clipBounds.min = tpVec2Make(-1.0f, -1.0f);
+    _ctx->clipBounds.max = tpVec2Make(1.0f, 1.0f);
+    if (_ctx->bScissorTest && vp[2] > 0 && vp[3] > 0)
+    {
+        box.min.x = (sb[0] - vp[0]) * 2.0f / vp[2] - 1.0f;
+        box.min.y = (sb[1] - vp[1]) * 2.0f / vp[3] - 1.0f;
+        box.max.x = (sb[0] + sb[2] - vp[0]) * 2.0f / vp[2] - 1.0f;
+        box.max.y = (sb[1] + sb[3] - vp[1]) * 2.0f / vp[3] - 1.0f;
+        _tpGLIntersectBounds(&_ctx->clipBounds, &box);
+    }
+}
 
-    return tpFalse;
+/* checks if _deviceBounds lie completely outside of the clip bounds of the context, in which case
+ * nothing inside of them can be visible */
+TARP_LOCAL tpBool _tpGLIsCulled(const _tpGLContext * _ctx, const _tpGLRect * _deviceBounds)
+{
+    return (tpBool)(_deviceBounds->min.x > _ctx->clipBounds.max.x ||
+                    _deviceBounds->max.x < _ctx->clipBounds.min.x ||
+                    _deviceBounds->min.y > _ctx->clipBounds.max.y ||
+                    _deviceBounds->max.y < _ctx->clipBounds.min.y);
 }
 
-TARP_LOCAL void _tpGLPrepareStencilPlanes(_tpGLContext * _ctx,
-                                          tpBool _bIsClippingPath,
-                                          int * _outTargetStencilPlane,
-                                          int * _outTestStencilPlane)
+/* checks if a cache can be drawn as part of a batch at all */
+TARP_LOCAL tpBool _tpGLDrawBatchCanContain(const _tpGLRenderCache * _cache)
 {
-    *_outTargetStencilPlane =
-        _bIsClippingPath ? _ctx->currentClipStencilPlane : _kTpGLFillRasterStencilPlane;
-    *_outTestStencilPlane = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne
-                                ? _kTpGLClippingStencilPlaneTwo
-                                : _kTpGLClippingStencilPlaneOne;
+    return (tpBool)((_cache->style.fill.type != kTpPaintTypeGradient) &&
+                    (_cache->style.stroke.type != kTpPaintTypeGradient));
 }
 
-TARP_API tpBool _tpGLCachePathImpl(_tpGLContext * _ctx,
+/* checks if a cache can be added to the draws that are already in the batch */
+TARP_LOCAL tpBool _tpGLDrawBatchIsCompatible(const _tpGLDrawBatch * _batch,
+                                             const _tpGLRenderCache * _cache,
+                                             const _tpGLRect * _deviceBounds)
+{
+    int i;
+    const _tpGLRect * b;
+
+    if (!_batch->drawCount)
+        return tpTrue;
+    if (_batch->drawCount >= TARP_GL_MAX_BATCH_DRAWS)
+        return tpFalse;
+    /* all fills of a batch are rasterized with the same stencil operations */
+    if (_cache->style.fill.type != kTpPaintTypeNone && _batch->fillFirsts.count &&
+        _cache->style.fillRule != _batch->fillRule)
+        return tpFalse;
+
+    /* the draws of a batch share the stencil planes, so they must not overlap */
+    for (i = 0; i < _batch->deviceBounds.count; ++i)
+    {
+        b = &_batch->deviceBounds.array[i];
+        if (_deviceBounds->min.x <= b->max.x && b->min.x <= _deviceBounds->max.x &&
+            _deviceBounds->min.y <= b->max.y && b->min.y <= _deviceBounds->max.y)
+            return tpFalse;
+    }
+    return tpTrue;
+}
+
+/* copies the geometry of the cache to the batch */
+TARP_LOCAL void _tpGLDrawBatchAdd(_tpGLDrawBatch * _batch,
+                                  const _tpGLRenderCache * _cache,
+                                  const _tpGLRect * _deviceBounds)
+{
+    int i, base, count;
+    tpFloat data[_kTpGLBatchTexelsPerDraw * 4];
+    tpFloat drawIndex = (tpFloat)_batch->drawCount;
+    tpVec2 zero = tpVec2Make(0, 0);
+    tpBool bHasFill = (tpBool)(_cache->style.fill.type == kTpPaintTypeColor);
+    tpBool bHasStroke =
+        (tpBool)(_cache->strokeIndexCount && _cache->style.stroke.type == kTpPaintTypeColor);
+
+    base = _batch->vertices.count;
+    count = _cache->geometryCache.count;
+    _tpVec2ArrayAppendArray(&_batch->vertices, &_cache->geometryCache);
+
+    /* the extrusions are zero for everything but gpu extruded stroke vertices */
+    _tpVec2ArrayReserveAdditional(&_batch->extrusions, count);
+    _tpFloatArrayReserveAdditional(&_batch->drawIndices, count);
+    for (i = 0; i < count; ++i)
+    {
+        _batch->extrusions.array[base + i] = zero;
+        _batch->drawIndices.array[base + i] = drawIndex;
+    }
+    _batch->extrusions.count = base + count;
+    _batch->drawIndices.count = base + count;
+    if (_cache->bExtrudeStrokeOnGPU && _cache->extrusionCache.count)
+        memcpy(&_batch->extrusions.array[base + _cache->strokeVertexOffset],
+               _cache->extrusionCache.array,
+               _cache->extrusionCache.count * sizeof(tpVec2));
+
+    if (bHasFill)
+    {
+        _batch->fillRule = _cache->style.fillRule;
+        for (i = 0; i < _cache->fillFirsts.count; ++i)
+        {
+            _tpGLIntArrayAppend(&_batch->fillFirsts, base + _cache->fillFirsts.array[i]);
+            _tpGLSizeiArrayAppend(&_batch->fillCounts, _cache->fillCounts.array[i]);
+        }
+        for (i = 0; i < _cache->fillCoverFirsts.count; ++i)
+        {
+            _tpGLIntArrayAppend(&_batch->fillCoverFirsts, base + _cache->fillCoverFirsts.array[i]);
+            _tpGLSizeiArrayAppend(&_batch->fillCoverCounts, _cache->fillCoverCounts.array[i]);
+        }
+    }
+
+    if (bHasStroke)
+    {
+        _tpGLIndexArrayReserveAdditional(&_batch->indices, _cache->strokeIndexCount);
+        for (i = 0; i < _cache->strokeIndexCount; ++i)
+            _batch->indices.array[_batch->indices.count + i] =
+                base + (_cache->indexType == GL_UNSIGNED_SHORT ? _cache->shortIndexCache.array[i]
+                                                               : _cache->indexCache.array[i]);
+        _batch->indices.count += _cache->strokeIndexCount;
+    }
+
+    _tpGLRectArrayAppendPtr(&_batch->deviceBounds, _deviceBounds);
+
+    /* the per draw data, see _vertexShaderCodeBatch */
+    memcpy(data, _cache->renderMatrix.v, sizeof(tpFloat) * 16);
+    memcpy(data + 16, &_cache->style.fill.data.color.r, sizeof(tpFloat) * 4);
+    memcpy(data + 20, &_cache->style.stroke.data.color.r, sizeof(tpFloat) * 4);
+    data[24] = _cache->bExtrudeStrokeOnGPU ? _cache->strokeHalfWidth : 0.0f;
+    data[25] = data[26] = data[27] = 0.0f;
+    _tpFloatArrayAppendCArray(&_batch->drawData, data, _kTpGLBatchTexelsPerDraw * 4);
+    _batch->drawCount++;
+}
+
+/*
+sets up the stencil test to pass for the pixels inside of the active clipping mask whose bits in
+_mask match the ones of _ref. The bits of _ref outside of _mask are still written by GL_REPLACE.
+*/
+TARP_LOCAL void _tpGLStencilFuncClip(const _tpGLContext * _ctx, GLint _ref, GLuint _mask)
+{
+    if (!_ctx->clippingStackDepth && !_mask)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_ALWAYS, _ref, 0));
+        return;
+    }
+    _TARP_ASSERT_NO_GL_ERROR(
+        glStencilFunc(GL_EQUAL,
+                      _ref | (_ctx->clippingStackDepth << _kTpGLClippingDepthShift),
+                      _mask | (_ctx->clippingStackDepth ? _kTpGLClippingStencilPlane : 0)));
+}
+
+/*
+sets up the stencil to draw the triangles of a solid color stroke with color writes enabled. The
+first triangle that covers a sample sets the stroke plane, which fails the test for all triangles
+that follow, so overlapping triangles are only blended once and no cover pass is needed. The stroke
+plane has to be cleared with _tpGLClearStrokeStencilPlane afterwards.
+*/
+TARP_LOCAL void _tpGLBeginSinglePassStroke(_tpGLContext * _ctx)
+{
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLStrokeRasterStencilPlane));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    _tpGLStencilFuncClip(_ctx, 0, _kTpGLStrokeRasterStencilPlane);
+    _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
+}
+
+/* intersects the scissor box of the context with _box */
+TARP_LOCAL void _tpGLIntersectScissor(_tpGLContext * _ctx, const GLint * _box)
+{
+    GLint minX, minY, maxX, maxY;
+
+    minX = _box[0];
+    minY = _box[1];
+    maxX = _box[0] + _box[2];
+    maxY = _box[1] + _box[3];
+    if (_ctx->bScissorTest)
+    {
+        minX = TARP_MAX(minX, _ctx->scissorBox[0]);
+        minY = TARP_MAX(minY, _ctx->scissorBox[1]);
+        maxX = TARP_MIN(maxX, _ctx->scissorBox[0] + _ctx->scissorBox[2]);
+        maxY = TARP_MIN(maxY, _ctx->scissorBox[1] + _ctx->scissorBox[3]);
+    }
+
+    _ctx->bScissorTest = GL_TRUE;
+    _ctx->scissorBox[0] = minX;
+    _ctx->scissorBox[1] = minY;
+    _ctx->scissorBox[2] = TARP_MAX(maxX - minX, 0);
+    _ctx->scissorBox[3] = TARP_MAX(maxY - minY, 0);
+}
+
+/* applies the scissor state of the context */
+TARP_LOCAL void _tpGLApplyScissor(_tpGLContext * _ctx)
+{
+    const GLint * box = _ctx->scissorBox;
+
+    if (_ctx->bScissorTest)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_SCISSOR_TEST));
+        _TARP_ASSERT_NO_GL_ERROR(glScissor(box[0], box[1], box[2], box[3]));
+    }
+    else
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_SCISSOR_TEST));
+    }
+}
+
+/* the box of window pixels that _bounds (in normalized device coordinates) touch within the
+ * viewport */
+TARP_LOCAL void _tpGLWindowBox(const _tpGLContext * _ctx,
+                               const _tpGLRect * _bounds,
+                               GLint * _outBox)
+{
+    GLint minX, minY, maxX, maxY;
+    const GLint * vp = _ctx->viewport;
+
+    /* one pixel of slack as the bounds are not rounded the same way the rasterizer does */
+    minX = (GLint)floor(vp[0] + (TARP_MAX(_bounds->min.x, -1.0f) + 1.0f) * 0.5f * vp[2]) - 1;
+    minY = (GLint)floor(vp[1] + (TARP_MAX(_bounds->min.y, -1.0f) + 1.0f) * 0.5f * vp[3]) - 1;
+    maxX = (GLint)ceil(vp[0] + (TARP_MIN(_bounds->max.x, 1.0f) + 1.0f) * 0.5f * vp[2]) + 1;
+    maxY = (GLint)ceil(vp[1] + (TARP_MIN(_bounds->max.y, 1.0f) + 1.0f) * 0.5f * vp[3]) + 1;
+    _outBox[0] = minX;
+    _outBox[1] = minY;
+    _outBox[2] = TARP_MAX(maxX - minX, 0);
+    _outBox[3] = TARP_MAX(maxY - minY, 0);
+}
+
+/* clears _plane of the stencil buffer within _bounds (in normalized device coordinates) using a
+ * scissored clear, which is limited to _scissorBox if _bScissorTest is set */
+TARP_LOCAL void _tpGLClearStencilPlane(_tpGLContext * _ctx,
+                                       const _tpGLRect * _bounds,
+                                       GLuint _plane,
+                                       GLboolean _bScissorTest,
+                                       const GLint * _scissorBox)
+{
+    GLint box[4], minX, minY, maxX, maxY;
+    const GLint * current = _scissorBox;
+
+    _tpGLWindowBox(_ctx, _bounds, box);
+    minX = box[0];
+    minY = box[1];
+    maxX = box[0] + box[2];
+    maxY = box[1] + box[3];
+    if (_bScissorTest)
+    {
+        minX = TARP_MAX(minX, current[0]);
+        minY = TARP_MAX(minY, current[1]);
+        maxX = TARP_MIN(maxX, current[0] + current[2]);
+        maxY = TARP_MIN(maxY, current[1] + current[3]);
+    }
+    if (maxX <= minX || maxY <= minY)
+        return;
+
+    box[0] = minX;
+    box[1] = minY;
+    box[2] = maxX - minX;
+    box[3] = maxY - minY;
+    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_SCISSOR_TEST));
+    _TARP_ASSERT_NO_GL_ERROR(glScissor(box[0], box[1], box[2], box[3]));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_plane));
+    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
+    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+    _tpGLApplyScissor(_ctx);
+}
+
+/* clears the stroke plane within _bounds, respecting the current scissor box */
+TARP_LOCAL void _tpGLClearStrokeStencilPlane(_tpGLContext * _ctx, const _tpGLRect * _bounds)
+{
+    _tpGLClearStencilPlane(
+        _ctx, _bounds, _kTpGLStrokeRasterStencilPlane, _ctx->bScissorTest, _ctx->scissorBox);
+}
+
+/* clears the clipping plane where the retained clipping mask was rendered to */
+TARP_LOCAL void _tpGLEraseRetainedClipMask(_tpGLContext * _ctx)
+{
+    const _tpGLClipMaskKey * key = &_ctx->clipMaskKey;
+
+    if (!_ctx->bHasRetainedClipMask)
+        return;
+
+    _tpGLClearStencilPlane(_ctx,
+                           &key->deviceBounds,
+                           _kTpGLClippingStencilPlane,
+                           key->bScissorTest,
+                           key->scissorBox);
+    _ctx->bHasRetainedClipMask = tpFalse;
+}
+
+/* draws everything that was collected in the batch so far */
+TARP_LOCAL void _tpGLDrawBatchFlush(_tpGLContext * _ctx)
+{
+    int i;
+    _tpGLDrawBatch * batch = &_ctx->batch;
+    GLuint buffer;
+    GLsizeiptr vertexBytes, drawIndexBytes, indexBytes, offset;
+    _tpGLRect bounds;
+
+    if (!batch->drawCount)
+        return;
+
+    /* upload the geometry of all draws at once */
+    vertexBytes = batch->vertices.count * sizeof(tpVec2);
+    drawIndexBytes = batch->drawIndices.count * sizeof(tpFloat);
+    indexBytes = batch->indices.count * sizeof(GLuint);
+    if (_ctx->uploadMode == kTpGeometryUploadModeStreaming)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->stream.buffer));
+        offset = _tpGLStreamBufferReserve(&_ctx->stream,
+                                          vertexBytes * 2 + drawIndexBytes + indexBytes);
+        _tpGLStreamBufferWrite(&_ctx->stream, offset, batch->vertices.array, vertexBytes);
+        _tpGLStreamBufferWrite(
+            &_ctx->stream, offset + vertexBytes, batch->extrusions.array, vertexBytes);
+        _tpGLStreamBufferWrite(
+            &_ctx->stream, offset + vertexBytes * 2, batch->drawIndices.array, drawIndexBytes);
+        _tpGLStreamBufferWrite(&_ctx->stream,
+                               offset + vertexBytes * 2 + drawIndexBytes,
+                               batch->indices.array,
+                               indexBytes);
+        /* reserving might have replaced the buffer */
+        buffer = _ctx->stream.buffer;
+    }
+    else
+    {
+        offset = 0;
+        buffer = batch->vbo;
+        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, batch->vbo));
+        _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_ARRAY_BUFFER,
+                                              vertexBytes * 2 + drawIndexBytes + indexBytes,
+                                              NULL,
+                                              GL_STREAM_DRAW));
+        _TARP_ASSERT_NO_GL_ERROR(
+            glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, batch->vertices.array));
+        _TARP_ASSERT_NO_GL_ERROR(
+            glBufferSubData(GL_ARRAY_BUFFER, vertexBytes, vertexBytes, batch->extrusions.array));
+        _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(
+            GL_ARRAY_BUFFER, vertexBytes * 2, drawIndexBytes, batch->drawIndices.array));
+        if (indexBytes)
+            _TARP_ASSERT_NO_GL_ERROR(glBufferSubData(GL_ARRAY_BUFFER,
+                                                     vertexBytes * 2 + drawIndexBytes,
+                                                     indexBytes,
+                                                     batch->indices.array));
+    }
+
+    _TARP_ASSERT_NO_GL_ERROR(glBindVertexArray(batch->vao));
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+    /* the element buffer binding is part of the vao state */
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0) + offset));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, ((char *)0) + offset + vertexBytes));
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(
+        2, 1, GL_FLOAT, GL_FALSE, 0, ((char *)0) + offset + vertexBytes * 2));
+    offset += vertexBytes * 2 + drawIndexBytes;
+
+    /* the draw data keeps its own buffer in both upload modes, GL 3.3 has no glTexBufferRange to
+     * point the texture at a block of the stream buffer */
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_TEXTURE_BUFFER, batch->dataBuffer));
+    _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_TEXTURE_BUFFER,
+                                          batch->drawData.count * sizeof(tpFloat),
+                                          batch->drawData.array,
+                                          GL_STREAM_DRAW));
+    _TARP_ASSERT_NO_GL_ERROR(glBindTexture(GL_TEXTURE_BUFFER, batch->dataTexture));
+    _TARP_ASSERT_NO_GL_ERROR(glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, batch->dataBuffer));
+
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->batchProgram));
+    _TARP_ASSERT_NO_GL_ERROR(glUniform1i(_ctx->drawDataLoc, 0));
+
+    /* the same stencil and cover sequence as _tpGLDrawRenderCacheImpl, just for all draws */
+    if (batch->fillCoverFirsts.count)
+    {
+        _tpGLStencilFuncClip(_ctx, 0, 0);
+        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+        _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane));
+        if (batch->fillRule == kTpFillRuleEvenOdd)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
+        }
+        else
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP));
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP));
+        }
+        _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(GL_TRIANGLE_FAN,
+                                                   batch->fillFirsts.array,
+                                                   batch->fillCounts.array,
+                                                   batch->fillFirsts.count));
+
+        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 0, _kTpGLFillRasterStencilPlane));
+        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO));
+        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+        _TARP_ASSERT_NO_GL_ERROR(glUniform1i(_ctx->colorSlotLoc, 0));
+        _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(GL_TRIANGLE_FAN,
+                                                   batch->fillCoverFirsts.array,
+                                                   batch->fillCoverCounts.array,
+                                                   batch->fillCoverFirsts.count));
+    }
+
+    if (batch->indices.count)
+    {
+        /* the strokes of the batch don't overlap, so the stroke plane is cleared once for all */
+        _tpGLBeginSinglePassStroke(_ctx);
+        _TARP_ASSERT_NO_GL_ERROR(glUniform1i(_ctx->colorSlotLoc, 1));
+        _TARP_ASSERT_NO_GL_ERROR(glDrawElements(
+            GL_TRIANGLES, batch->indices.count, GL_UNSIGNED_INT, ((char *)0) + offset));
+
+        _tpGLInitBounds(&bounds);
+        for (i = 0; i < batch->deviceBounds.count; ++i)
+            _tpGLMergeBounds(&bounds, &batch->deviceBounds.array[i]);
+        _tpGLClearStrokeStencilPlane(_ctx, &bounds);
+    }
+
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
+
+    _tpVec2ArrayClear(&batch->vertices);
+    _tpVec2ArrayClear(&batch->extrusions);
+    _tpFloatArrayClear(&batch->drawIndices);
+    _tpGLIndexArrayClear(&batch->indices);
+    _tpFloatArrayClear(&batch->drawData);
+    _tpGLIntArrayClear(&batch->fillFirsts);
+    _tpGLSizeiArrayClear(&batch->fillCounts);
+    _tpGLIntArrayClear(&batch->fillCoverFirsts);
+    _tpGLSizeiArrayClear(&batch->fillCoverCounts);
+    _tpGLRectArrayClear(&batch->deviceBounds);
+    batch->drawCount = 0;
+}
+
+TARP_API tpBool tpPrepareDrawing(tpContext _ctx)
+{
+    GLint viewport[4];
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+
+    /* the viewport maps the projection to device pixels, which the flattening tolerance is
+     * specified in. If it changed, treat it like a projection change. */
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (memcmp(viewport, ctx->viewport, sizeof(viewport)) != 0)
+    {
+        memcpy(ctx->viewport, viewport, sizeof(viewport));
+        ctx->projectionID++;
+        ctx->bTransformProjDirty = tpTrue;
+    }
+
+    /* cache previous render state so we can reset it in tpFinishDrawing */
+    glGetIntegerv(GL_ACTIVE_TEXTURE, (GLint *)&ctx->stateBackup.activeTexture);
+    ctx->stateBackup.depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &ctx->stateBackup.depthMask);
+    ctx->stateBackup.multisample = glIsEnabled(GL_MULTISAMPLE);
+    ctx->stateBackup.stencilTest = glIsEnabled(GL_STENCIL_TEST);
+    glGetIntegerv(GL_STENCIL_WRITEMASK, (GLint *)&ctx->stateBackup.stencilMask);
+    glGetIntegerv(GL_STENCIL_FAIL, (GLint *)&ctx->stateBackup.stencilFail);
+    glGetIntegerv(GL_STENCIL_PASS_DEPTH_PASS, (GLint *)&ctx->stateBackup.stencilPassDepthPass);
+    glGetIntegerv(GL_STENCIL_PASS_DEPTH_FAIL, (GLint *)&ctx->stateBackup.stencilPassDepthFail);
+    glGetIntegerv(GL_STENCIL_CLEAR_VALUE, (GLint *)&ctx->stateBackup.clearStencil);
+    ctx->stateBackup.blending = glIsEnabled(GL_BLEND);
+    glGetIntegerv(GL_BLEND_SRC_RGB, (GLint *)&ctx->stateBackup.blendSrcRGB);
+    glGetIntegerv(GL_BLEND_DST_RGB, (GLint *)&ctx->stateBackup.blendDestRGB);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, (GLint *)&ctx->stateBackup.blendSrcAlpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, (GLint *)&ctx->stateBackup.blendDestAlpha);
+    glGetIntegerv(GL_BLEND_EQUATION_RGB, (GLint *)&ctx->stateBackup.blendEquationRGB);
+    glGetIntegerv(GL_BLEND_EQUATION_ALPHA, (GLint *)&ctx->stateBackup.blendEquationAlpha);
+    ctx->stateBackup.cullFace = glIsEnabled(GL_CULL_FACE);
+    glGetIntegerv(GL_CULL_FACE_MODE, (GLint *)&ctx->stateBackup.cullFaceMode);
+    glGetIntegerv(GL_FRONT_FACE, (GLint *)&ctx->stateBackup.frontFace);
+    ctx->stateBackup.scissorTest = glIsEnabled(GL_SCISSOR_TEST);
+    glGetIntegerv(GL_SCISSOR_BOX, ctx->stateBackup.scissorBox);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, (GLint *)&ctx->stateBackup.vao);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, (GLint *)&ctx->stateBackup.vbo);
+    glGetIntegerv(GL_CURRENT_PROGRAM, (GLint *)&ctx->stateBackup.program);
+
+    /* creating the ring buffer binds gl objects, so it happens after the state backup */
+    ctx->uploadMode = ctx->requestedUploadMode;
+    if (ctx->uploadMode == kTpGeometryUploadModeStreaming)
+    {
+        if (!ctx->stream.vao)
+            _tpGLStreamBufferInit(&ctx->stream);
+        _tpGLStreamBufferBeginFrame(&ctx->stream);
+    }
+
+    _TARP_ASSERT_NO_GL_ERROR(glActiveTexture(GL_TEXTURE0));
+
+    _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_DEPTH_TEST));
+    _TARP_ASSERT_NO_GL_ERROR(glDepthMask(GL_FALSE));
+    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_MULTISAMPLE));
+
+    /* @TODO: Support different ways of blending?? */
+    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_BLEND));
+    _TARP_ASSERT_NO_GL_ERROR(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    /* the nonzero fill relies on both faces being rasterized with clockwise ones in front */
+    _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_CULL_FACE));
+    _TARP_ASSERT_NO_GL_ERROR(glFrontFace(GL_CW));
+
+    /* the clipping plane is kept if it holds a mask that should be retained across frames */
+    if (!ctx->bRetainClippingMasks ||
+        memcmp(ctx->clipMaskKey.viewport, ctx->viewport, sizeof(ctx->viewport)) != 0)
+        ctx->bHasRetainedClipMask = tpFalse;
+
+    _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_STENCIL_TEST));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(
+        _kTpGLFillRasterStencilPlane | _kTpGLStrokeRasterStencilPlane |
+        (ctx->bHasRetainedClipMask ? 0 : _kTpGLClippingStencilPlane)));
+    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
+    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(ctx->program));
+
+    ctx->clippingStackDepth = 0; /* reset clipping */
+    _tpGLClipArrayClear(&ctx->clips);
+    ctx->bScissorTest = ctx->stateBackup.scissorTest;
+    memcpy(ctx->scissorBox, ctx->stateBackup.scissorBox, sizeof(ctx->scissorBox));
+    _tpGLResetClipBounds(ctx);
+
+    return tpFalse;
+}
+
+TARP_API tpBool tpFinishDrawing(tpContext _ctx)
+{
+    /* reset gl state to what it was before we began drawing */
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+
+    _tpGLDrawBatchFlush(ctx);
+    if (ctx->uploadMode == kTpGeometryUploadModeStreaming)
+        _tpGLStreamBufferEndFrame(&ctx->stream);
+    if (!ctx->bRetainClippingMasks)
+        _tpGLEraseRetainedClipMask(ctx);
+
+    /* we dont assert gl errors here for now...should we? */
+    glActiveTexture(ctx->stateBackup.activeTexture);
+    ctx->stateBackup.depthTest ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+    glDepthMask(ctx->stateBackup.depthMask);
+    ctx->stateBackup.multisample ? glEnable(GL_MULTISAMPLE) : glDisable(GL_MULTISAMPLE);
+    ctx->stateBackup.stencilTest ? glEnable(GL_STENCIL_TEST) : glDisable(GL_STENCIL_TEST);
+    glStencilMask(ctx->stateBackup.stencilMask);
+    glStencilOp(ctx->stateBackup.stencilFail,
+                ctx->stateBackup.stencilPassDepthPass,
+                ctx->stateBackup.stencilPassDepthFail);
+    glClearStencil(ctx->stateBackup.clearStencil);
+    ctx->stateBackup.blending ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+    glBlendFuncSeparate(ctx->stateBackup.blendSrcRGB,
+                        ctx->stateBackup.blendDestRGB,
+                        ctx->stateBackup.blendSrcAlpha,
+                        ctx->stateBackup.blendDestAlpha);
+    glBlendEquationSeparate(ctx->stateBackup.blendEquationRGB, ctx->stateBackup.blendEquationAlpha);
+
+    ctx->stateBackup.cullFace ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+    glCullFace(ctx->stateBackup.cullFaceMode);
+    glFrontFace(ctx->stateBackup.frontFace);
+    ctx->stateBackup.scissorTest ? glEnable(GL_SCISSOR_TEST) : glDisable(GL_SCISSOR_TEST);
+    glScissor(ctx->stateBackup.scissorBox[0],
+              ctx->stateBackup.scissorBox[1],
+              ctx->stateBackup.scissorBox[2],
+              ctx->stateBackup.scissorBox[3]);
+    /* the previous bindings might be buffers of tarp that got deleted in the meantime */
+    if (!ctx->stateBackup.vao || glIsVertexArray(ctx->stateBackup.vao))
+        glBindVertexArray(ctx->stateBackup.vao);
+    if (!ctx->stateBackup.vbo || glIsBuffer(ctx->stateBackup.vbo))
+        glBindBuffer(GL_ARRAY_BUFFER, ctx->stateBackup.vbo);
+    glUseProgram(ctx->stateBackup.program);
+
+    return tpFalse;
+}
+
+/* the largest singular value of the 2D part of _mat mapped to the viewport, i.e. the maximum number
+ * of device pixels that one unit can span after applying _mat in any direction */
+TARP_LOCAL tpFloat _tpGLDeviceScale(const tpMat4 * _mat, const GLint * _viewport)
+{
+    tpFloat a, b, c, d, sum, det;
+
+    a = _mat->v[0] * _viewport[2] * 0.5f;
+    b = _mat->v[4] * _viewport[2] * 0.5f;
+    c = _mat->v[1] * _viewport[3] * 0.5f;
+    d = _mat->v[5] * _viewport[3] * 0.5f;
+    sum = a * a + b * b + c * c + d * d;
+    det = a * d - b * c;
+    return sqrt((sum + sqrt(TARP_MAX(sum * sum - det * det * 4.0f, 0.0f))) * 0.5f);
+}
+
+/*
+Checks if _transform only translates, rotates, mirrors and uniformly scales. If so, its scale is
+written to _outScale.
+*/
+TARP_LOCAL tpBool _tpGLTransformIsSimilarity(const tpTransform * _transform, tpFloat * _outScale)
+{
+    tpFloat len0, len1, dot, eps;
+
+    len0 = _transform->m.v[0] * _transform->m.v[0] + _transform->m.v[1] * _transform->m.v[1];
+    len1 = _transform->m.v[2] * _transform->m.v[2] + _transform->m.v[3] * _transform->m.v[3];
+    dot = _transform->m.v[0] * _transform->m.v[2] + _transform->m.v[1] * _transform->m.v[3];
+    eps = len0 * FLT_EPSILON * 8.0f;
+
+    if (len0 < FLT_MIN || fabs(len0 - len1) > eps || fabs(dot) > eps)
+        return tpFalse;
+
+    *_outScale = sqrt(len0);
+    return tpTrue;
+}
+
+/* the stroke of geometry in local space is scaled by the inverse of the transform scale for non
+ * scaling strokes. Small differences (i.e. due to rounding in a rotation) are not visible. */
+TARP_LOCAL tpBool _tpGLStrokeScaleEquals(tpFloat _a, tpFloat _b)
+{
+    return (tpBool)(fabs(_a - _b) <= _b * 0.0001f);
+}
+
+/* make sure transformProjection and the scales derived from it are up to date */
+TARP_LOCAL void _tpGLUpdateTransformProjection(_tpGLContext * _ctx)
+{
+    if (!_ctx->bTransformProjDirty)
+        return;
+
+    _ctx->bTransformProjDirty = tpFalse;
+    _ctx->renderTransform = tpMat4MakeFrom2DTransform(&_ctx->transform);
+    _ctx->transformProjection = tpMat4Mult(&_ctx->projection, &_ctx->renderTransform);
+    _ctx->transformScale = _tpGLDeviceScale(&_ctx->transformProjection, _ctx->viewport);
+    _ctx->projectionScale = _tpGLDeviceScale(&_ctx->projection, _ctx->viewport);
+}
+
+TARP_LOCAL int _tpGLSweepEdgeComp(const void * _a, const void * _b)
+{
+    tpFloat a = ((const _tpGLSweepEdge *)_a)->top.y;
+    tpFloat b = ((const _tpGLSweepEdge *)_b)->top.y;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+TARP_LOCAL int _tpGLFloatComp(const void * _a, const void * _b)
+{
+    tpFloat a = *(const tpFloat *)_a;
+    tpFloat b = *(const tpFloat *)_b;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+TARP_LOCAL tpFloat _tpGLSweepEdgeX(const _tpGLSweepEdge * _edge, tpFloat _y)
+{
+    return _edge->top.x + (_y - _edge->top.y) * _edge->dxdy;
+}
+
+/* adds the two triangles of the trapezoid between two edges from _y0 to _y1 */
+TARP_LOCAL void _tpGLSweepEmitSpan(const _tpGLSweepEdge * _left,
+                                   const _tpGLSweepEdge * _right,
+                                   tpFloat _y0,
+                                   tpFloat _y1,
+                                   _tpVec2Array * _outVertices)
+{
+    tpVec2 quad[6];
+    tpFloat l0, r0, l1, r1;
+
+    l0 = _tpGLSweepEdgeX(_left, _y0);
+    r0 = _tpGLSweepEdgeX(_right, _y0);
+    l1 = _tpGLSweepEdgeX(_left, _y1);
+    r1 = _tpGLSweepEdgeX(_right, _y1);
+
+    if (_y0 >= _y1 || (l0 >= r0 && l1 >= r1))
+        return;
+
+    quad[0] = tpVec2Make(l0, _y0);
+    quad[1] = tpVec2Make(r0, _y0);
+    quad[2] = tpVec2Make(r1, _y1);
+    quad[3] = quad[0];
+    quad[4] = quad[2];
+    quad[5] = tpVec2Make(l1, _y1);
+    _tpVec2ArrayAppendCArray(_outVertices, quad, 6);
+}
+
+/* sorts the active edges by their x position at _y. The order rarely changes between slabs */
+TARP_LOCAL void _tpGLSweepSortActive(_tpGLGeometryBuilder * _builder, tpFloat _y)
+{
+    int i, j, edge;
+    tpFloat x;
+    int * active = _builder->sweepActive.array;
+    tpFloat * xs = _builder->sweepXs.array;
+
+    for (i = 0; i < _builder->sweepActive.count; ++i)
+        xs[i] = _tpGLSweepEdgeX(&_builder->sweepEdges.array[active[i]], _y);
+
+    for (i = 1; i < _builder->sweepActive.count; ++i)
+    {
+        edge = active[i];
+        x = xs[i];
+        for (j = i - 1; j >= 0 && xs[j] > x; --j)
+        {
+            active[j + 1] = active[j];
+            xs[j + 1] = xs[j];
+        }
+        active[j + 1] = edge;
+        xs[j + 1] = x;
+    }
+}
+
+/*
+returns the y of the first crossing of two active edges in (_y0, _y1) or _y1 if there is none.
+Expects the active edges to be sorted at a y inside the slab, in which case any crossing shows up
+as two neighbours that are in the wrong order at the top or the bottom of the slab.
+*/
+TARP_LOCAL tpFloat _tpGLSweepFirstCrossing(_tpGLGeometryBuilder * _builder,
+                                           tpFloat _y0,
+                                           tpFloat _y1)
+{
+    int i;
+    tpFloat y, tolerance;
+    const _tpGLSweepEdge *a, *b;
+
+    for (i = 0; i + 1 < _builder->sweepActive.count; ++i)
+    {
+        a = &_builder->sweepEdges.array[_builder->sweepActive.array[i]];
+        b = &_builder->sweepEdges.array[_builder->sweepActive.array[i + 1]];
+        tolerance = 1e-5f * (1.0f + (tpFloat)fabs(_builder->sweepXs.array[i]));
+        if ((_tpGLSweepEdgeX(a, _y0) - _tpGLSweepEdgeX(b, _y0) > tolerance ||
+             _tpGLSweepEdgeX(a, _y1) - _tpGLSweepEdgeX(b, _y1) > tolerance) &&
+            a->dxdy != b->dxdy)
+        {
+            y = (b->top.x - a->top.x + a->dxdy * a->top.y - b->dxdy * b->top.y) /
+                (a->dxdy - b->dxdy);
+            if (y > _y0 && y < _y1)
+                _y1 = y;
+        }
+    }
+    return _y1;
+}
+
+/*
+triangulates the fill of the contours with a sweep line from top to bottom. The plane is cut into
+horizontal slabs at every vertex and at every crossing of two edges, so that the edges inside of a
+slab are ordered from left to right. Walking over them while summing up the winding tells which
+spans between two neighbouring edges are inside of the fill. Spans that continue between the same
+two edges in the next slab are merged, so that every span ends up as one trapezoid. Appends the
+triangles to _outVertices.
+*/
+TARP_LOCAL void _tpGLTriangulateFill(_tpGLGeometryBuilder * _builder,
+                                     const _tpGLRenderCacheContourArray * _contours,
+                                     tpFillRule _fillRule,
+                                     _tpVec2Array * _outVertices)
+{
+    int i, j, k, nextEdge, winding, iterations;
+    tpFloat y, nextY, crossing;
+    tpVec2 a, b;
+    _tpGLSweepEdge edge, *e;
+    _tpGLSweepSpan span, *prev;
+    const _tpGLRenderCacheContour * c;
+    _tpGLSweepEdgeArray * edges = &_builder->sweepEdges;
+    _tpFloatArray * ys = &_builder->sweepYs;
+    _tpGLIntArray * active = &_builder->sweepActive;
+
+    _tpGLSweepEdgeArrayClear(edges);
+    _tpFloatArrayClear(ys);
+    _tpGLIntArrayClear(active);
+    _tpGLSweepSpanArrayClear(&_builder->sweepSpans);
+
+    /* collect the edges of all contours, horizontal edges don't change the winding. The contours
+     * are closed, so the start points of the edges include the y of every vertex */
+    edge.openSpan = -1;
+    for (i = 0; i < _contours->count; ++i)
+    {
+        c = &_contours->array[i];
+        for (j = 0; j < c->fillVertexCount; ++j)
+        {
+            a = _outVertices->array[c->fillVertexOffset + j];
+            b = _outVertices->array[c->fillVertexOffset + (j + 1) % c->fillVertexCount];
+            if (a.y == b.y)
+                continue;
+            edge.winding = a.y < b.y ? 1 : -1;
+            edge.top = a.y < b.y ? a : b;
+            edge.bottom = a.y < b.y ? b : a;
+            edge.dxdy = (edge.bottom.x - edge.top.x) / (edge.bottom.y - edge.top.y);
+            _tpGLSweepEdgeArrayAppendPtr(edges, &edge);
+            _tpFloatArrayAppend(ys, a.y);
+        }
+    }
+    if (!edges->count)
+        return;
+
+    qsort(edges->array, edges->count, sizeof(_tpGLSweepEdge), _tpGLSweepEdgeComp);
+    qsort(ys->array, ys->count, sizeof(tpFloat), _tpGLFloatComp);
+    _tpFloatArrayClear(&_builder->sweepXs);
+    _tpFloatArrayReserveAdditional(&_builder->sweepXs, edges->count);
+
+    nextEdge = 0;
+    k = 0;
+    y = ys->array[0];
+    while (k < ys->count)
+    {
+        if (ys->array[k] <= y)
+        {
+            ++k;
+            continue;
+        }
+
+        /* update the edges that intersect the slab starting at y */
+        for (i = 0, j = 0; i < active->count; ++i)
+        {
+            if (edges->array[active->array[i]].bottom.y > y)
+                active->array[j++] = active->array[i];
+        }
+        active->count = j;
+        while (nextEdge < edges->count && edges->array[nextEdge].top.y <= y)
+            _tpGLIntArrayAppend(active, nextEdge++);
+
+        /* make the slab end at the first crossing of two edges inside of it */
+        nextY = ys->array[k];
+        for (iterations = 0; iterations < 32; ++iterations)
+        {
+            _tpGLSweepSortActive(_builder, (y + nextY) * 0.5f);
+            crossing = _tpGLSweepFirstCrossing(_builder, y, nextY);
+            if (crossing >= nextY)
+                break;
+            nextY = crossing;
+        }
+
+        /* find the spans that are inside of the fill and continue the ones of the last slab */
+        _tpGLSweepSpanArrayClear(&_builder->sweepNextSpans);
+        for (i = 0; i < _builder->sweepSpans.count; ++i)
+        {
+            prev = &_builder->sweepSpans.array[i];
+            prev->bContinued = tpFalse;
+            edges->array[prev->left].openSpan = i;
+        }
+
+        winding = 0;
+        for (i = 0; i + 1 < active->count; ++i)
+        {
+            e = &edges->array[active->array[i]];
+            winding += e->winding;
+            if (_fillRule == kTpFillRuleEvenOdd ? !(winding & 1) : !winding)
+                continue;
+
+            span.left = active->array[i];
+            span.right = active->array[i + 1];
+            span.y = y;
+            span.bContinued = tpFalse;
+            if (e->openSpan != -1)
+            {
+                prev = &_builder->sweepSpans.array[e->openSpan];
+                if (prev->right == span.right)
+                {
+                    span.y = prev->y;
+                    prev->bContinued = tpTrue;
+                }
+            }
+            _tpGLSweepSpanArrayAppendPtr(&_builder->sweepNextSpans, &span);
+        }
+
+        /* spans that did not make it into this slab end at its top */
+        for (i = 0; i < _builder->sweepSpans.count; ++i)
+        {
+            prev = &_builder->sweepSpans.array[i];
+            edges->array[prev->left].openSpan = -1;
+            if (!prev->bContinued)
+                _tpGLSweepEmitSpan(&edges->array[prev->left],
+                                   &edges->array[prev->right],
+                                   prev->y,
+                                   y,
+                                   _outVertices);
+        }
+        _tpGLSweepSpanArraySwap(&_builder->sweepSpans, &_builder->sweepNextSpans);
+
+        y = nextY;
+    }
+
+    for (i = 0; i < _builder->sweepSpans.count; ++i)
+    {
+        prev = &_builder->sweepSpans.array[i];
+        _tpGLSweepEmitSpan(
+            &edges->array[prev->left], &edges->array[prev->right], prev->y, y, _outVertices);
+    }
+}
+
+TARP_API tpBool _tpGLCachePathImpl(_tpGLGeometryBuilder * _builder,
                                    _tpGLPath * _path,
                                    const tpStyle * _style,
                                    _tpGLRenderCache * _oldCache,
@@ -4096,31 +8103,25 @@ TARP_API tpBool _tpGLCachePathImpl(_tpGLContext * _ctx,
                                    tpBool _bStrokeGradientDirty)
 {
     _tpGLRect bounds;
-    tpBool bStyleHasStroke, bIsPathRenderCache;
-    int i;
+    tpBool bStyleHasStroke, bIsPathRenderCache, bExtrudeOnGPU;
+    tpStyle strokeStyle, geometryStyle;
+    tpFloat strokeScale, deviceScale, tolerance, dashArray[TARP_MAX_DASH_ARRAY_SIZE];
+    _tpGLRoundTable roundTable;
+    _tpGLStrokeBuffers strokeBuffers;
+    int i, strokeVertexOffset, fillTriangleOffset;
 
-    assert(_ctx && _path && _cache);
-
-    /* if the rendercache is currently referenced in the clipping stack of the context, create a
-     * deep copy and replace it in the clipping stack. This ensures that the clipping masks will be
-     * identical in cases where the clipping stack needs to be rebuilt. */
-    for (i = 0; i < _ctx->clippingStackDepth; ++i)
-    {
-        if (_ctx->clippingStack[i] == _cache)
-        {
-            _tpGLRenderCache * c = _ctx->clippingRenderCaches[i];
-            _tpGLRenderCacheCopyTo(_cache, c);
-            _ctx->clippingStack[i] = c;
-        }
-    }
+    assert(_builder && _path && _cache);
 
     /* simpliy reset the cache if the path is empty */
     if (!_path->contours.count)
     {
         _tpGLRenderCacheContourArrayClear(&_cache->contours);
+        _tpGLRenderCacheUpdateFillRanges(_cache);
+        _cache->fillTriangleCount = 0;
         _tpVec2ArrayClear(&_cache->geometryCache);
         _tpBoolArrayClear(&_cache->jointCache);
         _tpGLTextureVertexArrayClear(&_cache->textureGeometryCache);
+        _tpGLRenderCacheMarkDirty(_cache);
         return tpFalse;
     }
 
@@ -4129,98 +8130,167 @@ TARP_API tpBool _tpGLCachePathImpl(_tpGLContext * _ctx,
     _tpGLInitBounds(&bounds);
     _tpGLRenderCacheCopyStyle(_style, _cache);
 
-    /* make sure transformProjection is up to date */
-    if (_ctx->bTransformProjDirty)
+    /*
+    geometry is generated in the local space of the path and transformed during rendering. For non
+    scaling strokes that is only possible if the transform is a similarity, in which case the
+    stroke width and dashes are scaled by the inverse of the transform scale. Otherwise the
+    geometry is flattened after applying the transform.
+    */
+    strokeScale = 1.0f;
+    _cache->bIsLocalSpace =
+        (tpBool)(_style->scaleStroke ||
+                 _tpGLTransformIsSimilarity(&_builder->transform, &strokeScale));
+    strokeStyle = *_style;
+    if (strokeScale != 1.0f)
     {
-        _ctx->bTransformProjDirty = tpFalse;
-        _ctx->renderTransform = tpMat4MakeFrom2DTransform(&_ctx->transform);
-        _ctx->transformProjection = tpMat4Mult(&_ctx->projection, &_ctx->renderTransform);
+        strokeStyle.strokeWidth /= strokeScale;
+        strokeStyle.dashOffset /= strokeScale;
+        for (i = 0; i < _style->dashCount; ++i)
+            dashArray[i] = _style->dashArray[i] / strokeScale;
+        strokeStyle.dashArray = dashArray;
     }
+    /* the stroke scale of the cache only changes if the stroke gets regenerated */
+    if (_bGeometryDirty || _bStrokeDirty)
+        _cache->strokeScale = strokeScale;
 
     /* cache the matrix that should be used during rendering */
-    if (!_style->scaleStroke)
-        _cache->renderMatrix = _ctx->projection;
+    if (!_cache->bIsLocalSpace)
+    {
+        _cache->renderMatrix = _builder->projection;
+        _cache->renderTransform = tpMat4MakeIdentity();
+        _cache->renderProjection = _builder->projection;
+    }
     else
-        _cache->renderMatrix = _ctx->transformProjection;
-
-    if (_bGeometryDirty)
     {
-        int i;
-        _tpGLContour * c;
-        _tpGLRenderCacheContour rc;
-        tpFloat angleTolerance = !_style->scaleStroke ? 0.15f : 0.15f / _ctx->transformScale;
-
-        for (i = 0; i < _path->contours.count; ++i)
-        {
-            c = _tpGLContourArrayAtPtr(&_path->contours, i);
-            if (c->bDirty || !_oldCache->contours.count)
-            {
-                if (_style->scaleStroke)
-                    _tpGLFlattenContour(c,
-                                        angleTolerance,
-                                        NULL,
-                                        &_ctx->tmpVertices,
-                                        &_ctx->tmpJoints,
-                                        &bounds,
-                                        &rc);
-                else
-                    _tpGLFlattenContour(c,
-                                        angleTolerance,
-                                        &_ctx->transform,
-                                        &_ctx->tmpVertices,
-                                        &_ctx->tmpJoints,
-                                        &bounds,
-                                        &rc);
-
-                /* only clear the dirty flag here, if there is no stroke, otherwise this will be
-                 * done during stroking. We also ignore the dirty flag if this is not the internal
-                 * path render cache */
-                if (!bStyleHasStroke && bIsPathRenderCache)
-                    c->bDirty = tpFalse;
-            }
-            else
-            {
-                _tpGLRenderCacheContour * rcc =
-                    _tpGLRenderCacheContourArrayAtPtr(&_oldCache->contours, i);
-
-                rc.fillVertexOffset = _ctx->tmpVertices.count;
-                rc.fillVertexCount = rcc->fillVertexCount;
-                rc.bIsClosed = c->bIsClosed;
-
-                /* otherwise we just copy the contour to the tmpbuffer... */
-                _tpVec2ArrayAppendCArray(
-                    &_ctx->tmpVertices,
-                    _tpVec2ArrayAtPtr(&_oldCache->geometryCache, rcc->fillVertexOffset),
-                    rcc->fillVertexCount);
-
-                _tpBoolArrayAppendCArray(
-                    &_ctx->tmpJoints,
-                    _tpBoolArrayAtPtr(&_oldCache->jointCache, rcc->fillVertexOffset),
-                    rcc->fillVertexCount);
+        _cache->renderMatrix = _builder->transformProjection;
+        _cache->renderTransform = tpMat4MakeFrom2DTransform(&_builder->transform);
+        _cache->renderProjection = _builder->projection;
+    }
 
-                /* ...and merge the cached contour bounds with the path bounds
-                 */
-                _tpGLMergeBounds(&bounds, &c->bounds);
-            }
+    /* the tolerance is specified in device pixels, convert it to the space we flatten in. The
+     * internal path cache is flattened for the largest scale of the current scale band. */
+    deviceScale = TARP_MAX(!_cache->bIsLocalSpace
+                               ? _builder->projectionScale
+                               : bIsPathRenderCache
+                                     ? _tpGLLodBandScale(_tpGLLodBand(_builder->transformScale))
+                                     : _builder->transformScale,
+                           FLT_EPSILON);
+    tolerance = _builder->flatteningTolerance / deviceScale;
+
+    /* round joins and caps are tessellated based on the stroke radius in device pixels */
+    if (bStyleHasStroke &&
+        (_style->strokeJoin == kTpStrokeJoinRound || _style->strokeCap == kTpStrokeCapRound))
+        _tpGLRoundTableInit(&roundTable,
+                            _tpGLRoundSegmentCount(strokeStyle.strokeWidth * 0.5f * deviceScale,
+                                                   _builder->flatteningTolerance));
+    else
+        _tpGLRoundTableInit(&roundTable, 4);
 
-            _tpGLRenderCacheContourArrayAppendPtr(&_ctx->tmpRcContours, &rc);
+    /*
+    strokes that are extruded on the gpu are generated with a half width of one and scaled by
+    strokeHalfWidth in the vertex shader. As the tessellation of round joins and caps depends on
+    the width, they are regenerated if the segment count changes considerably.
+    */
+    bExtrudeOnGPU = (tpBool)(_builder->strokeExtrusionMode == kTpStrokeExtrusionModeGPU);
+    geometryStyle = strokeStyle;
+    if (bExtrudeOnGPU)
+    {
+        geometryStyle.strokeWidth = 2.0f;
+        if (bStyleHasStroke &&
+            (!_cache->bExtrudeStrokeOnGPU || roundTable.count > _cache->roundSegmentCount ||
+             roundTable.count * 2 < _cache->roundSegmentCount))
+        {
+            _bStrokeDirty = tpTrue;
+        }
+        else if (bStyleHasStroke && !_bGeometryDirty && !_bStrokeDirty &&
+                 _cache->strokeHalfWidth != strokeStyle.strokeWidth * 0.5f)
+        {
+            /* only the cover geometry and stroke bounds (and the stroke gradient geometry that
+             * depends on them) need to be updated if the width changed */
+            _cache->strokeHalfWidth = strokeStyle.strokeWidth * 0.5f;
+            _cache->geometryCache.count = _cache->boundsVertexOffset;
+            _tpGLCacheBoundsGeometry(_cache, &strokeStyle);
+            if (_style->stroke.type == kTpPaintTypeGradient)
+                _bStrokeGradientDirty = tpTrue;
         }
+        _cache->strokeHalfWidth = strokeStyle.strokeWidth * 0.5f;
+    }
+    strokeBuffers.extrusions = &_builder->tmpExtrusions;
+    strokeBuffers.indices = &_builder->tmpIndices;
+    strokeBuffers.bExtrudeOnGPU = bExtrudeOnGPU;
 
-        /* generate and add the stroke geometry to the tmp buffers */
+    if (_bGeometryDirty)
+    {
+        _tpGLFlattenJobInput flattenInput;
+
+        flattenInput.path = _path;
+        flattenInput.oldCache = _oldCache;
+        flattenInput.mode = _builder->flatteningMode;
+        flattenInput.tolerance = tolerance;
+        flattenInput.transform = _cache->bIsLocalSpace ? NULL : &_builder->transform;
+        flattenInput.bClearDirtyFlags = (tpBool)(!bStyleHasStroke && bIsPathRenderCache);
+        flattenInput.bUpdateContourBounds = bIsPathRenderCache;
+        _tpGLFlattenPath(_builder,
+                         &flattenInput,
+                         &_builder->tmpVertices,
+                         &_builder->tmpJoints,
+                         &_builder->tmpRcContours,
+                         &bounds);
+
+        /* triangulate the fill if requested, unless its fans don't overlap anyways */
+        fillTriangleOffset = _builder->tmpVertices.count;
+        if (_builder->fillMode == kTpFillModeTriangulate &&
+            _style->fill.type != kTpPaintTypeNone && !_tpGLIsConvexFill(&_builder->tmpRcContours))
+        {
+            _tpGLTriangulateFill(
+                _builder, &_builder->tmpRcContours, _style->fillRule, &_builder->tmpVertices);
+        }
+        _cache->fillTriangleCount = _builder->tmpVertices.count - fillTriangleOffset;
+        if (!_tpGLRenderCacheVerticesEqual(_cache,
+                                           &_builder->tmpVertices,
+                                           NULL,
+                                           0,
+                                           fillTriangleOffset,
+                                           _cache->fillTriangleCount))
+            _tpGLRenderCacheMarkDirtyVertices(
+                _cache, fillTriangleOffset, fillTriangleOffset + _cache->fillTriangleCount);
+        _cache->fillTriangleOffset = fillTriangleOffset;
+
+        /* generate and add the stroke geometry to the tmp buffers. The stroke vertex offset of
+         * the cache is only updated afterwards, as _oldCache might be the same cache */
+        strokeVertexOffset = _builder->tmpVertices.count;
+        _cache->strokeVertexCount = 0;
+        _cache->strokeIndexCount = 0;
+        _tpGLIndexArrayClear(&_builder->tmpIndices);
+        _tpVec2ArrayClear(&_builder->tmpExtrusions);
         if (_style->stroke.type != kTpPaintTypeNone && _style->strokeWidth > 0)
         {
-            _cache->strokeVertexOffset = _ctx->tmpVertices.count;
-            _cache->strokeVertexCount = 0;
-            _tpGLStroke(_path,
-                        &_ctx->tmpRcContours,
+            strokeBuffers.fillVertices = &_builder->tmpVertices;
+            strokeBuffers.vertices = &_builder->tmpVertices;
+            _tpGLStroke(_builder,
+                        _path,
+                        &_builder->tmpRcContours,
                         bIsPathRenderCache,
                         _bStrokeDirty ? NULL : _oldCache,
-                        _style,
-                        &_ctx->tmpVertices,
-                        &_ctx->tmpJoints,
-                        &_cache->strokeVertexCount);
+                        &geometryStyle,
+                        &roundTable,
+                        &_builder->tmpJoints,
+                        &strokeBuffers,
+                        &_cache->strokeVertexCount,
+                        &_cache->strokeIndexCount);
         }
 
+        /* compare the new geometry to what the cache holds before it gets replaced */
+        _tpGLRenderCacheMarkDirtyContours(_cache,
+                                          &_builder->tmpRcContours,
+                                          &_builder->tmpVertices,
+                                          bExtrudeOnGPU ? &_builder->tmpExtrusions : NULL,
+                                          strokeVertexOffset,
+                                          &_builder->tmpIndices);
+        _cache->strokeVertexOffset = strokeVertexOffset;
+        _cache->roundSegmentCount = roundTable.count;
+        _tpGLRenderCacheSetStrokeBuffers(_cache, &strokeBuffers);
+
         /* save the path bounds */
         _cache->boundsCache = bounds;
 
@@ -4228,13 +8298,14 @@ TARP_API tpBool _tpGLCachePathImpl(_tpGLContext * _ctx,
         _tpGLRenderCacheContourArrayClear(&_cache->contours);
         _tpVec2ArrayClear(&_cache->geometryCache);
         _tpBoolArrayClear(&_cache->jointCache);
-        _tpGLRenderCacheContourArraySwap(&_cache->contours, &_ctx->tmpRcContours);
-        _tpVec2ArraySwap(&_cache->geometryCache, &_ctx->tmpVertices);
-        _tpBoolArraySwap(&_cache->jointCache, &_ctx->tmpJoints);
+        _tpGLRenderCacheContourArraySwap(&_cache->contours, &_builder->tmpRcContours);
+        _tpVec2ArraySwap(&_cache->geometryCache, &_builder->tmpVertices);
+        _tpBoolArraySwap(&_cache->jointCache, &_builder->tmpJoints);
+        _tpGLRenderCacheUpdateFillRanges(_cache);
 
         /* add the bounds geometry to the geom cache (and potentially cache
          * stroke bounds) */
-        _tpGLCacheBoundsGeometry(_cache, _style);
+        _tpGLCacheBoundsGeometry(_cache, &strokeStyle);
 
         /* we are done with the stroke allready... */
         _bStrokeDirty = tpFalse;
@@ -4247,87 +8318,201 @@ TARP_API tpBool _tpGLCachePathImpl(_tpGLContext * _ctx,
 
         /* the stroke was possibly removed, in that case this is enough */
         _cache->strokeVertexCount = 0;
+        _cache->strokeIndexCount = 0;
+        _tpGLIndexArrayClear(&_builder->tmpIndices);
+        _tpVec2ArrayClear(&_builder->tmpExtrusions);
 
+        _tpGLRenderCacheMarkDirtyIndices(_cache, 0, INT_MAX);
         if (bStyleHasStroke)
         {
             /* otherwise check if there was a previous stroke. If so, remove it along with the
-             * cached bounds geometry */
-            if (_cache->strokeVertexOffset)
-                _tpVec2ArrayRemoveRange(&_cache->geometryCache,
-                                        _cache->strokeVertexOffset,
-                                        _cache->geometryCache.count);
-            else
-                /* otherwise just remove the cached bounds geometry */
-                _tpVec2ArrayRemoveRange(&_cache->geometryCache,
-                                        _cache->geometryCache.count - 4,
-                                        _cache->geometryCache.count);
+             * cached cover geometry */
+            _tpGLRenderCacheMarkDirtyVertices(_cache,
+                                              _cache->strokeVertexOffset
+                                                  ? _cache->strokeVertexOffset
+                                                  : _cache->boundsVertexOffset,
+                                              INT_MAX);
+            _cache->geometryCache.count = _cache->strokeVertexOffset ? _cache->strokeVertexOffset
+                                                                     : _cache->boundsVertexOffset;
 
             /* generate and add the stroke geometry to the cache. */
             _cache->strokeVertexOffset = _cache->geometryCache.count;
-            _cache->strokeVertexCount = 0;
-            _tpGLStroke(_path,
+            strokeBuffers.fillVertices = &_cache->geometryCache;
+            strokeBuffers.vertices = &_cache->geometryCache;
+            _tpGLStroke(_builder,
+                        _path,
                         &_cache->contours,
                         bIsPathRenderCache,
                         NULL,
-                        _style,
-                        &_cache->geometryCache,
+                        &geometryStyle,
+                        &roundTable,
                         &_cache->jointCache,
-                        &_cache->strokeVertexCount);
-
-            /* add the stroke geometry to the cache. */
-            _tpGLCacheBoundsGeometry(_cache, _style);
+                        &strokeBuffers,
+                        &_cache->strokeVertexCount,
+                        &_cache->strokeIndexCount);
 
             /* force rebuilding of the stroke gradient geometry */
             _bStrokeGradientDirty = tpTrue;
         }
+        _cache->roundSegmentCount = roundTable.count;
+        _tpGLRenderCacheSetStrokeBuffers(_cache, &strokeBuffers);
+
+        /* add the cover geometry once the extrusions of the stroke are in place */
+        if (bStyleHasStroke)
+            _tpGLCacheBoundsGeometry(_cache, &strokeStyle);
     }
 
     if (_bFillGradientDirty || _bStrokeGradientDirty)
     {
-        _tpGLTextureVertexArrayClear(&_ctx->tmpTexVertices);
+        _tpGLTextureVertexArrayClear(&_builder->tmpTexVertices);
         if (_style->fill.type == kTpPaintTypeGradient)
         {
             _tpGLGradient * grad = (_tpGLGradient *)_style->fill.data.gradientData.gradient.pointer;
-            _tpGLCacheGradientGeometry(_ctx,
+            _tpGLCacheGradientGeometry(_builder,
                                        grad,
                                        _bFillGradientDirty ? NULL
                                                            : &_oldCache->textureGeometryCache,
                                        &_cache->fillGradientData,
-                                       &_ctx->tmpTexVertices,
+                                       &_builder->tmpTexVertices,
                                        &_path->fillPaintTransform,
-                                       _style->scaleStroke);
+                                       _cache->bIsLocalSpace);
         }
 
         if (_style->stroke.type == kTpPaintTypeGradient)
         {
             _tpGLGradient * grad =
                 (_tpGLGradient *)_style->stroke.data.gradientData.gradient.pointer;
-            _tpGLCacheGradientGeometry(_ctx,
+            _tpGLCacheGradientGeometry(_builder,
                                        grad,
                                        _bStrokeGradientDirty ? NULL
                                                              : &_oldCache->textureGeometryCache,
                                        &_cache->strokeGradientData,
-                                       &_ctx->tmpTexVertices,
+                                       &_builder->tmpTexVertices,
                                        &_path->strokePaintTransform,
-                                       _style->scaleStroke);
+                                       _cache->bIsLocalSpace);
         }
 
-        _tpGLTextureVertexArraySwap(&_cache->textureGeometryCache, &_ctx->tmpTexVertices);
+        _tpGLTextureVertexArraySwap(&_cache->textureGeometryCache, &_builder->tmpTexVertices);
+        _cache->bTextureGeometryDirty = tpTrue;
+        _cache->generation++;
     }
 
     return tpFalse;
 }
 
+/* caches a path with the geometry builder of the context, using its current transform */
+TARP_LOCAL tpBool _tpGLContextCachePath(_tpGLContext * _ctx,
+                                        _tpGLPath * _path,
+                                        const tpStyle * _style,
+                                        _tpGLRenderCache * _oldCache,
+                                        _tpGLRenderCache * _cache,
+                                        tpBool _bGeometryDirty,
+                                        tpBool _bStrokeDirty,
+                                        tpBool _bFillGradientDirty,
+                                        tpBool _bStrokeGradientDirty)
+{
+    int i;
+
+    assert(_ctx && _path && _cache);
+
+    /* if the rendercache is currently referenced in the clipping stack of the context, create a
+     * deep copy and replace it in the clipping stack. This ensures that the clipping masks will be
+     * identical in cases where the clipping stack needs to be rebuilt. */
+    for (i = 0; i < _ctx->clippingStackDepth; ++i)
+    {
+        if (_ctx->clippingStack[i] == _cache)
+        {
+            _tpGLRenderCache * c;
+            if (!_ctx->clippingRenderCaches[i])
+                _ctx->clippingRenderCaches[i] = (_tpGLRenderCache *)tpRenderCacheCreate().pointer;
+            c = _ctx->clippingRenderCaches[i];
+            _tpGLRenderCacheCopyTo(_cache, c);
+            _ctx->clippingStack[i] = c;
+        }
+    }
+
+    _tpGLUpdateTransformProjection(_ctx);
+    memcpy(_ctx->builder.viewport, _ctx->viewport, sizeof(_ctx->viewport));
+    _ctx->builder.transform = _ctx->transform;
+    _ctx->builder.projection = _ctx->projection;
+    _ctx->builder.transformProjection = _ctx->transformProjection;
+    _ctx->builder.transformScale = _ctx->transformScale;
+    _ctx->builder.projectionScale = _ctx->projectionScale;
+
+    return _tpGLCachePathImpl(&_ctx->builder,
+                              _path,
+                              _style,
+                              _oldCache,
+                              _cache,
+                              _bGeometryDirty,
+                              _bStrokeDirty,
+                              _bFillGradientDirty,
+                              _bStrokeGradientDirty);
+}
+
 TARP_API tpBool tpCachePath(tpContext _ctx,
                             tpPath _path,
                             const tpStyle * _style,
                             tpRenderCache _cache)
 {
-    _tpGLPath * path = (_tpGLPath *)_path.pointer;
-    return _tpGLCachePathImpl((_tpGLContext *)_ctx.pointer,
-                              path,
+    /* the internal render cache of the path was generated for a possibly different style and
+     * transform, hence everything is generated from scratch */
+    return _tpGLContextCachePath((_tpGLContext *)_ctx.pointer,
+                                 (_tpGLPath *)_path.pointer,
+                                 _style,
+                                 NULL,
+                                 (_tpGLRenderCache *)_cache.pointer,
+                                 tpTrue,
+                                 tpTrue,
+                                 tpTrue,
+                                 tpTrue);
+}
+
+TARP_API tpGeometryBuilder tpGeometryBuilderCreate(tpContext _ctx)
+{
+    tpGeometryBuilder ret;
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    _tpGLGeometryBuilder * builder =
+        (_tpGLGeometryBuilder *)TARP_MALLOC(sizeof(_tpGLGeometryBuilder));
+
+    _tpGLGeometryBuilderInit(builder);
+    builder->flatteningMode = ctx->builder.flatteningMode;
+    builder->flatteningTolerance = ctx->builder.flatteningTolerance;
+    builder->strokeExtrusionMode = ctx->builder.strokeExtrusionMode;
+    builder->fillMode = ctx->builder.fillMode;
+    memcpy(builder->viewport, ctx->viewport, sizeof(ctx->viewport));
+    builder->projection = ctx->projection;
+    builder->projectionScale = _tpGLDeviceScale(&ctx->projection, ctx->viewport);
+
+    ret.pointer = builder;
+    return ret;
+}
+
+TARP_API void tpGeometryBuilderDestroy(tpGeometryBuilder _builder)
+{
+    _tpGLGeometryBuilder * builder = (_tpGLGeometryBuilder *)_builder.pointer;
+    _tpGLGeometryBuilderDeallocate(builder);
+    TARP_FREE(builder);
+}
+
+TARP_API tpBool tpGeometryBuilderCachePath(tpGeometryBuilder _builder,
+                                           tpPath _path,
+                                           const tpStyle * _style,
+                                           const tpTransform * _transform,
+                                           tpRenderCache _cache)
+{
+    tpMat4 renderTransform;
+    _tpGLGeometryBuilder * builder = (_tpGLGeometryBuilder *)_builder.pointer;
+
+    builder->transform = *_transform;
+    renderTransform = tpMat4MakeFrom2DTransform(_transform);
+    builder->transformProjection = tpMat4Mult(&builder->projection, &renderTransform);
+    builder->transformScale = _tpGLDeviceScale(&builder->transformProjection, builder->viewport);
+
+    return _tpGLCachePathImpl(builder,
+                              (_tpGLPath *)_path.pointer,
                               _style,
-                              path->renderCache,
+                              NULL,
                               (_tpGLRenderCache *)_cache.pointer,
                               tpTrue,
                               tpTrue,
@@ -4335,169 +8520,649 @@ TARP_API tpBool tpCachePath(tpContext _ctx,
                               tpTrue);
 }
 
+/* checks if some of the contours of _cache might be culled when it is drawn with the device bounds
+ * _deviceBounds (see tpSetContourCulling) */
+TARP_LOCAL tpBool _tpGLCanCullContours(const _tpGLContext * _ctx,
+                                       const _tpGLRenderCache * _cache,
+                                       const _tpGLRect * _deviceBounds)
+{
+    return (tpBool)(_ctx->bCullContours && _cache->contourGridSize &&
+                    (_deviceBounds->min.x < _ctx->clipBounds.min.x ||
+                     _deviceBounds->max.x > _ctx->clipBounds.max.x ||
+                     _deviceBounds->min.y < _ctx->clipBounds.min.y ||
+                     _deviceBounds->max.y > _ctx->clipBounds.max.y));
+}
+
+/*
+collects the fans and stroke index ranges of the contours of _cache that overlap the clip bounds of
+the context in the visible contour arrays of the context and computes the box of window pixels they
+lie within. Needs to be called after the cache was bound. Returns tpFalse if no contours are culled,
+in which case the cache is drawn as a whole.
+*/
+TARP_LOCAL tpBool _tpGLCullContours(_tpGLContext * _ctx,
+                                    const _tpGLRenderCache * _cache,
+                                    GLint * _outBox)
+{
+    int i, j, x, y, cell, range[4];
+    tpFloat a, b, c, d, tx, ty, det, pad;
+    tpVec2 p;
+    _tpGLRect query, visible, device;
+    const _tpGLRect * bounds;
+    const _tpGLRenderCacheContour * contour;
+    const tpFloat * m = _cache->renderMatrix.v;
+    GLsizeiptr indexSize;
+
+    /* only affine render matrices can be inverted to bring the clip bounds into cache space */
+    if (!_ctx->bCullContours || !_cache->contourGridSize || m[3] != 0 || m[7] != 0 || m[15] <= 0)
+        return tpFalse;
+
+    a = m[0] / m[15];
+    b = m[1] / m[15];
+    c = m[4] / m[15];
+    d = m[5] / m[15];
+    tx = m[12] / m[15];
+    ty = m[13] / m[15];
+    det = a * d - b * c;
+    if (det == 0)
+        return tpFalse;
+
+    _tpGLInitBounds(&query);
+    for (i = 0; i < 4; ++i)
+    {
+        p = tpVec2Make((i & 1 ? _ctx->clipBounds.max.x : _ctx->clipBounds.min.x) - tx,
+                       (i & 2 ? _ctx->clipBounds.max.y : _ctx->clipBounds.min.y) - ty);
+        _tpGLEvaluatePointForBounds(
+            tpVec2Make((d * p.x - c * p.y) / det, (a * p.y - b * p.x) / det), &query);
+    }
+    /* some slack for the rounding of the inverse */
+    pad = 1e-4f * (query.max.x - query.min.x + query.max.y - query.min.y);
+    query.min = tpVec2Make(query.min.x - pad, query.min.y - pad);
+    query.max = tpVec2Make(query.max.x + pad, query.max.y + pad);
+
+    if (query.min.x <= _cache->contourGridBounds.min.x &&
+        query.min.y <= _cache->contourGridBounds.min.y &&
+        query.max.x >= _cache->contourGridBounds.max.x &&
+        query.max.y >= _cache->contourGridBounds.max.y)
+        return tpFalse;
+
+    _tpGLIntArrayClear(&_ctx->visibleFillFirsts);
+    _tpGLSizeiArrayClear(&_ctx->visibleFillCounts);
+    _tpGLSizeiArrayClear(&_ctx->visibleStrokeCounts);
+    _tpGLBufferOffsetArrayClear(&_ctx->visibleStrokeOffsets);
+    memset(_outBox, 0, sizeof(GLint) * 4);
+    if (!_tpGLContourGridRange(_cache, &query, range))
+        return tpTrue;
+
+    if (_ctx->contourStamps.count < _cache->contours.count)
+    {
+        _tpGLIntArrayReserveAdditional(&_ctx->contourStamps,
+                                       _cache->contours.count - _ctx->contourStamps.count);
+        memset(_ctx->contourStamps.array + _ctx->contourStamps.count,
+               0,
+               sizeof(int) * (_cache->contours.count - _ctx->contourStamps.count));
+        _ctx->contourStamps.count = _cache->contours.count;
+    }
+    if (_ctx->contourStamp == INT_MAX)
+    {
+        memset(_ctx->contourStamps.array, 0, sizeof(int) * _ctx->contourStamps.count);
+        _ctx->contourStamp = 0;
+    }
+    _ctx->contourStamp++;
+
+    indexSize = _cache->indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    _tpGLInitBounds(&visible);
+    for (y = range[1]; y <= range[3]; ++y)
+    {
+        for (x = range[0]; x <= range[2]; ++x)
+        {
+            cell = y * _cache->contourGridSize + x;
+            for (j = _cache->contourGridCells.array[cell];
+                 j < _cache->contourGridCells.array[cell + 1];
+                 ++j)
+            {
+                i = _cache->contourGridItems.array[j];
+                if (_ctx->contourStamps.array[i] == _ctx->contourStamp)
+                    continue;
+                _ctx->contourStamps.array[i] = _ctx->contourStamp;
+
+                bounds = &_cache->contourBounds.array[i];
+                if (bounds->min.x > query.max.x || bounds->max.x < query.min.x ||
+                    bounds->min.y > query.max.y || bounds->max.y < query.min.y)
+                    continue;
+
+                /* the order of the contours does not matter, neither for the stencil nor for
+                 * the single pass fills and strokes */
+                _tpGLMergeBounds(&visible, bounds);
+                contour = &_cache->contours.array[i];
+                _tpGLIntArrayAppend(&_ctx->visibleFillFirsts, contour->fillVertexOffset);
+                _tpGLSizeiArrayAppend(&_ctx->visibleFillCounts, contour->fillVertexCount);
+                if (contour->strokeIndexCount)
+                {
+                    _tpGLSizeiArrayAppend(&_ctx->visibleStrokeCounts, contour->strokeIndexCount);
+                    _tpGLBufferOffsetArrayAppend(
+                        &_ctx->visibleStrokeOffsets,
+                        ((char *)0) + _ctx->drawIndexOffset +
+                            contour->strokeIndexOffset * indexSize);
+                }
+            }
+        }
+    }
+
+    if (!_ctx->visibleFillFirsts.count)
+        return tpTrue;
+
+    /* everything is drawn within the device bounds of the visible contours */
+    _tpGLInitBounds(&device);
+    for (i = 0; i < 4; ++i)
+    {
+        p = tpVec2Make(i & 1 ? visible.max.x : visible.min.x,
+                       i & 2 ? visible.max.y : visible.min.y);
+        _tpGLEvaluatePointForBounds(
+            tpVec2Make(a * p.x + c * p.y + tx, b * p.x + d * p.y + ty), &device);
+    }
+    _tpGLIntersectBounds(&device, &_ctx->clipBounds);
+    _tpGLWindowBox(_ctx, &device, _outBox);
+    return tpTrue;
+}
+
 TARP_LOCAL tpBool _tpGLDrawRenderCacheImpl(_tpGLContext * _ctx,
                                            _tpGLRenderCache * _cache,
                                            tpBool _bIsClipPath)
 {
-    GLint i;
-    GLuint stencilPlaneToWriteTo, stencilPlaneToTestAgainst;
+    tpBool bSinglePassStroke, bCullContours;
+    _tpGLRect deviceBounds;
+    GLint box[4], scissorBox[4];
+    GLboolean bScissorTest;
+    const GLint * fillFirsts;
+    const GLsizei * fillCounts;
+    GLsizei fillCount;
 
     if (!_cache->contours.count)
         return tpFalse;
 
     assert(_cache->geometryCache.count);
 
-    if (!_bIsClipPath && (_cache->style.fill.type == kTpPaintTypeGradient ||
-                          _cache->style.stroke.type == kTpPaintTypeGradient))
+    /* upload whatever changed since the cache was last drawn (or stream all of it) */
+    _tpGLBindRenderCache(_ctx, _cache);
+
+    fillFirsts = _cache->fillFirsts.array;
+    fillCounts = _cache->fillCounts.array;
+    fillCount = _cache->fillFirsts.count;
+
+    /* only draw the visible contours and clamp all passes (including the cover) to where they are
+     * with the scissor test */
+    bCullContours = (tpBool)(!_bIsClipPath && _tpGLCullContours(_ctx, _cache, box));
+    if (bCullContours)
     {
-        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->textureVao.vbo));
-        _tpGLUpdateVAO(&_ctx->textureVao,
-                       _cache->textureGeometryCache.array,
-                       sizeof(_tpGLTextureVertex) * _cache->textureGeometryCache.count);
-        _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->vao.vbo));
-    }
+        if (!_ctx->visibleFillFirsts.count)
+            return tpFalse;
+
+        fillFirsts = _ctx->visibleFillFirsts.array;
+        fillCounts = _ctx->visibleFillCounts.array;
+        fillCount = _ctx->visibleFillFirsts.count;
 
-    /* upload the paths geometry cache to the gpu */
-    _tpGLUpdateVAO(
-        &_ctx->vao, _cache->geometryCache.array, sizeof(tpVec2) * _cache->geometryCache.count);
+        bScissorTest = _ctx->bScissorTest;
+        memcpy(scissorBox, _ctx->scissorBox, sizeof(scissorBox));
+        _tpGLIntersectScissor(_ctx, box);
+        _tpGLApplyScissor(_ctx);
+    }
 
     _TARP_ASSERT_NO_GL_ERROR(
         glUniformMatrix4fv(_ctx->tpLoc, 1, GL_FALSE, &_cache->renderMatrix.v[0]));
 
     /* draw the fill */
-    stencilPlaneToWriteTo =
-        _bIsClipPath ? _ctx->currentClipStencilPlane : _kTpGLFillRasterStencilPlane;
-    stencilPlaneToTestAgainst = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne
-                                    ? _kTpGLClippingStencilPlaneTwo
-                                    : _kTpGLClippingStencilPlaneOne;
-
-    if (_bIsClipPath || _cache->style.fill.type != kTpPaintTypeNone)
+    if (!_bIsClipPath && (_cache->bConvexFill || _cache->fillTriangleCount) &&
+        _cache->style.fill.type == kTpPaintTypeColor)
+    {
+        /* every pixel is covered by at most one triangle, so draw the color right away */
+        _tpGLStencilFuncClip(_ctx, 0, 0);
+        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP));
+        _TARP_ASSERT_NO_GL_ERROR(
+            glUniform4fv(_ctx->meshColorLoc, 1, &_cache->style.fill.data.color.r));
+        if (_cache->fillTriangleCount)
+            _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(
+                GL_TRIANGLES, _cache->fillTriangleOffset, _cache->fillTriangleCount));
+        else
+            _TARP_ASSERT_NO_GL_ERROR(
+                glMultiDrawArrays(GL_TRIANGLE_FAN, fillFirsts, fillCounts, fillCount));
+    }
+    else if (_bIsClipPath || _cache->style.fill.type != kTpPaintTypeNone)
     {
-        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(
-            _ctx->clippingStackDepth ? GL_EQUAL : GL_ALWAYS, 0, stencilPlaneToTestAgainst));
+        _tpGLStencilFuncClip(_ctx, 0, 0);
         _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
-        if (_cache->style.fillRule == kTpFillRuleEvenOdd)
+        _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane));
+        /* the triangles of a triangulated fill don't overlap, regardless of the fill rule */
+        if (_cache->fillTriangleCount || _cache->style.fillRule == kTpFillRuleEvenOdd)
         {
-            _TARP_ASSERT_NO_GL_ERROR(glStencilMask(stencilPlaneToWriteTo));
             _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
 
-            for (i = 0; i < _cache->contours.count; ++i)
-            {
-                _tpGLRenderCacheContour * c =
-                    _tpGLRenderCacheContourArrayAtPtr(&_cache->contours, i);
-
+            if (_cache->fillTriangleCount)
+                _TARP_ASSERT_NO_GL_ERROR(glDrawArrays(
+                    GL_TRIANGLES, _cache->fillTriangleOffset, _cache->fillTriangleCount));
+            else
                 _TARP_ASSERT_NO_GL_ERROR(
-                    glDrawArrays(GL_TRIANGLE_FAN, c->fillVertexOffset, c->fillVertexCount));
-            }
-
-            if (_bIsClipPath)
-            {
-                _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
-                return tpFalse;
-            }
-
-            _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 0, _kTpGLFillRasterStencilPlane));
+                    glMultiDrawArrays(GL_TRIANGLE_FAN, fillFirsts, fillCounts, fillCount));
         }
         else if (_cache->style.fillRule == kTpFillRuleNonZero)
         {
             /*
             NonZero winding rule needs to use Increment and Decrement
-            stencil operations. we therefore render to the rasterize mask,
-            even if this is a clipping mask, and transfer the results to the
-            clipping mask stencil plane afterwards
+            stencil operations. Clockwise (front facing) triangles increment and counter
+            clockwise ones decrement the winding, so all contours are rasterized in a single pass.
             */
-            _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane));
-            _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INCR_WRAP));
-            _TARP_ASSERT_NO_GL_ERROR(glEnable(GL_CULL_FACE));
-            _TARP_ASSERT_NO_GL_ERROR(glCullFace(GL_BACK));
-            _TARP_ASSERT_NO_GL_ERROR(glFrontFace(GL_CW));
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP));
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP));
 
-            for (i = 0; i < _cache->contours.count; ++i)
-            {
-                _tpGLRenderCacheContour * c =
-                    _tpGLRenderCacheContourArrayAtPtr(&_cache->contours, i);
-                _TARP_ASSERT_NO_GL_ERROR(
-                    glDrawArrays(GL_TRIANGLE_FAN, c->fillVertexOffset, c->fillVertexCount));
-            }
+            _TARP_ASSERT_NO_GL_ERROR(
+                glMultiDrawArrays(GL_TRIANGLE_FAN, fillFirsts, fillCounts, fillCount));
+        }
 
-            _TARP_ASSERT_NO_GL_ERROR(glFrontFace(GL_CCW));
-            _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_DECR_WRAP));
+        if (_bIsClipPath)
+        {
+            /*
+            move the pixels inside of the clip path one level deeper into the clipping stack and
+            zero out the fill raster plane in the same pass. Pixels outside of the clipping mask
+            so far were not rasterized by the fill, so they stay at their level.
+            */
+            _TARP_ASSERT_NO_GL_ERROR(
+                glStencilMask(_kTpGLFillRasterStencilPlane | _kTpGLClippingStencilPlane));
+            _TARP_ASSERT_NO_GL_ERROR(
+                glStencilFunc(GL_NOTEQUAL,
+                              (_ctx->clippingStackDepth + 1) << _kTpGLClippingDepthShift,
+                              _kTpGLFillRasterStencilPlane));
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
+            _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(GL_TRIANGLE_FAN,
+                                                       _cache->fillCoverFirsts.array,
+                                                       _cache->fillCoverCounts.array,
+                                                       _cache->fillCoverFirsts.count));
+            _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+            return tpFalse;
+        }
 
-            for (i = 0; i < _cache->contours.count; ++i)
-            {
-                _tpGLRenderCacheContour * c =
-                    _tpGLRenderCacheContourArrayAtPtr(&_cache->contours, i);
-                _TARP_ASSERT_NO_GL_ERROR(
-                    glDrawArrays(GL_TRIANGLE_FAN, c->fillVertexOffset, c->fillVertexCount));
-            }
+        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 0, _kTpGLFillRasterStencilPlane));
+        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO));
+        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
 
-            _TARP_ASSERT_NO_GL_ERROR(glDisable(GL_CULL_FACE));
-            _TARP_ASSERT_NO_GL_ERROR(glFrontFace(GL_CW));
+        _tpGLDrawPaint(_ctx,
+                       _cache,
+                       &_cache->style.fill,
+                       &_cache->fillGradientData,
+                       &_cache->fillCoverFirsts,
+                       &_cache->fillCoverCounts);
+    }
 
-            if (_bIsClipPath)
-            {
-                _TARP_ASSERT_NO_GL_ERROR(glStencilMask(stencilPlaneToWriteTo));
-                _TARP_ASSERT_NO_GL_ERROR(
-                    glStencilFunc(GL_NOTEQUAL, 0, _kTpGLFillRasterStencilPlane));
-                _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO));
+    /* we don't care for stroke if this is a clipping path */
+    if (_bIsClipPath)
+        return tpFalse;
 
-                _TARP_ASSERT_NO_GL_ERROR(
-                    glDrawArrays(GL_TRIANGLE_STRIP, _cache->boundsVertexOffset, 4));
+    /* draw the stroke */
+    bSinglePassStroke = (tpBool)(_cache->style.stroke.type == kTpPaintTypeColor);
+    if (_cache->strokeIndexCount && bSinglePassStroke)
+    {
+        _tpGLBeginSinglePassStroke(_ctx);
+        _TARP_ASSERT_NO_GL_ERROR(
+            glUniform4fv(_ctx->meshColorLoc, 1, &_cache->style.stroke.data.color.r));
+    }
+    else if (_cache->strokeIndexCount)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLStrokeRasterStencilPlane));
+        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+        _tpGLStencilFuncClip(_ctx, _kTpGLStrokeRasterStencilPlane, 0);
+        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
+    }
 
-                /*
-                draw the bounds one last time to zero out the tmp data
-                created in the _kTpGLFillRasterStencilPlane
-                */
-                _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane));
-                _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO));
-                _TARP_ASSERT_NO_GL_ERROR(
-                    glDrawArrays(GL_TRIANGLE_STRIP, _cache->boundsVertexOffset, 4));
+    if (_cache->strokeIndexCount)
+    {
+
+        /* Draw all stroke triangles of all contours at once */
+        if (_cache->bExtrudeStrokeOnGPU)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+            _TARP_ASSERT_NO_GL_ERROR(
+                glUniform1f(_ctx->strokeHalfWidthLoc, _cache->strokeHalfWidth));
+        }
+        if (bCullContours)
+            _TARP_ASSERT_NO_GL_ERROR(glMultiDrawElements(GL_TRIANGLES,
+                                                         _ctx->visibleStrokeCounts.array,
+                                                         _cache->indexType,
+                                                         _ctx->visibleStrokeOffsets.array,
+                                                         _ctx->visibleStrokeCounts.count));
+        else
+            _TARP_ASSERT_NO_GL_ERROR(
+                glDrawElements(GL_TRIANGLES,
+                               _cache->strokeIndexCount,
+                               _cache->indexType,
+                               ((char *)0) + _ctx->drawIndexOffset));
+        if (_cache->bExtrudeStrokeOnGPU)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glDisableVertexAttribArray(1));
+            _TARP_ASSERT_NO_GL_ERROR(glUniform1f(_ctx->strokeHalfWidthLoc, 0.0f));
+        }
+    }
+
+    if (_cache->strokeIndexCount && bSinglePassStroke)
+    {
+        deviceBounds = _tpGLRenderCacheDeviceBounds(_cache);
+        _tpGLClearStrokeStencilPlane(_ctx, &deviceBounds);
+    }
+    else if (_cache->strokeIndexCount)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 0, _kTpGLStrokeRasterStencilPlane));
+        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
 
-                _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+        _tpGLDrawPaint(_ctx,
+                       _cache,
+                       &_cache->style.stroke,
+                       &_cache->strokeGradientData,
+                       &_cache->strokeCoverFirsts,
+                       &_cache->strokeCoverCounts);
+    }
 
-                return tpFalse;
-            }
-            else
+    if (bCullContours)
+    {
+        _ctx->bScissorTest = bScissorTest;
+        memcpy(_ctx->scissorBox, scissorBox, sizeof(scissorBox));
+        _tpGLApplyScissor(_ctx);
+    }
+
+    /* WE DONE BABY */
+    return tpFalse;
+}
+
+/* draws a cache right away or adds it to the batch if draw batching is enabled */
+TARP_LOCAL tpBool _tpGLDrawOrBatchRenderCache(_tpGLContext * _ctx, _tpGLRenderCache * _cache)
+{
+    _tpGLRect deviceBounds;
+
+    if (!_cache->contours.count)
+        return tpFalse;
+
+    /* nothing of the cache would be visible */
+    deviceBounds = _tpGLRenderCacheDeviceBounds(_cache);
+    if (_tpGLIsCulled(_ctx, &deviceBounds))
+        return tpFalse;
+
+    /* caches whose contours get culled are drawn on their own */
+    if (_ctx->bBatchDraws && _tpGLDrawBatchCanContain(_cache) &&
+        !_tpGLCanCullContours(_ctx, _cache, &deviceBounds))
+    {
+        /* the batch is only created once it is needed */
+        if (!_ctx->batch.vao)
+            _tpGLDrawBatchInit(&_ctx->batch);
+        if (!_tpGLDrawBatchIsCompatible(&_ctx->batch, _cache, &deviceBounds))
+            _tpGLDrawBatchFlush(_ctx);
+        _tpGLDrawBatchAdd(&_ctx->batch, _cache, &deviceBounds);
+        return tpFalse;
+    }
+
+    /* keep the painter's order */
+    _tpGLDrawBatchFlush(_ctx);
+    return _tpGLDrawRenderCacheImpl(_ctx, _cache, tpFalse);
+}
+
+/*
+marks the cells of the instance grid covered by _bounds for the current run. Returns tpTrue if one
+of them was already marked, in which case nothing is marked.
+*/
+TARP_LOCAL tpBool _tpGLInstanceGridMark(_tpGLContext * _ctx, const _tpGLRect * _bounds)
+{
+    int x, y, minX, minY, maxX, maxY;
+    const tpFloat scale = 0.5f * TARP_GL_INSTANCE_GRID_SIZE;
+
+    minX = (int)((TARP_MAX(_bounds->min.x, -1.0f) + 1.0f) * scale);
+    minY = (int)((TARP_MAX(_bounds->min.y, -1.0f) + 1.0f) * scale);
+    maxX = (int)((TARP_MIN(_bounds->max.x, 1.0f) + 1.0f) * scale);
+    maxY = (int)((TARP_MIN(_bounds->max.y, 1.0f) + 1.0f) * scale);
+    maxX = TARP_MIN(maxX, TARP_GL_INSTANCE_GRID_SIZE - 1);
+    maxY = TARP_MIN(maxY, TARP_GL_INSTANCE_GRID_SIZE - 1);
+
+    for (y = minY; y <= maxY; ++y)
+    {
+        for (x = minX; x <= maxX; ++x)
+        {
+            if (_ctx->instanceGrid[y * TARP_GL_INSTANCE_GRID_SIZE + x] == _ctx->instanceRunStamp)
+                return tpTrue;
+        }
+    }
+
+    for (y = minY; y <= maxY; ++y)
+    {
+        for (x = minX; x <= maxX; ++x)
+            _ctx->instanceGrid[y * TARP_GL_INSTANCE_GRID_SIZE + x] = _ctx->instanceRunStamp;
+    }
+    return tpFalse;
+}
+
+/* starts a new run of instances that don't overlap */
+TARP_LOCAL void _tpGLInstanceGridBeginRun(_tpGLContext * _ctx)
+{
+    if (_ctx->instanceRunStamp == INT_MAX)
+    {
+        memset(_ctx->instanceGrid, 0, sizeof(_ctx->instanceGrid));
+        _ctx->instanceRunStamp = 0;
+    }
+    _ctx->instanceRunStamp++;
+}
+
+/*
+writes the data of all visible instances to the instance buffer and splits them into runs of
+consecutive instances that don't overlap. Returns the number of visible instances.
+*/
+TARP_LOCAL int _tpGLPrepareInstances(_tpGLContext * _ctx,
+                                     const _tpGLRenderCache * _cache,
+                                     const tpRenderCacheInstance * _instances,
+                                     int _count)
+{
+    int i, visibleCount;
+    tpMat4 instanceMatrix, matrix;
+    _tpGLRect bounds;
+    tpFloat * data;
+    const tpRenderCacheInstance * inst;
+
+    _tpFloatArrayClear(&_ctx->instanceData);
+    _tpGLIntArrayClear(&_ctx->instanceRuns);
+    _tpGLRectArrayClear(&_ctx->instanceRunBounds);
+    _tpFloatArrayReserveAdditional(&_ctx->instanceData, _count * _kTpGLInstanceFloatCount);
+    _tpGLInstanceGridBeginRun(_ctx);
+
+    visibleCount = 0;
+    for (i = 0; i < _count; ++i)
+    {
+        inst = &_instances[i];
+        instanceMatrix = tpMat4MakeFrom2DTransform(&inst->transform);
+        matrix = tpMat4Mult(&instanceMatrix, &_cache->renderTransform);
+        matrix = tpMat4Mult(&_cache->renderProjection, &matrix);
+        bounds = _tpGLRenderCacheDeviceBoundsWithMatrix(_cache, &matrix);
+
+        /* skip instances that are outside of the viewport or the active clip paths */
+        if (_tpGLIsCulled(_ctx, &bounds))
+            continue;
+
+        if (!_ctx->instanceRuns.count || _tpGLInstanceGridMark(_ctx, &bounds))
+        {
+            if (_ctx->instanceRuns.count)
             {
-                _TARP_ASSERT_NO_GL_ERROR(
-                    glStencilFunc(GL_NOTEQUAL, 0, _kTpGLFillRasterStencilPlane));
+                _tpGLInstanceGridBeginRun(_ctx);
+                _tpGLInstanceGridMark(_ctx, &bounds);
             }
+            _tpGLIntArrayAppend(&_ctx->instanceRuns, visibleCount);
+            _tpGLRectArrayAppendPtr(&_ctx->instanceRunBounds, &bounds);
         }
+        else
+        {
+            _tpGLMergeBounds(&_ctx->instanceRunBounds.array[_ctx->instanceRunBounds.count - 1],
+                             &bounds);
+        }
+
+        data = _ctx->instanceData.array + visibleCount * _kTpGLInstanceFloatCount;
+        memcpy(data, inst->transform.m.v, sizeof(tpFloat) * 4);
+        data[4] = inst->transform.t.x;
+        data[5] = inst->transform.t.y;
+        memcpy(data + 6, &inst->fill.r, sizeof(tpFloat) * 4);
+        memcpy(data + 10, &inst->stroke.r, sizeof(tpFloat) * 4);
+        visibleCount++;
+    }
+    _ctx->instanceData.count = visibleCount * _kTpGLInstanceFloatCount;
+    _tpGLIntArrayAppend(&_ctx->instanceRuns, visibleCount);
+
+    return visibleCount;
+}
+
+/* points the per instance vertex attributes at the instances starting at _first */
+TARP_LOCAL void _tpGLSetInstanceAttributes(int _first)
+{
+    char * offset = ((char *)0) + _first * _kTpGLInstanceFloatCount * sizeof(tpFloat);
+    GLsizei stride = _kTpGLInstanceFloatCount * sizeof(tpFloat);
+
+    _TARP_ASSERT_NO_GL_ERROR(glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, offset));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, stride, offset + 4 * sizeof(tpFloat)));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, offset + 6 * sizeof(tpFloat)));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, offset + 10 * sizeof(tpFloat)));
+}
+
+/* draws _count instances of the cache that don't overlap with the same stencil and cover calls.
+ * _bounds are the device bounds of all of them */
+TARP_LOCAL void _tpGLDrawRenderCacheInstances(_tpGLContext * _ctx,
+                                              const _tpGLRenderCache * _cache,
+                                              GLsizei _count,
+                                              const _tpGLRect * _bounds)
+{
+    int i;
 
+    if (_cache->style.fill.type == kTpPaintTypeColor && _cache->bConvexFill)
+    {
+        /* the instances of a run don't overlap either, so the fans can be drawn directly */
+        _tpGLStencilFuncClip(_ctx, 0, 0);
+        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP));
+        _TARP_ASSERT_NO_GL_ERROR(glUniform1i(_ctx->instanceColorSlotLoc, 0));
+        for (i = 0; i < _cache->fillFirsts.count; ++i)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glDrawArraysInstanced(GL_TRIANGLE_FAN,
+                                                           _cache->fillFirsts.array[i],
+                                                           _cache->fillCounts.array[i],
+                                                           _count));
+        }
+    }
+    else if (_cache->style.fill.type == kTpPaintTypeColor)
+    {
+        _tpGLStencilFuncClip(_ctx, 0, 0);
+        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
         _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLFillRasterStencilPlane));
+        if (_cache->style.fillRule == kTpFillRuleEvenOdd)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
+        }
+        else
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP));
+            _TARP_ASSERT_NO_GL_ERROR(glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP));
+        }
+
+        /* there is no instanced version of glMultiDrawArrays, so draw the contours one by one */
+        for (i = 0; i < _cache->fillFirsts.count; ++i)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glDrawArraysInstanced(GL_TRIANGLE_FAN,
+                                                           _cache->fillFirsts.array[i],
+                                                           _cache->fillCounts.array[i],
+                                                           _count));
+        }
+
+        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 0, _kTpGLFillRasterStencilPlane));
         _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO));
         _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+        _TARP_ASSERT_NO_GL_ERROR(glUniform1i(_ctx->instanceColorSlotLoc, 0));
+        for (i = 0; i < _cache->fillCoverFirsts.count; ++i)
+        {
+            _TARP_ASSERT_NO_GL_ERROR(glDrawArraysInstanced(GL_TRIANGLE_FAN,
+                                                           _cache->fillCoverFirsts.array[i],
+                                                           _cache->fillCoverCounts.array[i],
+                                                           _count));
+        }
+    }
+
+    if (_cache->strokeIndexCount && _cache->style.stroke.type == kTpPaintTypeColor)
+    {
+        _tpGLBeginSinglePassStroke(_ctx);
+        _TARP_ASSERT_NO_GL_ERROR(glUniform1i(_ctx->instanceColorSlotLoc, 1));
+        if (_cache->bExtrudeStrokeOnGPU)
+            _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(1));
+        _TARP_ASSERT_NO_GL_ERROR(
+            glDrawElementsInstanced(GL_TRIANGLES,
+                                    _cache->strokeIndexCount,
+                                    _cache->indexType,
+                                    ((char *)0) + _ctx->drawIndexOffset,
+                                    _count));
+        if (_cache->bExtrudeStrokeOnGPU)
+            _TARP_ASSERT_NO_GL_ERROR(glDisableVertexAttribArray(1));
+        _tpGLClearStrokeStencilPlane(_ctx, _bounds);
+    }
+}
+
+TARP_LOCAL tpBool _tpGLDrawRenderCacheInstanced(_tpGLContext * _ctx,
+                                                _tpGLRenderCache * _cache,
+                                                const tpRenderCacheInstance * _instances,
+                                                int _count)
+{
+    int i, attr;
 
-        _tpGLDrawPaint(_ctx, _cache, &_cache->style.fill, &_cache->fillGradientData);
+    if (_cache->style.fill.type == kTpPaintTypeGradient ||
+        _cache->style.stroke.type == kTpPaintTypeGradient)
+    {
+        _tpGLSetErrorMessage("Render caches with gradient paints can't be drawn instanced.");
+        return tpTrue;
     }
 
-    /* we don't care for stroke if this is a clipping path */
-    if (_bIsClipPath)
+    if (!_cache->contours.count || _count <= 0)
+        return tpFalse;
+
+    if (!_tpGLPrepareInstances(_ctx, _cache, _instances, _count))
         return tpFalse;
 
-    /* draw the stroke */
-    if (_cache->strokeVertexCount)
-    {
-        _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLStrokeRasterStencilPlane));
-        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
-        /* @TODO: Not sure if this test will work with non 8 bit stencil
-         * buffers, but is there such a thing oO? */
-        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(
-            _ctx->clippingStackDepth ? GL_NOTEQUAL : GL_ALWAYS, 0xff, stencilPlaneToTestAgainst));
-        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
+    /* keep the painter's order */
+    _tpGLDrawBatchFlush(_ctx);
 
-        /* Draw all stroke triangles of all contours at once */
-        _TARP_ASSERT_NO_GL_ERROR(
-            glDrawArrays(GL_TRIANGLES, _cache->strokeVertexOffset, _cache->strokeVertexCount));
+    _tpGLBindRenderCache(_ctx, _cache);
 
-        _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
-        _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_NOTEQUAL, 0, _kTpGLStrokeRasterStencilPlane));
-        _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT));
+    if (!_ctx->instanceVbo)
+        _TARP_ASSERT_NO_GL_ERROR(glGenBuffers(1, &_ctx->instanceVbo));
+    _TARP_ASSERT_NO_GL_ERROR(glBindBuffer(GL_ARRAY_BUFFER, _ctx->instanceVbo));
+    _TARP_ASSERT_NO_GL_ERROR(glBufferData(GL_ARRAY_BUFFER,
+                                          sizeof(tpFloat) * _ctx->instanceData.count,
+                                          _ctx->instanceData.array,
+                                          GL_STREAM_DRAW));
 
-        _tpGLDrawPaint(_ctx, _cache, &_cache->style.stroke, &_cache->strokeGradientData);
+    for (attr = 3; attr <= 6; ++attr)
+    {
+        _TARP_ASSERT_NO_GL_ERROR(glEnableVertexAttribArray(attr));
+        _TARP_ASSERT_NO_GL_ERROR(glVertexAttribDivisor(attr, 1));
     }
 
-    /* WE DONE BABY */
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->instanceProgram));
+    _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix4fv(
+        _ctx->instanceProjectionLoc, 1, GL_FALSE, &_cache->renderProjection.v[0]));
+    _TARP_ASSERT_NO_GL_ERROR(glUniformMatrix4fv(
+        _ctx->instanceRenderTransformLoc, 1, GL_FALSE, &_cache->renderTransform.v[0]));
+    _TARP_ASSERT_NO_GL_ERROR(
+        glUniform1f(_ctx->instanceStrokeHalfWidthLoc,
+                    _cache->bExtrudeStrokeOnGPU ? _cache->strokeHalfWidth : 0.0f));
+
+    for (i = 0; i < _ctx->instanceRuns.count - 1; ++i)
+    {
+        _tpGLSetInstanceAttributes(_ctx->instanceRuns.array[i]);
+        _tpGLDrawRenderCacheInstances(_ctx,
+                                      _cache,
+                                      _ctx->instanceRuns.array[i + 1] - _ctx->instanceRuns.array[i],
+                                      &_ctx->instanceRunBounds.array[i]);
+    }
+
+    for (attr = 3; attr <= 6; ++attr)
+        _TARP_ASSERT_NO_GL_ERROR(glDisableVertexAttribArray(attr));
+    _TARP_ASSERT_NO_GL_ERROR(glUseProgram(_ctx->program));
+
     return tpFalse;
 }
 
@@ -4507,18 +9172,36 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
                                                tpBool _bIsClipPath)
 {
     tpBool bGeometryDirty, bStrokeDirty, bFillGradientDirty, bStrokeGradientDirty,
-        bMarkAllContoursDirty, bVirgin, bTransformDirty;
+        bMarkAllContoursDirty, bVirgin, bTransformDirty, bLodBandChanged, bIsLocalSpace,
+        bStrokeWidthOnGPU, bStrokeWidthDirty;
     _tpGLRenderCache * cache;
+    tpFloat strokeScale;
+    int lodBand;
 
     bTransformDirty = tpFalse;
+    bLodBandChanged = tpFalse;
+    bStrokeWidthDirty = tpFalse;
 
     /* early out if the path has no contours */
     if (!_path->contours.count)
         return tpFalse;
 
+    _tpGLUpdateTransformProjection(_ctx);
+
     bVirgin = (tpBool)(_path->renderCache == NULL);
     cache = _tpGLPathEnsureRenderCache(_path);
 
+    /* see _tpGLCachePathImpl */
+    strokeScale = 1.0f;
+    bIsLocalSpace = (tpBool)(_style->scaleStroke ||
+                             _tpGLTransformIsSimilarity(&_ctx->transform, &strokeScale));
+    lodBand = bIsLocalSpace ? _tpGLLodBand(_ctx->transformScale) : _kTpGLInvalidLodBand;
+
+    /* if the stroke is extruded on the gpu, changing its width (or the scale of a non scaling
+     * stroke) does not require new geometry, unless the stroke is dashed */
+    bStrokeWidthOnGPU = (tpBool)(_ctx->builder.strokeExtrusionMode == kTpStrokeExtrusionModeGPU &&
+                                 _style->dashCount == 0);
+
     if (!bVirgin)
     {
         /* this block of code checks what part of the geometry/path are dirty compared to its cached
@@ -4535,21 +9218,37 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
             _path->lastProjectionID != _ctx->projectionID)
         {
             bTransformDirty = tpTrue;
-
-            /* @TODO: we should also take skew into account here, not only scale
-             * @TODO: Proper epsilon
-             */
-            if (_ctx->transformScale - _path->lastTransformScale > 0.001f || !_style->scaleStroke)
-            {
-                bMarkAllContoursDirty = tpTrue;
-            }
-
             _path->lastTransformID = _ctx->transformID;
             _path->lastProjectionID = _ctx->projectionID;
             _path->lastDrawContext = _ctx;
-            _path->lastTransformScale = _ctx->transformScale;
         }
 
+        /* the geometry related settings of the context changed since the path was cached */
+        if (_path->lastGeometrySettingsID != _ctx->geometrySettingsID)
+            bMarkAllContoursDirty = tpTrue;
+
+        /* the geometry cached for other scale bands is stale if the path or the settings changed */
+        if (_path->bPathGeometryDirty || _path->lastGeometrySettingsID != _ctx->geometrySettingsID)
+            _tpGLPathInvalidateLodCaches(_path);
+
+        /* switch to the render cache of the current scale band if the scale left the band */
+        if (bIsLocalSpace && lodBand != _path->lodBands[_path->lodIndex])
+        {
+            bLodBandChanged = tpTrue;
+            if (_tpGLPathSelectLodCache(_path, lodBand))
+                bMarkAllContoursDirty = tpTrue;
+            cache = _path->renderCache;
+        }
+
+        /* geometry that was generated after applying the transform (non scaling strokes under a
+         * transform that is not a similarity) needs to be regenerated if the transform changed */
+        if (cache->bIsLocalSpace != bIsLocalSpace || (!bIsLocalSpace && bTransformDirty))
+            bMarkAllContoursDirty = tpTrue;
+        /* non scaling strokes in local space only need to be regenerated if the scale changed */
+        else if (!_style->scaleStroke && !bStrokeWidthOnGPU &&
+                 !_tpGLStrokeScaleEquals(strokeScale, cache->strokeScale))
+            bStrokeDirty = tpTrue;
+
         /*
         if this style has a stroke and its scale stroke property is different
         from the last style, we force a full reflattening of all path contours.
@@ -4565,6 +9264,14 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
             bStrokeDirty = tpTrue;
         }
 
+        /* the triangles of the fill depend on the fill rule and on whether there is a fill. The
+         * contours themselves can be reused */
+        if (_ctx->builder.fillMode == kTpFillModeTriangulate &&
+            (cache->style.fillRule != _style->fillRule ||
+             (cache->style.fill.type == kTpPaintTypeNone) !=
+                 (_style->fill.type == kTpPaintTypeNone)))
+            bGeometryDirty = tpTrue;
+
         if (!_bIsClipPath && !bStrokeDirty &&
             (cache->style.stroke.type !=
                  _style->stroke.type || /* @TODO: This could be optimized by checking if either the
@@ -4572,7 +9279,8 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
                                            current type are different (i.e. so if you change from
                                            solid fill to gradient and vice versa the geometry does
                                            not regenerate, which it will right now)*/
-             cache->style.strokeWidth != _style->strokeWidth ||
+             (bStrokeWidthOnGPU ? (cache->style.strokeWidth > 0) != (_style->strokeWidth > 0)
+                                : cache->style.strokeWidth != _style->strokeWidth) ||
              cache->style.strokeCap != _style->strokeCap ||
              cache->style.strokeJoin != _style->strokeJoin ||
              cache->style.dashCount != _style->dashCount ||
@@ -4585,11 +9293,17 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
             bStrokeDirty = tpTrue;
         }
 
+        /* see _tpGLCachePathImpl */
+        if (!_bIsClipPath && !bStrokeDirty && cache->bExtrudeStrokeOnGPU &&
+            cache->strokeHalfWidth != _style->strokeWidth / strokeScale * 0.5f)
+            bStrokeWidthDirty = tpTrue;
+
         /* TODO: Make this less ugly. We are basically just checking if anything changed that
         would result in a regeneration of the gradient geometry */
         if (!_bIsClipPath &&
             ((_style->fill.type == kTpPaintTypeGradient &&
-              (_path->lastFillGradientID !=
+              (cache->style.fill.type != kTpPaintTypeGradient ||
+               _path->lastFillGradientID !=
                    ((_tpGLGradient *)_style->fill.data.gradientData.gradient.pointer)->gradientID ||
                _path->bFillPaintTransformDirty ||
                ((_tpGLGradient *)_style->fill.data.gradientData.gradient.pointer)->bDirty))))
@@ -4598,15 +9312,25 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
         }
         if (!_bIsClipPath &&
             ((_style->stroke.type == kTpPaintTypeGradient &&
-              (_path->lastStrokeGradientID !=
+              (cache->style.stroke.type != kTpPaintTypeGradient ||
+               _path->lastStrokeGradientID !=
                    ((_tpGLGradient *)_style->stroke.data.gradientData.gradient.pointer)
                        ->gradientID ||
                _path->bStrokePaintTransformDirty ||
-               ((_tpGLGradient *)_style->stroke.data.gradientData.gradient.pointer)->bDirty)) ||
-             cache->style.scaleStroke != _style->scaleStroke))
+               ((_tpGLGradient *)_style->stroke.data.gradientData.gradient.pointer)->bDirty))))
         {
             bStrokeGradientDirty = tpTrue;
         }
+
+        /* the gradient geometry depends on the bounds of the path geometry. The gradient ids are
+         * also tracked per path, not per scale band */
+        if (!_bIsClipPath && (bGeometryDirty || bLodBandChanged))
+        {
+            if (_style->fill.type == kTpPaintTypeGradient)
+                bFillGradientDirty = tpTrue;
+            if (_style->stroke.type == kTpPaintTypeGradient)
+                bStrokeGradientDirty = tpTrue;
+        }
     }
     else
     {
@@ -4617,22 +9341,24 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
 
     /* build the cache */
     if (bGeometryDirty || bStrokeDirty || bFillGradientDirty || bStrokeGradientDirty ||
-        bTransformDirty)
-    {
-        if (_tpGLCachePathImpl(_ctx,
-                               _path,
-                               _style,
-                               cache,
-                               cache,
-                               bGeometryDirty,
-                               bStrokeDirty,
-                               bFillGradientDirty,
-                               bStrokeGradientDirty))
+        bTransformDirty || bStrokeWidthDirty)
+    {
+        if (_tpGLContextCachePath(_ctx,
+                                  _path,
+                                  _style,
+                                  cache,
+                                  cache,
+                                  bGeometryDirty,
+                                  bStrokeDirty,
+                                  bFillGradientDirty,
+                                  bStrokeGradientDirty))
         {
             return tpTrue;
         }
 
         _path->bPathGeometryDirty = tpFalse;
+        _path->lastGeometrySettingsID = _ctx->geometrySettingsID;
+        _path->lodBands[_path->lodIndex] = lodBand;
 
         /* this is a little ugly...if we recached any gradient, we need to reset the dirty flags and
          * cache the gradient ID. We don't do that in _tpGLCachePathImpl because these things should
@@ -4660,14 +9386,110 @@ TARP_LOCAL tpBool _tpGLUpdateInternalPathCache(_tpGLContext * _ctx,
     return tpFalse;
 }
 
+TARP_LOCAL const _tpGLRect * _tpGLPathSegmentBounds(_tpGLPath * _path)
+{
+    int i, j;
+    const _tpGLContour * c;
+    const tpSegment * seg;
+
+    if (_path->bSegmentBoundsDirty)
+    {
+        _tpGLInitBounds(&_path->segmentBounds);
+        for (i = 0; i < _path->contours.count; ++i)
+        {
+            c = _tpGLContourArrayAtPtr(&_path->contours, i);
+            for (j = 0; j < c->segments.count; ++j)
+            {
+                seg = &c->segments.array[j];
+                _tpGLEvaluatePointForBounds(seg->handleIn, &_path->segmentBounds);
+                _tpGLEvaluatePointForBounds(seg->position, &_path->segmentBounds);
+                _tpGLEvaluatePointForBounds(seg->handleOut, &_path->segmentBounds);
+            }
+        }
+        _path->bSegmentBoundsDirty = tpFalse;
+    }
+    return &_path->segmentBounds;
+}
+
+/* how far the stroke of _style can reach beyond the path, in the units of the stroke width */
+TARP_LOCAL tpFloat _tpGLStrokeReach(const tpStyle * _style)
+{
+    /* the corners of square caps are sqrt(2) half widths away, miters at most miterLimit */
+    tpFloat reach = 1.41422f;
+    if (_style->stroke.type == kTpPaintTypeNone || _style->strokeWidth <= 0)
+        return 0.0f;
+    if (_style->strokeJoin == kTpStrokeJoinMiter)
+        reach = TARP_MAX(reach, _style->miterLimit);
+    return reach * _style->strokeWidth * 0.5f;
+}
+
+/*
+checks if a path drawn with _style would lie outside of the clip bounds of the context. This only
+depends on the segments, the style and the transform projection, so it is done before the
+geometry of the path is generated.
+*/
+TARP_LOCAL tpBool _tpGLPathIsCulled(_tpGLContext * _ctx,
+                                    _tpGLPath * _path,
+                                    const tpStyle * _style)
+{
+    int i;
+    _tpGLRect bounds, transformed, device;
+    tpVec2 p;
+    tpFloat reach, w;
+    const tpFloat * m = _ctx->projection.v;
+
+    bounds = *_tpGLPathSegmentBounds(_path);
+    if (bounds.min.x > bounds.max.x)
+        return tpFalse;
+
+    /* non scaling strokes extend the transformed path */
+    reach = _tpGLStrokeReach(_style);
+    if (_style->scaleStroke)
+    {
+        bounds.min = tpVec2Make(bounds.min.x - reach, bounds.min.y - reach);
+        bounds.max = tpVec2Make(bounds.max.x + reach, bounds.max.y + reach);
+        reach = 0.0f;
+    }
+
+    _tpGLInitBounds(&transformed);
+    for (i = 0; i < 4; ++i)
+    {
+        p = tpVec2Make(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y);
+        _tpGLEvaluatePointForBounds(tpTransformApply(&_ctx->transform, p), &transformed);
+    }
+    transformed.min = tpVec2Make(transformed.min.x - reach, transformed.min.y - reach);
+    transformed.max = tpVec2Make(transformed.max.x + reach, transformed.max.y + reach);
+
+    _tpGLInitBounds(&device);
+    for (i = 0; i < 4; ++i)
+    {
+        p = tpVec2Make(i & 1 ? transformed.max.x : transformed.min.x,
+                       i & 2 ? transformed.max.y : transformed.min.y);
+        w = m[3] * p.x + m[7] * p.y + m[15];
+        /* behind the camera */
+        if (w <= 0)
+            return tpFalse;
+        _tpGLEvaluatePointForBounds(tpVec2Make((m[0] * p.x + m[4] * p.y + m[12]) / w,
+                                               (m[1] * p.x + m[5] * p.y + m[13]) / w),
+                                    &device);
+    }
+
+    return _tpGLIsCulled(_ctx, &device);
+}
+
 TARP_LOCAL tpBool _tpGLDrawPathImpl(_tpGLContext * _ctx,
                                     _tpGLPath * _path,
                                     const tpStyle * _style,
                                     tpBool _bIsClipPath)
 {
+    /* skip the geometry update of paths that would not be visible anyways */
+    if (!_bIsClipPath && _tpGLPathIsCulled(_ctx, _path, _style))
+        return tpFalse;
     if (_tpGLUpdateInternalPathCache(_ctx, _path, _style, _bIsClipPath))
         return tpTrue;
     /* draw the cache */
+    if (!_bIsClipPath)
+        return _tpGLDrawOrBatchRenderCache(_ctx, _path->renderCache);
     return _tpGLDrawRenderCacheImpl(_ctx, _path->renderCache, _bIsClipPath);
 }
 
@@ -4679,8 +9501,19 @@ TARP_API tpBool tpDrawPath(tpContext _ctx, tpPath _path, const tpStyle * _style)
 
 TARP_API tpBool tpDrawRenderCache(tpContext _ctx, tpRenderCache _cache)
 {
-    return _tpGLDrawRenderCacheImpl(
-        (_tpGLContext *)_ctx.pointer, (_tpGLRenderCache *)_cache.pointer, tpFalse);
+    return _tpGLDrawOrBatchRenderCache((_tpGLContext *)_ctx.pointer,
+                                       (_tpGLRenderCache *)_cache.pointer);
+}
+
+TARP_API tpBool tpDrawRenderCacheInstanced(tpContext _ctx,
+                                           tpRenderCache _cache,
+                                           const tpRenderCacheInstance * _instances,
+                                           int _count)
+{
+    return _tpGLDrawRenderCacheInstanced((_tpGLContext *)_ctx.pointer,
+                                         (_tpGLRenderCache *)_cache.pointer,
+                                         _instances,
+                                         _count);
 }
 
 TARP_API tpBool _tpGLRenderCacheFlattenedContour(_tpGLRenderCache * _cache,
@@ -4723,35 +9556,188 @@ TARP_API tpBool tpRenderCacheFlattenedContour(tpRenderCache _cache,
         (_tpGLRenderCache *)_cache.pointer, _contourIndex, _outVertices, _outCount);
 }
 
+/*
+checks if the fill of the cache is a rectangle that is aligned with the pixel grid of the viewport,
+in which case clipping against it can be done with the scissor test alone. Rectangles that are
+rotated or not pixel aligned need the stencil planes to be rasterized like any other clip path.
+*/
+TARP_LOCAL tpBool _tpGLRenderCacheScissorBox(const _tpGLContext * _ctx,
+                                             const _tpGLRenderCache * _cache,
+                                             GLint * _outBox)
+{
+    int i, count;
+    tpFloat w;
+    tpVec2 p, corner, corners[4];
+    const _tpGLRenderCacheContour * c;
+    const tpFloat * m = _cache->renderMatrix.v;
+    const GLint * vp = _ctx->viewport;
+
+    if (_cache->contours.count != 1)
+        return tpFalse;
+
+    c = &_cache->contours.array[0];
+    count = 0;
+    for (i = 0; i < c->fillVertexCount; ++i)
+    {
+        /* to window coordinates */
+        p = _cache->geometryCache.array[c->fillVertexOffset + i];
+        w = m[3] * p.x + m[7] * p.y + m[15];
+        if (w <= 0)
+            return tpFalse;
+        p = tpVec2Make(vp[0] + ((m[0] * p.x + m[4] * p.y + m[12]) / w + 1.0f) * 0.5f * vp[2],
+                       vp[1] + ((m[1] * p.x + m[5] * p.y + m[13]) / w + 1.0f) * 0.5f * vp[3]);
+        corner = tpVec2Make((tpFloat)floor(p.x + 0.5f), (tpFloat)floor(p.y + 0.5f));
+        if (fabs(p.x - corner.x) > 1e-3f || fabs(p.y - corner.y) > 1e-3f)
+            return tpFalse;
+
+        /* skip repeated vertices, including the one closing the contour */
+        if (count && tpVec2Equals(corner, corners[count - 1]))
+            continue;
+        if (count == 4)
+        {
+            if (tpVec2Equals(corner, corners[0]))
+                continue;
+            return tpFalse;
+        }
+        corners[count++] = corner;
+    }
+
+    if (count != 4)
+        return tpFalse;
+
+    /* every edge has to be either horizontal or vertical, alternating */
+    for (i = 0; i < 4; ++i)
+    {
+        if ((corners[i].x == corners[(i + 1) % 4].x) == (corners[i].y == corners[(i + 1) % 4].y) ||
+            (corners[i].x == corners[(i + 1) % 4].x) ==
+                (corners[(i + 1) % 4].x == corners[(i + 2) % 4].x))
+            return tpFalse;
+    }
+
+    _outBox[0] = (GLint)TARP_MIN(corners[0].x, corners[2].x);
+    _outBox[1] = (GLint)TARP_MIN(corners[0].y, corners[2].y);
+    _outBox[2] = (GLint)fabs(corners[2].x - corners[0].x);
+    _outBox[3] = (GLint)fabs(corners[2].y - corners[0].y);
+    return tpTrue;
+}
+
+/* pushes a clip that does not clip anything, so that a failed tpBeginClipping can still be ended */
+TARP_LOCAL void _tpGLPushFailedClip(_tpGLContext * _ctx)
+{
+    _tpGLClip clip;
+
+    clip.bIsScissorClip = tpTrue;
+    clip.bScissorTest = _ctx->bScissorTest;
+    memcpy(clip.scissorBox, _ctx->scissorBox, sizeof(clip.scissorBox));
+    clip.clipBounds = _ctx->clipBounds;
+    _tpGLClipArrayAppendPtr(&_ctx->clips, &clip);
+}
+
+/* records what the clipping mask of _cache depends on */
+TARP_LOCAL void _tpGLClipMaskKeySet(_tpGLClipMaskKey * _key,
+                                    const _tpGLContext * _ctx,
+                                    const _tpGLRenderCache * _cache)
+{
+    _tpVec2ArrayClear(&_key->vertices);
+    _tpVec2ArrayAppendCArray(
+        &_key->vertices, _cache->geometryCache.array, _cache->boundsVertexOffset);
+    _tpGLSizeiArrayClear(&_key->fillCounts);
+    _tpGLSizeiArrayAppendArray(&_key->fillCounts, &_cache->fillCounts);
+    _key->fillTriangleCount = _cache->fillTriangleCount;
+    _key->fillRule = _cache->style.fillRule;
+    _key->renderMatrix = _cache->renderMatrix;
+    memcpy(_key->viewport, _ctx->viewport, sizeof(_key->viewport));
+    _key->bScissorTest = _ctx->bScissorTest;
+    memcpy(_key->scissorBox, _ctx->scissorBox, sizeof(_key->scissorBox));
+    _key->deviceBounds = _tpGLRenderCacheDeviceBounds(_cache);
+}
+
+/*
+checks if the clipping mask of _cache is the one _key was recorded for. The geometry is compared
+rather than the cache and its generation, as a different cache might have been created at the
+address of a destroyed one.
+*/
+TARP_LOCAL tpBool _tpGLClipMaskKeyMatches(const _tpGLClipMaskKey * _key,
+                                          const _tpGLContext * _ctx,
+                                          const _tpGLRenderCache * _cache)
+{
+    if (_key->vertices.count != _cache->boundsVertexOffset ||
+        _key->fillCounts.count != _cache->fillCounts.count ||
+        _key->fillTriangleCount != _cache->fillTriangleCount ||
+        _key->fillRule != _cache->style.fillRule || _key->bScissorTest != _ctx->bScissorTest)
+        return tpFalse;
+
+    if (_key->bScissorTest &&
+        memcmp(_key->scissorBox, _ctx->scissorBox, sizeof(_key->scissorBox)) != 0)
+        return tpFalse;
+
+    return (tpBool)(
+        memcmp(&_key->renderMatrix, &_cache->renderMatrix, sizeof(tpMat4)) == 0 &&
+        memcmp(_key->viewport, _ctx->viewport, sizeof(_key->viewport)) == 0 &&
+        memcmp(_key->fillCounts.array,
+               _cache->fillCounts.array,
+               sizeof(GLsizei) * _key->fillCounts.count) == 0 &&
+        memcmp(_key->vertices.array,
+               _cache->geometryCache.array,
+               sizeof(tpVec2) * _key->vertices.count) == 0);
+}
+
 TARP_LOCAL tpBool _tpGLGenerateClippingMaskForRenderCache(_tpGLContext * _ctx,
-                                                          _tpGLRenderCache * _cache,
-                                                          tpBool _bIsRebuilding)
+                                                          _tpGLRenderCache * _cache)
 {
-    tpBool drawResult;
+    GLint box[4];
+    _tpGLClip clip;
+    _tpGLRect deviceBounds;
+    tpBool bIsRetained;
     assert(_ctx && _cache);
 
-    if (!_bIsRebuilding)
+    _tpGLDrawBatchFlush(_ctx);
+
+    clip.bScissorTest = _ctx->bScissorTest;
+    memcpy(clip.scissorBox, _ctx->scissorBox, sizeof(clip.scissorBox));
+    clip.clipBounds = _ctx->clipBounds;
+    clip.bIsScissorClip = _tpGLRenderCacheScissorBox(_ctx, _cache, box);
+    if (clip.bIsScissorClip)
     {
-        _ctx->clippingStack[_ctx->clippingStackDepth++] = _cache;
+        _tpGLIntersectScissor(_ctx, box);
+        _tpGLApplyScissor(_ctx);
     }
+    else
+    {
+        if (_ctx->clippingStackDepth == _kTpGLMaxClippingDepth)
+        {
+            _tpGLSetErrorMessage("Too many nested clip paths for the stencil buffer.");
+            _tpGLPushFailedClip(_ctx);
+            return tpTrue;
+        }
 
-    /*
-    @TODO: Instead of clearing maybe just clear it in endClipping by
-    drawing the bounds of the last clip path? could be a potential speed up
-    */
-    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_ctx->currentClipStencilPlane));
-    _TARP_ASSERT_NO_GL_ERROR(glClearStencil(~0));
-    _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
-
-    /* draw path */
-    drawResult = _tpGLDrawRenderCacheImpl(_ctx, _cache, tpTrue);
-    if (drawResult)
-        return tpTrue;
+        /* the mask that was last rendered at the bottom of the stack might still be there */
+        bIsRetained = tpFalse;
+        if (!_ctx->clippingStackDepth)
+        {
+            bIsRetained = (tpBool)(_ctx->bHasRetainedClipMask &&
+                                   _tpGLClipMaskKeyMatches(&_ctx->clipMaskKey, _ctx, _cache));
+            if (!bIsRetained)
+            {
+                _tpGLEraseRetainedClipMask(_ctx);
+                _tpGLClipMaskKeySet(&_ctx->clipMaskKey, _ctx, _cache);
+            }
+            _ctx->bHasRetainedClipMask = tpFalse;
+        }
 
-    _ctx->currentClipStencilPlane = _ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne
-                                        ? _kTpGLClippingStencilPlaneTwo
-                                        : _kTpGLClippingStencilPlaneOne;
+        /* draw path, which moves the pixels inside of it one level deeper into the stack */
+        if (!bIsRetained && _tpGLDrawRenderCacheImpl(_ctx, _cache, tpTrue))
+        {
+            _tpGLPushFailedClip(_ctx);
+            return tpTrue;
+        }
+        _ctx->clippingStack[_ctx->clippingStackDepth++] = _cache;
+    }
 
+    /* nothing outside of the cover geometry of the clip path can be drawn to anymore */
+    deviceBounds = _tpGLRenderCacheDeviceBounds(_cache);
+    _tpGLIntersectBounds(&_ctx->clipBounds, &deviceBounds);
+    _tpGLClipArrayAppendPtr(&_ctx->clips, &clip);
     return tpFalse;
 }
 
@@ -4761,9 +9747,12 @@ TARP_LOCAL tpBool _tpGLGenerateClippingMask(_tpGLContext * _ctx,
 {
     _ctx->clippingStyle.fillRule = _fillRule;
     if (_tpGLUpdateInternalPathCache(_ctx, _path, &_ctx->clippingStyle, tpTrue))
+    {
+        _tpGLPushFailedClip(_ctx);
         return tpTrue;
+    }
 
-    return _tpGLGenerateClippingMaskForRenderCache(_ctx, _path->renderCache, tpFalse);
+    return _tpGLGenerateClippingMaskForRenderCache(_ctx, _path->renderCache);
 }
 
 TARP_API tpBool tpBeginClipping(tpContext _ctx, tpPath _path)
@@ -4779,77 +9768,92 @@ TARP_API tpBool tpBeginClippingWithFillRule(tpContext _ctx, tpPath _path, tpFill
 
 TARP_API tpBool tpBeginClippingFromRenderCache(tpContext _ctx, tpRenderCache _cache)
 {
-    return _tpGLGenerateClippingMaskForRenderCache(
-        (_tpGLContext *)_ctx.pointer, (_tpGLRenderCache *)_cache.pointer, tpFalse);
+    return _tpGLGenerateClippingMaskForRenderCache((_tpGLContext *)_ctx.pointer,
+                                                   (_tpGLRenderCache *)_cache.pointer);
 }
 
 TARP_API tpBool tpEndClipping(tpContext _ctx)
 {
-    int i;
+    _tpGLClip * clip;
+    _tpGLRenderCache * cache;
     _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
-    assert(ctx->clippingStackDepth);
+    assert(ctx->clips.count);
 
-    --ctx->clippingStackDepth;
+    _tpGLDrawBatchFlush(ctx);
 
-    if (ctx->clippingStackDepth)
+    /* scissor clips only need to restore the previous scissor box */
+    clip = &ctx->clips.array[--ctx->clips.count];
+    ctx->clipBounds = clip->clipBounds;
+    if (clip->bIsScissorClip)
     {
-        /* check if the last clip mask is still in one of the clipping
-         * planes... */
-        if (ctx->bCanSwapStencilPlanes)
-        {
-            ctx->currentClipStencilPlane =
-                ctx->currentClipStencilPlane == _kTpGLClippingStencilPlaneOne
-                    ? _kTpGLClippingStencilPlaneTwo
-                    : _kTpGLClippingStencilPlaneOne;
-            ctx->bCanSwapStencilPlanes = tpFalse;
-        }
-        else
-        {
-            /* ...otherwise rebuild it */
-            ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
-            ctx->bCanSwapStencilPlanes = tpTrue;
-            _TARP_ASSERT_NO_GL_ERROR(
-                glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
-            _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
-            _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
-
-            for (i = 0; i < ctx->clippingStackDepth; ++i)
-            {
-                /* draw clip path */
-                _tpGLGenerateClippingMaskForRenderCache(ctx, ctx->clippingStack[i], tpTrue);
-            }
-        }
+        ctx->bScissorTest = clip->bScissorTest;
+        memcpy(ctx->scissorBox, clip->scissorBox, sizeof(ctx->scissorBox));
+        _tpGLApplyScissor(ctx);
+        return tpFalse;
     }
-    else
+
+    /*
+    the pixels of the deepest level of the stack all lie inside of the cover geometry of the last
+    clip path, so drawing it once more moves them back up a level. Nothing needs to be cleared or
+    rebuilt.
+    */
+    cache = ctx->clippingStack[--ctx->clippingStackDepth];
+
+    /* nothing tests against the clipping plane at the bottom of the stack, so the mask can stay
+     * in case the same clip path begins again */
+    if (!ctx->clippingStackDepth)
     {
-        /*
-        @TODO: Instead of clearing maybe just redrawing the clipping path
-        bounds to reset the stencil? Might scale better for a lot of paths
-        :)
-        */
-        ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
-        ctx->bCanSwapStencilPlanes = tpTrue;
-        _TARP_ASSERT_NO_GL_ERROR(
-            glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
-        _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
-        _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
+        ctx->bHasRetainedClipMask = tpTrue;
+        return tpFalse;
     }
 
+    if (!cache->contours.count)
+        return tpFalse;
+
+    _tpGLBindRenderCache(ctx, cache);
+    _TARP_ASSERT_NO_GL_ERROR(
+        glUniformMatrix4fv(ctx->tpLoc, 1, GL_FALSE, &cache->renderMatrix.v[0]));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlane));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilFunc(GL_LEQUAL,
+                                           ctx->clippingStackDepth << _kTpGLClippingDepthShift,
+                                           _kTpGLClippingStencilPlane));
+    _TARP_ASSERT_NO_GL_ERROR(glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE));
+    _TARP_ASSERT_NO_GL_ERROR(glMultiDrawArrays(GL_TRIANGLE_FAN,
+                                               cache->fillCoverFirsts.array,
+                                               cache->fillCoverCounts.array,
+                                               cache->fillCoverFirsts.count));
+    _TARP_ASSERT_NO_GL_ERROR(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+
     return tpFalse;
 }
 
 TARP_API tpBool tpResetClipping(tpContext _ctx)
 {
     _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
-    _TARP_ASSERT_NO_GL_ERROR(
-        glStencilMask(_kTpGLClippingStencilPlaneOne | _kTpGLClippingStencilPlaneTwo));
+    _tpGLDrawBatchFlush(ctx);
+
+    /* back to the scissor state of the user */
+    ctx->bScissorTest = ctx->stateBackup.scissorTest;
+    memcpy(ctx->scissorBox, ctx->stateBackup.scissorBox, sizeof(ctx->scissorBox));
+    _tpGLApplyScissor(ctx);
+    _tpGLResetClipBounds(ctx);
+
+    _TARP_ASSERT_NO_GL_ERROR(glStencilMask(_kTpGLClippingStencilPlane));
     _TARP_ASSERT_NO_GL_ERROR(glClearStencil(0));
     _TARP_ASSERT_NO_GL_ERROR(glClear(GL_STENCIL_BUFFER_BIT));
 
-    ctx->currentClipStencilPlane = _kTpGLClippingStencilPlaneOne;
-    ctx->bCanSwapStencilPlanes = tpTrue;
     ctx->clippingStackDepth = 0;
+    _tpGLClipArrayClear(&ctx->clips);
+    ctx->bHasRetainedClipMask = tpFalse;
+
+    return tpFalse;
+}
 
+TARP_API tpBool tpSetRetainClippingMasks(tpContext _ctx, tpBool _bEnabled)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    ctx->bRetainClippingMasks = _bEnabled;
     return tpFalse;
 }
 
@@ -4871,18 +9875,13 @@ TARP_API tpBool tpSetDefaultProjection(tpContext _ctx, tpFloat _width, tpFloat _
 
 TARP_API tpBool tpSetTransform(tpContext _ctx, const tpTransform * _transform)
 {
-    tpFloat rotation;
     _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
 
     if (!tpTransformEquals(_transform, &ctx->transform))
     {
-        tpVec2 scale, skew, translation;
         ctx->transform = *_transform;
         ctx->transformID++;
         ctx->bTransformProjDirty = tpTrue;
-
-        tpTransformDecompose(_transform, &translation, &scale, &skew, &rotation);
-        ctx->transformScale = TARP_MAX(scale.x, scale.y);
     }
 
     return tpFalse;
@@ -4892,12 +9891,144 @@ TARP_API tpBool tpResetTransform(tpContext _ctx)
 {
     _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
     ctx->transform = tpTransformMakeIdentity();
-    ctx->transformScale = 1.0;
     ctx->transformID++;
     ctx->bTransformProjDirty = tpTrue;
     return tpFalse;
 }
 
+TARP_API tpBool tpSetFlatteningMode(tpContext _ctx, tpFlatteningMode _mode)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->builder.flatteningMode != _mode)
+    {
+        ctx->builder.flatteningMode = _mode;
+        ctx->geometrySettingsID++;
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetFlatteningTolerance(tpContext _ctx, tpFloat _pixels)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (_pixels <= 0)
+    {
+        _tpGLSetErrorMessage("The flattening tolerance has to be greater than zero.");
+        return tpTrue;
+    }
+
+    if (ctx->builder.flatteningTolerance != _pixels)
+    {
+        ctx->builder.flatteningTolerance = _pixels;
+        ctx->geometrySettingsID++;
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetStrokeExtrusionMode(tpContext _ctx, tpStrokeExtrusionMode _mode)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->builder.strokeExtrusionMode != _mode)
+    {
+        ctx->builder.strokeExtrusionMode = _mode;
+        ctx->geometrySettingsID++;
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetFillMode(tpContext _ctx, tpFillMode _mode)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->builder.fillMode != _mode)
+    {
+        ctx->builder.fillMode = _mode;
+        ctx->geometrySettingsID++;
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetJobSystem(tpContext _ctx, const tpJobSystem * _jobSystem)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (_jobSystem && (!_jobSystem->submit || !_jobSystem->wait))
+    {
+        _tpGLSetErrorMessage("The job system needs a submit and a wait function.");
+        return tpTrue;
+    }
+
+    /* an external job system replaces the built-in thread pool */
+    tpSetThreadPoolSize(_ctx, 0);
+    if (_jobSystem)
+    {
+        ctx->builder.jobSystem = *_jobSystem;
+    }
+    else
+    {
+        ctx->builder.jobSystem.userData = NULL;
+        ctx->builder.jobSystem.submit = NULL;
+        ctx->builder.jobSystem.wait = NULL;
+    }
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetThreadPoolSize(tpContext _ctx, int _threadCount)
+{
+#if defined(TARP_THREADS_PTHREAD) || defined(TARP_THREADS_WIN32)
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (ctx->threadPool)
+    {
+        _tpGLThreadPoolDestroy(ctx->threadPool);
+        ctx->threadPool = NULL;
+        ctx->builder.jobSystem.userData = NULL;
+        ctx->builder.jobSystem.submit = NULL;
+        ctx->builder.jobSystem.wait = NULL;
+    }
+
+    if (_threadCount > 0)
+    {
+        ctx->threadPool = _tpGLThreadPoolCreate(_threadCount);
+        if (!ctx->threadPool)
+        {
+            _tpGLSetErrorMessage("Could not start the threads of the thread pool.");
+            return tpTrue;
+        }
+        ctx->builder.jobSystem.userData = ctx->threadPool;
+        ctx->builder.jobSystem.submit = _tpGLThreadPoolSubmit;
+        ctx->builder.jobSystem.wait = _tpGLThreadPoolWait;
+    }
+    return tpFalse;
+#else
+    (void)_ctx;
+    if (_threadCount > 0)
+    {
+        _tpGLSetErrorMessage("Tarp was compiled without thread support.");
+        return tpTrue;
+    }
+    return tpFalse;
+#endif
+}
+
+TARP_API tpBool tpSetGeometryUploadMode(tpContext _ctx, tpGeometryUploadMode _mode)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    ctx->requestedUploadMode = _mode;
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetDrawBatching(tpContext _ctx, tpBool _bEnabled)
+{
+    _tpGLContext * ctx = (_tpGLContext *)_ctx.pointer;
+    if (!_bEnabled)
+        _tpGLDrawBatchFlush(ctx);
+    ctx->bBatchDraws = _bEnabled;
+    return tpFalse;
+}
+
+TARP_API tpBool tpSetContourCulling(tpContext _ctx, tpBool _bEnabled)
+{
+    ((_tpGLContext *)_ctx.pointer)->bCullContours = _bEnabled;
+    return tpFalse;
+}
+
 #endif /* TARP_IMPLEMENTATION_OPENGL */
 #endif /* TARP_IMPLEMENTATION */
 
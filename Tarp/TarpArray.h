@@ -40,6 +40,17 @@ TARP_API int _TARP_FN(_TARP_ARRAY_T, Reserve)(_TARP_ARRAY_T * _array, int _capac
     return 1;
 }
 
+/* makes sure that there is room for at least _count more items, growing the capacity geometrically */
+TARP_API int _TARP_FN(_TARP_ARRAY_T, ReserveAdditional)(_TARP_ARRAY_T * _array, int _count)
+{
+    int c;
+    assert(_array);
+    if (_array->capacity - _array->count >= _count)
+        return 0;
+    c = _array->count + _count;
+    return _TARP_FN(_TARP_ARRAY_T, Reserve)(_array, c > _array->capacity * 2 ? c : _array->capacity * 2);
+}
+
 TARP_API int _TARP_FN(_TARP_ARRAY_T, Init)(_TARP_ARRAY_T * _array, int _capacity)
 {
     assert(_array);
@@ -0,0 +1,1050 @@
+/*
+Headless smoke tests for the optional modes of the OpenGL implementation. Every test renders the
+same frames with the mode enabled and with the default code path and compares the pixels, or probes
+pixels whose color is known. After each frame the stencil buffer has to be clean again. Returns
+EXIT_FAILURE if any test failed.
+*/
+
+/* include opengl */
+#include <GL/gl3w.h>
+
+/* we use GLFW to create an invisible window that provides the opengl context */
+#include <GLFW/glfw3.h>
+
+/* tell Tarp to compile the opengl implementations */
+#define TARP_IMPLEMENTATION_OPENGL
+#include <Tarp/Tarp.h>
+
+#define WIDTH 256
+#define HEIGHT 256
+#define FRAME_COUNT 4
+
+/* the number of pixels that may differ if a mode only matches the default path within rounding */
+#define EDGE_TOLERANCE (WIDTH * HEIGHT / 100)
+
+/* the random curves that are flattened and the error that is allowed relative to their size */
+#define CURVE_COUNT 96
+#define CURVES_PER_CONTOUR 6
+#define FLATTENING_TOLERANCE 1e-5
+
+typedef void (*DrawFunction)(tpContext _ctx, int _frame);
+
+#define MAX_DEFERRED_JOBS 64
+
+typedef struct
+{
+    tpJobFunction functions[MAX_DEFERRED_JOBS];
+    void * data[MAX_DEFERRED_JOBS];
+    int count;
+    int submitCount;
+} DeferredJobs;
+
+static tpPath star, zigzag, ring, ellipse, grid, clipCircle, clipRect, corner, changing, fresh;
+static tpGradient gradient;
+static tpRenderCache builtCaches[FRAME_COUNT];
+static unsigned char reference[FRAME_COUNT][WIDTH * HEIGHT * 4];
+static unsigned char pixels[WIDTH * HEIGHT * 4];
+static unsigned char stencil[WIDTH * HEIGHT];
+static int failureCount = 0;
+
+static void fail(const char * _test, const char * _message, int _frame)
+{
+    printf("FAILED %s (frame %d): %s\n", _test, _frame, _message);
+    failureCount++;
+}
+
+/* draws one frame into the bound framebuffer and reads it back to _out */
+static void renderFrame(const char * _test,
+                        tpContext _ctx,
+                        DrawFunction _draw,
+                        int _frame,
+                        int _bRetainsStencil,
+                        unsigned char * _out)
+{
+    int i;
+
+    /* retained clipping masks stay in the stencil buffer on purpose, so it must not be cleared */
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | (_bRetainsStencil ? 0 : GL_STENCIL_BUFFER_BIT));
+
+    if (tpPrepareDrawing(_ctx))
+        fail(_test, tpErrorMessage(), _frame);
+    tpResetTransform(_ctx);
+    _draw(_ctx, _frame);
+    if (tpFinishDrawing(_ctx))
+        fail(_test, tpErrorMessage(), _frame);
+
+    glReadPixels(0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, _out);
+
+    if (!_bRetainsStencil)
+    {
+        glReadPixels(0, 0, WIDTH, HEIGHT, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, stencil);
+        for (i = 0; i < WIDTH * HEIGHT; ++i)
+        {
+            if (stencil[i])
+            {
+                fail(_test, "the stencil buffer was not cleaned up", _frame);
+                break;
+            }
+        }
+    }
+}
+
+static void renderReference(tpContext _ctx, DrawFunction _draw)
+{
+    int i;
+    for (i = 0; i < FRAME_COUNT; ++i)
+        renderFrame("reference", _ctx, _draw, i, 0, reference[i]);
+}
+
+/* renders all frames and compares them to the reference frames */
+static void renderAndCompare(const char * _test,
+                             tpContext _ctx,
+                             DrawFunction _draw,
+                             int _bRetainsStencil,
+                             int _maxDifferingPixels)
+{
+    int i, j, differing;
+    char message[128];
+
+    for (i = 0; i < FRAME_COUNT; ++i)
+    {
+        renderFrame(_test, _ctx, _draw, i, _bRetainsStencil, pixels);
+        differing = 0;
+        for (j = 0; j < WIDTH * HEIGHT * 4; j += 4)
+        {
+            if (memcmp(&pixels[j], &reference[i][j], 4) != 0)
+                differing++;
+        }
+        if (differing > _maxDifferingPixels)
+        {
+            sprintf(message, "%d pixels differ from the reference", differing);
+            fail(_test, message, i);
+        }
+    }
+}
+
+/* checks if the pixel at _x, _y (from the top left) is close to the given color */
+static int pixelIs(int _x, int _y, tpFloat _r, tpFloat _g, tpFloat _b)
+{
+    const unsigned char * p = &pixels[((HEIGHT - 1 - _y) * WIDTH + _x) * 4];
+    return abs(p[0] - (int)(_r * 255)) <= 2 && abs(p[1] - (int)(_g * 255)) <= 2 &&
+           abs(p[2] - (int)(_b * 255)) <= 2;
+}
+
+static void drawCurves(tpContext _ctx, int _frame)
+{
+    int i;
+    tpStyle style;
+    tpTransform transform, scale;
+
+    style = tpStyleMake();
+    style.fill = tpPaintMakeColor(0.9f, 0.5f, 0.1f, 0.8f);
+    style.stroke = tpPaintMakeColor(0.1f, 0.2f, 0.9f, 0.9f);
+    style.strokeWidth = 2.0f;
+
+    /* the same curves at several scales, so that they are flattened into more or less segments */
+    for (i = 0; i < 3; ++i)
+    {
+        transform = tpTransformMakeTranslation(50 + i * 75, 60);
+        scale = tpTransformMakeScale(0.4f + i * 0.2f + _frame * 0.1f, 0.6f);
+        transform = tpTransformCombine(&transform, &scale);
+        tpSetTransform(_ctx, &transform);
+        tpDrawPath(_ctx, ring, &style);
+
+        transform = tpTransformMakeTranslation(50 + i * 75, 180);
+        scale = tpTransformMakeScale(1.0f + _frame * 0.5f, 1.0f + i);
+        transform = tpTransformCombine(&transform, &scale);
+        tpSetTransform(_ctx, &transform);
+        tpDrawPath(_ctx, zigzag, &style);
+    }
+}
+
+static tpStyle ellipseStyle()
+{
+    tpStyle style = tpStyleMake();
+    style.fill = tpPaintMakeColor(0.9f, 0.5f, 0.1f, 1.0f);
+    style.stroke.type = kTpPaintTypeNone;
+    return style;
+}
+
+/* a small ellipse that the transform and a projection that zooms in a hundred times scale up */
+static void drawScaledEllipse(tpContext _ctx, int _frame)
+{
+    tpStyle style;
+    tpTransform transform, scale;
+    tpMat4 projection;
+
+    style = ellipseStyle();
+    projection = tpMat4MakeOrtho(0, WIDTH / 100.0f, HEIGHT / 100.0f, 0, -1, 1);
+    tpSetProjection(_ctx, &projection);
+    transform = tpTransformMakeTranslation(1.28f, 1.28f);
+    scale = tpTransformMakeScale(0.02f + _frame * 0.03f, 0.01f + _frame * 0.015f);
+    transform = tpTransformCombine(&transform, &scale);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, ellipse, &style);
+    tpSetDefaultProjection(_ctx, WIDTH, HEIGHT);
+}
+
+/* the same ellipse, with the scale applied to the path instead */
+static void drawLargeEllipse(tpContext _ctx, int _frame)
+{
+    tpStyle style;
+    tpTransform transform;
+    tpPath path;
+
+    style = ellipseStyle();
+    path = tpPathCreate();
+    tpPathAddEllipse(path, 0, 0, 20.0f * (2.0f + _frame * 3.0f), 20.0f * (1.0f + _frame * 1.5f));
+    transform = tpTransformMakeTranslation(128, 128);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, path, &style);
+    tpPathDestroy(path);
+}
+
+static void drawStrokes(tpContext _ctx, int _frame)
+{
+    int i;
+    tpStyle style;
+    tpTransform transform;
+    tpFloat dashes[] = { 12, 6, 3, 6 };
+
+    style = tpStyleMake();
+    style.fill.type = kTpPaintTypeNone;
+    style.miterLimit = 8;
+    for (i = 0; i < 6; ++i)
+    {
+        style.stroke = tpPaintMakeColor(0.2f * i, 1.0f - 0.15f * i, 0.5f, 1.0f);
+        style.strokeWidth = 3.0f + i + _frame * 2.0f;
+        style.strokeJoin = (tpStrokeJoin)(i % 3);
+        style.strokeCap = (tpStrokeCap)(i % 3);
+        style.scaleStroke = (tpBool)(i < 3);
+        style.dashArray = dashes;
+        style.dashCount = i == 4 ? 4 : 0;
+        transform = tpTransformMakeTranslation(50 + (i % 3) * 80, 60 + (i / 3) * 120);
+        if (i == 5)
+        {
+            tpTransform scale = tpTransformMakeScale(1.0f + _frame * 0.25f, 0.75f);
+            transform = tpTransformCombine(&transform, &scale);
+        }
+        tpSetTransform(_ctx, &transform);
+        tpDrawPath(_ctx, i % 2 ? star : zigzag, &style);
+    }
+}
+
+/*
+rebuilds the grid with enough contours for parallel flattening, so that all of them are flattened
+and stroked again every frame
+*/
+static void updateGrid(int _frame)
+{
+    int x, y;
+
+    tpPathClear(grid);
+    for (y = 0; y < 30; ++y)
+    {
+        for (x = 0; x < 30; ++x)
+        {
+            if ((x + y) % 2)
+                tpPathAddCircle(grid, x * 16.0f, y * 16.0f, 6.0f + (x + _frame) % 3);
+            else
+                tpPathAddRect(grid, x * 16.0f - 5.0f, y * 16.0f - 7.0f, 11.0f, 13.0f);
+        }
+    }
+}
+
+static void drawGrid(tpContext _ctx, int _frame)
+{
+    tpStyle style;
+    tpTransform transform;
+
+    updateGrid(_frame);
+
+    style = tpStyleMake();
+    style.fill = tpPaintMakeColor(0.3f, 0.6f, 0.9f, 0.8f);
+    style.stroke = tpPaintMakeColor(0.1f, 0.1f, 0.1f, 1.0f);
+    style.strokeWidth = 2.0f;
+    style.fillRule = _frame % 2 ? kTpFillRuleNonZero : kTpFillRuleEvenOdd;
+
+    transform = tpTransformMakeTranslation(-40.0f * _frame, 25.0f * _frame);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, grid, &style);
+
+    tpResetTransform(_ctx);
+    tpBeginClipping(_ctx, clipCircle);
+    tpSetTransform(_ctx, &transform);
+    style.fill = tpPaintMakeGradient(gradient);
+    tpDrawPath(_ctx, grid, &style);
+    tpResetTransform(_ctx);
+    tpEndClipping(_ctx);
+}
+
+static void drawTiles(tpContext _ctx, int _frame)
+{
+    int i;
+    tpStyle style;
+    tpTransform transform, scale;
+
+    style = tpStyleMake();
+    style.stroke = tpPaintMakeColor(0.1f, 0.1f * _frame, 0.3f, 1.0f);
+    style.strokeWidth = 2.0f + _frame;
+    style.fillRule = _frame % 2 ? kTpFillRuleNonZero : kTpFillRuleEvenOdd;
+    scale = tpTransformMakeScale(0.4f, 0.4f);
+    for (i = 0; i < 16; ++i)
+    {
+        style.fill = tpPaintMakeColor(i / 16.0f, 0.5f, 1.0f - i / 16.0f, 0.9f);
+        transform = tpTransformMakeTranslation(32.0f + (i % 4) * 64, 32.0f + (i / 4) * 64);
+        transform = tpTransformCombine(&transform, &scale);
+        tpSetTransform(_ctx, &transform);
+        tpDrawPath(_ctx, star, &style);
+    }
+}
+
+static tpRenderCacheInstance starInstance(int _frame, int _index)
+{
+    tpRenderCacheInstance ret;
+    tpTransform rotation;
+
+    /* some instances overlap to check that they are drawn in order */
+    ret.transform =
+        tpTransformMakeTranslation(40.0f + (_index % 4) * 55, 50.0f + (_index / 4) * 70);
+    rotation = tpTransformMakeRotation(_index * 0.5f + _frame * 0.2f);
+    ret.transform = tpTransformCombine(&ret.transform, &rotation);
+    ret.fill = tpColorMake(_index / 12.0f, 0.8f, 0.3f, 0.8f);
+    ret.stroke = tpColorMake(0.2f, 0.1f, _index / 12.0f, 1.0f);
+    return ret;
+}
+
+static tpStyle instancedStyle()
+{
+    tpStyle style = tpStyleMake();
+    style.strokeWidth = 4.0f;
+    return style;
+}
+
+static void drawInstancesSeparately(tpContext _ctx, int _frame)
+{
+    int i;
+    tpStyle style;
+    tpTransform scale;
+    tpRenderCacheInstance instance;
+
+    style = instancedStyle();
+    scale = tpTransformMakeScale(0.6f, 0.6f);
+    for (i = 0; i < 12; ++i)
+    {
+        instance = starInstance(_frame, i);
+        instance.transform = tpTransformCombine(&instance.transform, &scale);
+        style.fill = tpPaintMakeColor(
+            instance.fill.r, instance.fill.g, instance.fill.b, instance.fill.a);
+        style.stroke = tpPaintMakeColor(
+            instance.stroke.r, instance.stroke.g, instance.stroke.b, instance.stroke.a);
+        tpSetTransform(_ctx, &instance.transform);
+        tpDrawPath(_ctx, star, &style);
+    }
+}
+
+static void drawInstanced(tpContext _ctx, int _frame)
+{
+    int i;
+    tpStyle style;
+    tpTransform scale;
+    tpRenderCache cache;
+    tpRenderCacheInstance instances[12];
+
+    style = instancedStyle();
+    scale = tpTransformMakeScale(0.6f, 0.6f);
+    for (i = 0; i < 12; ++i)
+        instances[i] = starInstance(_frame, i);
+    cache = tpRenderCacheCreate();
+    tpSetTransform(_ctx, &scale);
+    tpCachePath(_ctx, star, &style, cache);
+    tpDrawRenderCacheInstanced(_ctx, cache, instances, 12);
+    tpRenderCacheDestroy(cache);
+}
+
+static void drawFills(tpContext _ctx, int _frame)
+{
+    tpStyle style;
+    tpTransform transform;
+    tpRenderCache cache;
+
+    style = tpStyleMake();
+    style.fill = tpPaintMakeColor(0.9f, 0.5f, 0.1f, 0.8f);
+    style.stroke = tpPaintMakeColor(0.1f, 0.2f, 0.9f, 0.9f);
+    style.strokeWidth = 2.0f + _frame * 2.0f;
+    style.strokeJoin = kTpStrokeJoinRound;
+    style.fillRule = _frame % 2 ? kTpFillRuleNonZero : kTpFillRuleEvenOdd;
+
+    /* through the internal cache of the path, which only restrokes if the width changes */
+    transform = tpTransformMakeTranslation(60, 60);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, star, &style);
+
+    style.fill = tpPaintMakeGradient(gradient);
+    transform = tpTransformMakeTranslation(190, 60);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, star, &style);
+
+    /* through a render cache */
+    style.fill = tpPaintMakeColor(0.3f, 0.8f, 0.3f, 0.8f);
+    cache = tpRenderCacheCreate();
+    transform = tpTransformMakeTranslation(60, 190);
+    tpSetTransform(_ctx, &transform);
+    tpCachePath(_ctx, ring, &style, cache);
+    tpDrawRenderCache(_ctx, cache);
+    tpRenderCacheDestroy(cache);
+
+    /* as a clip path */
+    transform = tpTransformMakeTranslation(190, 190);
+    tpSetTransform(_ctx, &transform);
+    tpBeginClipping(_ctx, star);
+    tpResetTransform(_ctx);
+    style.fill = tpPaintMakeColor(0.8f, 0.8f, 0.2f, 1.0f);
+    style.stroke.type = kTpPaintTypeNone;
+    tpDrawPath(_ctx, clipRect, &style);
+    tpEndClipping(_ctx);
+}
+
+static void drawNestedClips(tpContext _ctx, int _frame)
+{
+    int i;
+    tpStyle style;
+    tpTransform transform;
+
+    style = tpStyleMake();
+    style.stroke.type = kTpPaintTypeNone;
+
+    /* the same clip path begins at the bottom of the stack several times per frame. It moves
+     * every other frame, so its mask can only be reused from the previous frame in between. */
+    for (i = 0; i < 3; ++i)
+    {
+        transform = tpTransformMakeTranslation((_frame / 2) * 12.0f, 0.0f);
+        tpSetTransform(_ctx, &transform);
+        tpBeginClipping(_ctx, clipCircle);
+        tpResetTransform(_ctx);
+        tpBeginClipping(_ctx, clipRect);
+        transform = tpTransformMakeTranslation(_frame * 10.0f, i * 30.0f);
+        tpSetTransform(_ctx, &transform);
+        tpBeginClippingWithFillRule(_ctx, ring, kTpFillRuleEvenOdd);
+        tpResetTransform(_ctx);
+        style.fill = tpPaintMakeColor(0.2f * i, 0.9f, 0.4f, 0.7f);
+        tpDrawPath(_ctx, clipRect, &style);
+        tpEndClipping(_ctx);
+        tpEndClipping(_ctx);
+        tpEndClipping(_ctx);
+    }
+}
+
+static void drawDeepClips(tpContext _ctx, int _frame)
+{
+    int i;
+    tpStyle style;
+    tpTransform transform;
+
+    style = tpStyleMake();
+    style.stroke.type = kTpPaintTypeNone;
+    style.fill = tpPaintMakeColor(1.0f, 0.0f, 0.0f, 1.0f);
+
+    /* as many clip paths as the stencil buffer can hold (with the default TARP_GL_CLIP_DEPTH_BITS),
+     * interleaved with scissor clips */
+    for (i = 0; i < 30; ++i)
+    {
+        transform = tpTransformMakeTranslation(-1.0f * i, -1.0f * i);
+        tpSetTransform(_ctx, &transform);
+        if (tpBeginClipping(_ctx, i % 2 ? clipCircle : clipRect))
+            fail("deep clipping stack", tpErrorMessage(), _frame);
+    }
+    if (!tpBeginClipping(_ctx, clipCircle))
+        fail("deep clipping stack", "the stencil buffer can't hold another clip path", _frame);
+    tpResetTransform(_ctx);
+    tpDrawPath(_ctx, clipRect, &style);
+
+    /* the failed clip path needs to be ended, too */
+    for (i = 0; i < 31; ++i)
+        tpEndClipping(_ctx);
+    style.fill = tpPaintMakeColor(0.0f, 1.0f, 0.0f, 1.0f);
+    tpDrawPath(_ctx, corner, &style);
+}
+
+static tpStyle offscreenStyle()
+{
+    tpStyle style = tpStyleMake();
+    style.fill = tpPaintMakeColor(1.0f, 1.0f, 0.0f, 1.0f);
+    style.stroke = tpPaintMakeColor(0.0f, 0.0f, 0.0f, 1.0f);
+    style.strokeWidth = 5.0f;
+    return style;
+}
+
+static void drawChangedWhileCulled(tpContext _ctx, int _frame)
+{
+    tpStyle style;
+    tpTransform transform;
+
+    /* the path is culled off screen, changed and then drawn on screen */
+    style = offscreenStyle();
+    transform = tpTransformMakeTranslation(-500.0f, 60.0f);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, changing, &style);
+    tpPathMoveTo(changing, 0, 0);
+    tpPathLineTo(changing, 30.0f + _frame * 10.0f, 30.0f);
+    tpPathLineTo(changing, 0, 40.0f);
+    tpPathClose(changing);
+    transform = tpTransformMakeTranslation(120.0f, 120.0f);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, changing, &style);
+}
+
+static void drawFresh(tpContext _ctx, int _frame)
+{
+    tpStyle style;
+    tpTransform transform;
+
+    (void)_frame;
+    style = offscreenStyle();
+    transform = tpTransformMakeTranslation(120.0f, 120.0f);
+    tpSetTransform(_ctx, &transform);
+    tpDrawPath(_ctx, fresh, &style);
+}
+
+static tpStyle ringStyle()
+{
+    tpStyle style = tpStyleMake();
+    style.fill = tpPaintMakeGradient(gradient);
+    style.stroke = tpPaintMakeColor(0.1f, 0.2f, 0.9f, 0.9f);
+    style.strokeWidth = 3.0f;
+    style.strokeJoin = kTpStrokeJoinRound;
+    return style;
+}
+
+static tpTransform ringTransform(int _frame)
+{
+    tpTransform transform, rotation;
+    transform = tpTransformMakeTranslation(128, 128);
+    rotation = tpTransformMakeRotation(_frame * 0.4f);
+    return tpTransformCombine(&transform, &rotation);
+}
+
+static void drawCachedRing(tpContext _ctx, int _frame)
+{
+    tpStyle style;
+    tpTransform transform;
+    tpRenderCache cache;
+
+    style = ringStyle();
+    transform = ringTransform(_frame);
+    cache = tpRenderCacheCreate();
+    tpSetTransform(_ctx, &transform);
+    tpCachePath(_ctx, ring, &style, cache);
+    tpDrawRenderCache(_ctx, cache);
+    tpRenderCacheDestroy(cache);
+}
+
+static void drawBuiltRing(tpContext _ctx, int _frame)
+{
+    tpDrawRenderCache(_ctx, builtCaches[_frame]);
+}
+
+/* evaluates the cubic bezier _curve (start, handles and end point) at _t in double precision */
+static void curvePoint(const double * _curve, double _t, double * _outX, double * _outY)
+{
+    double u = 1.0 - _t;
+    double a = u * u * u, b = 3 * u * u * _t, c = 3 * u * _t * _t, d = _t * _t * _t;
+    *_outX = a * _curve[0] + b * _curve[2] + c * _curve[4] + d * _curve[6];
+    *_outY = a * _curve[1] + b * _curve[3] + c * _curve[5] + d * _curve[7];
+}
+
+static double pointDistance(const tpVec2 * _point, double _x, double _y)
+{
+    return sqrt((_point->x - _x) * (_point->x - _x) + (_point->y - _y) * (_point->y - _y));
+}
+
+/*
+checks that the flattened points of consecutive curves lie on them, recovering the segment count of
+each curve from its first segment. Returns the index of the first point that is off or -1.
+*/
+static int checkFlattenedCurves(double (*_curves)[8],
+                                int _curveCount,
+                                const tpVec2 * _vertices,
+                                int _count)
+{
+    int i, j, k, segmentCount;
+    double x, y, distance, closest, size;
+
+    if (_vertices[0].x != _curves[0][0] || _vertices[0].y != _curves[0][1])
+        return 0;
+
+    for (i = 0, k = 1; i < _curveCount; ++i)
+    {
+        segmentCount = 1;
+        closest = -1.0;
+        for (j = 1; k < _count && j <= TARP_MAX_CURVE_SEGMENTS; ++j)
+        {
+            curvePoint(_curves[i], 1.0 / j, &x, &y);
+            distance = pointDistance(&_vertices[k], x, y);
+            if (closest < 0.0 || distance < closest)
+            {
+                closest = distance;
+                segmentCount = j;
+            }
+        }
+
+        /* forward differencing accumulates rounding errors relative to the size of the curve */
+        for (j = 0, size = 1.0; j < 8; ++j)
+            size = fabs(_curves[i][j]) > size ? fabs(_curves[i][j]) : size;
+
+        for (j = 1; j <= segmentCount; ++j, ++k)
+        {
+            if (k == _count)
+                return k;
+            curvePoint(_curves[i], (double)j / segmentCount, &x, &y);
+            if (pointDistance(&_vertices[k], x, y) > FLATTENING_TOLERANCE * size)
+                return k;
+        }
+    }
+
+    return k == _count ? -1 : k;
+}
+
+/*
+flattens contours of random curves of very different sizes and checks that every point lies on its
+curve. The test runs in the simd build and in the build with TARP_NO_SIMD, so both implementations
+are checked against the same double precision reference.
+*/
+static void testCurveFlattening(tpContext _ctx)
+{
+    int i, j, count, offPoint;
+    unsigned int seed;
+    double curves[CURVE_COUNT][8], scale;
+    tpPath path;
+    tpRenderCache cache;
+    tpStyle style;
+    tpVec2 * vertices;
+    char message[128];
+
+    /* a small linear congruential generator keeps the curves the same on every platform */
+    seed = 1;
+    path = tpPathCreate();
+    for (i = 0; i < CURVE_COUNT; ++i)
+    {
+        scale = i % 3 == 0 ? 1.0 : i % 3 == 1 ? 40.0 : 900.0;
+        curves[i][0] = i % CURVES_PER_CONTOUR ? curves[i - 1][6] : 0.0;
+        curves[i][1] = i % CURVES_PER_CONTOUR ? curves[i - 1][7] : 0.0;
+        for (j = 2; j < 8; ++j)
+        {
+            seed = seed * 1103515245u + 12345u;
+            curves[i][j] = ((seed >> 16) % 1000) / 1000.0 * scale;
+        }
+        /* straight curves are flattened to a single segment */
+        if (i % 7 == 6)
+        {
+            curves[i][2] = curves[i][0];
+            curves[i][3] = curves[i][1];
+            curves[i][4] = curves[i][6];
+            curves[i][5] = curves[i][7];
+        }
+        if (i % CURVES_PER_CONTOUR == 0)
+            tpPathMoveTo(path, (tpFloat)curves[i][0], (tpFloat)curves[i][1]);
+        tpPathCubicCurveTo(path,
+                           (tpFloat)curves[i][2],
+                           (tpFloat)curves[i][3],
+                           (tpFloat)curves[i][4],
+                           (tpFloat)curves[i][5],
+                           (tpFloat)curves[i][6],
+                           (tpFloat)curves[i][7]);
+    }
+
+    style = tpStyleMake();
+    style.stroke.type = kTpPaintTypeNone;
+    cache = tpRenderCacheCreate();
+    tpCachePath(_ctx, path, &style, cache);
+
+    for (i = 0; i < CURVE_COUNT / CURVES_PER_CONTOUR; ++i)
+    {
+        tpRenderCacheFlattenedContour(cache, i, &vertices, &count);
+        offPoint = checkFlattenedCurves(
+            &curves[i * CURVES_PER_CONTOUR], CURVES_PER_CONTOUR, vertices, count);
+        if (offPoint >= 0)
+        {
+            sprintf(message, "point %d of contour %d is not on its curve", offPoint, i);
+            fail("curve flattening", message, 0);
+        }
+    }
+
+    tpRenderCacheDestroy(cache);
+    tpPathDestroy(path);
+}
+
+static void testFlatteningMode(tpContext _ctx)
+{
+    tpSetFlatteningMode(_ctx, kTpFlatteningModeSubdivision);
+    renderReference(_ctx, drawCurves);
+    tpSetFlatteningMode(_ctx, kTpFlatteningModeForwardDifferencing);
+    renderAndCompare("forward differencing", _ctx, drawCurves, 0, EDGE_TOLERANCE);
+}
+
+static void testFlatteningTolerance(tpContext _ctx)
+{
+    /* the tolerance is in device pixels, so the scale of the transform must not matter */
+    renderReference(_ctx, drawLargeEllipse);
+    renderAndCompare("flattening tolerance", _ctx, drawScaledEllipse, 0, EDGE_TOLERANCE);
+}
+
+static void testStrokeExtrusion(tpContext _ctx)
+{
+    renderReference(_ctx, drawStrokes);
+    tpSetStrokeExtrusionMode(_ctx, kTpStrokeExtrusionModeGPU);
+    renderAndCompare("stroke extrusion on the gpu", _ctx, drawStrokes, 0, EDGE_TOLERANCE);
+    tpSetStrokeExtrusionMode(_ctx, kTpStrokeExtrusionModeCPU);
+}
+
+static void testThreadPool(tpContext _ctx)
+{
+    renderReference(_ctx, drawGrid);
+    if (tpSetThreadPoolSize(_ctx, 4))
+    {
+        printf("skipped thread pool: %s\n", tpErrorMessage());
+        return;
+    }
+    renderAndCompare("thread pool", _ctx, drawGrid, 0, 0);
+    tpSetThreadPoolSize(_ctx, 0);
+}
+
+/* a job system that runs all jobs in reverse order once tarp waits for them */
+static void deferredSubmit(void * _userData, tpJobFunction _fn, void * _data)
+{
+    DeferredJobs * jobs = (DeferredJobs *)_userData;
+    if (jobs->count == MAX_DEFERRED_JOBS)
+    {
+        _fn(_data);
+        return;
+    }
+    jobs->functions[jobs->count] = _fn;
+    jobs->data[jobs->count++] = _data;
+    jobs->submitCount++;
+}
+
+static void deferredWait(void * _userData)
+{
+    DeferredJobs * jobs = (DeferredJobs *)_userData;
+    while (jobs->count)
+    {
+        jobs->count--;
+        jobs->functions[jobs->count](jobs->data[jobs->count]);
+    }
+}
+
+static void testJobSystem(tpContext _ctx)
+{
+    DeferredJobs jobs;
+    tpJobSystem jobSystem;
+
+    renderReference(_ctx, drawGrid);
+    jobs.count = jobs.submitCount = 0;
+    jobSystem.userData = &jobs;
+    jobSystem.submit = deferredSubmit;
+    jobSystem.wait = deferredWait;
+    tpSetJobSystem(_ctx, &jobSystem);
+    renderAndCompare("custom job system", _ctx, drawGrid, 0, 0);
+    tpSetJobSystem(_ctx, NULL);
+    if (!jobs.submitCount)
+        fail("custom job system", "no jobs were submitted", 0);
+}
+
+static void testStreaming(tpContext _ctx)
+{
+    renderReference(_ctx, drawGrid);
+    tpSetGeometryUploadMode(_ctx, kTpGeometryUploadModeStreaming);
+    renderAndCompare("streamed geometry", _ctx, drawGrid, 0, 0);
+    tpSetGeometryUploadMode(_ctx, kTpGeometryUploadModeRetained);
+}
+
+static void compareBatching(tpContext _ctx, DrawFunction _draw)
+{
+    renderReference(_ctx, _draw);
+    tpSetDrawBatching(_ctx, tpTrue);
+    renderAndCompare("draw batching", _ctx, _draw, 0, 0);
+    tpSetGeometryUploadMode(_ctx, kTpGeometryUploadModeStreaming);
+    renderAndCompare("streamed draw batching", _ctx, _draw, 0, 0);
+    tpSetGeometryUploadMode(_ctx, kTpGeometryUploadModeRetained);
+    tpSetDrawBatching(_ctx, tpFalse);
+}
+
+static void testBatching(tpContext _ctx)
+{
+    compareBatching(_ctx, drawTiles);
+    compareBatching(_ctx, drawStrokes);
+    compareBatching(_ctx, drawGrid);
+}
+
+static void testInstancing(tpContext _ctx)
+{
+    /* the cache is flattened for its own transform rather than for every instance, so the edges
+     * may differ slightly */
+    renderReference(_ctx, drawInstancesSeparately);
+    renderAndCompare("instanced drawing", _ctx, drawInstanced, 0, EDGE_TOLERANCE);
+}
+
+static void testFillMode(tpContext _ctx)
+{
+    renderReference(_ctx, drawFills);
+    tpSetFillMode(_ctx, kTpFillModeTriangulate);
+    renderAndCompare("triangulated fills", _ctx, drawFills, 0, EDGE_TOLERANCE);
+    tpSetStrokeExtrusionMode(_ctx, kTpStrokeExtrusionModeGPU);
+    renderAndCompare("triangulated fills with gpu strokes", _ctx, drawFills, 0, EDGE_TOLERANCE);
+    tpSetStrokeExtrusionMode(_ctx, kTpStrokeExtrusionModeCPU);
+    tpSetFillMode(_ctx, kTpFillModeStencil);
+}
+
+static void testClipping(tpContext _ctx)
+{
+    int i;
+
+    /* the mask reused from the previous frame has to match rendering it again */
+    renderReference(_ctx, drawNestedClips);
+    tpSetRetainClippingMasks(_ctx, tpTrue);
+    renderAndCompare("retained clipping masks", _ctx, drawNestedClips, 1, 0);
+    tpSetRetainClippingMasks(_ctx, tpFalse);
+    renderAndCompare("clipping masks", _ctx, drawNestedClips, 0, 0);
+
+    /* only the intersection of all clip paths is drawn */
+    for (i = 0; i < 2; ++i)
+    {
+        renderFrame("deep clipping stack", _ctx, drawDeepClips, i, 0, pixels);
+        if (!pixelIs(100, 100, 1.0f, 0.0f, 0.0f))
+            fail("deep clipping stack", "the intersection of the clip paths is not drawn", i);
+        if (!pixelIs(30, 30, 0.2f, 0.2f, 0.2f) || !pixelIs(200, 200, 0.2f, 0.2f, 0.2f))
+            fail("deep clipping stack", "something is drawn outside of the clip paths", i);
+        if (!pixelIs(10, 10, 0.0f, 1.0f, 0.0f))
+            fail("deep clipping stack", "the clipping stack is not empty after ending it", i);
+    }
+}
+
+static void testViewportCulling(tpContext _ctx)
+{
+    int i;
+
+    /* compare against a copy of the path that was never drawn before */
+    changing = tpPathClone(star);
+    for (i = 0; i < FRAME_COUNT; ++i)
+    {
+        renderFrame("viewport culling", _ctx, drawChangedWhileCulled, i, 0, reference[0]);
+        fresh = tpPathClone(changing);
+        renderFrame("viewport culling", _ctx, drawFresh, i, 0, pixels);
+        tpPathDestroy(fresh);
+        if (memcmp(pixels, reference[0], sizeof(pixels)) != 0)
+            fail("viewport culling", "a path that changed while it was culled is stale", i);
+    }
+    tpPathDestroy(changing);
+}
+
+static void testContourCulling(tpContext _ctx)
+{
+    renderReference(_ctx, drawGrid);
+    tpSetContourCulling(_ctx, tpTrue);
+    renderAndCompare("contour culling", _ctx, drawGrid, 0, 0);
+    tpSetContourCulling(_ctx, tpFalse);
+}
+
+/* caches the ring for every frame with the geometry builder that _builder points to */
+static void * buildCaches(void * _builder)
+{
+    int i;
+    tpStyle style;
+    tpTransform transform;
+
+    style = ringStyle();
+    for (i = 0; i < FRAME_COUNT; ++i)
+    {
+        transform = ringTransform(i);
+        tpGeometryBuilderCachePath(
+            *(tpGeometryBuilder *)_builder, ring, &style, &transform, builtCaches[i]);
+    }
+    return NULL;
+}
+
+static void testGeometryBuilder(tpContext _ctx)
+{
+    int i;
+    tpGeometryBuilder builder;
+#ifdef TARP_THREADS_PTHREAD
+    pthread_t thread;
+#endif
+
+    renderReference(_ctx, drawCachedRing);
+
+    builder = tpGeometryBuilderCreate(_ctx);
+    for (i = 0; i < FRAME_COUNT; ++i)
+        builtCaches[i] = tpRenderCacheCreate();
+#ifdef TARP_THREADS_PTHREAD
+    /* the caches are built on another thread and only drawn on this one */
+    pthread_create(&thread, NULL, buildCaches, &builder);
+    pthread_join(thread, NULL);
+#else
+    buildCaches(&builder);
+#endif
+    tpGeometryBuilderDestroy(builder);
+
+    renderAndCompare("geometry builder", _ctx, drawBuiltRing, 0, 0);
+    for (i = 0; i < FRAME_COUNT; ++i)
+        tpRenderCacheDestroy(builtCaches[i]);
+}
+
+static void createPaths()
+{
+    star = tpPathCreate();
+    tpPathMoveTo(star, 0, -50);
+    tpPathLineTo(star, 30, 40);
+    tpPathLineTo(star, -45, -15);
+    tpPathLineTo(star, 45, -15);
+    tpPathLineTo(star, -30, 40);
+    tpPathClose(star);
+    tpPathAddCircle(star, 10, 0, 20);
+
+    zigzag = tpPathCreate();
+    tpPathMoveTo(zigzag, -32, 0);
+    tpPathLineTo(zigzag, -16, 0);
+    tpPathLineTo(zigzag, 0, 16);
+    tpPathLineTo(zigzag, 0, -16);
+    tpPathCubicCurveTo(zigzag, 16, -40, 32, 20, 32, 0);
+
+    ring = tpPathCreate();
+    tpPathAddCircle(ring, 0, 0, 50);
+    tpPathAddCircle(ring, 15, 0, 25);
+    tpPathAddEllipse(ring, -20, 10, 30, 12);
+
+    ellipse = tpPathCreate();
+    tpPathAddEllipse(ellipse, 0, 0, 20, 20);
+
+    grid = tpPathCreate();
+
+    clipCircle = tpPathCreate();
+    tpPathAddCircle(clipCircle, 128, 128, 90);
+    clipRect = tpPathCreate();
+    tpPathAddRect(clipRect, 40, 40, 176, 176);
+    corner = tpPathCreate();
+    tpPathAddRect(corner, 0, 0, 20, 20);
+
+    gradient = tpGradientCreateLinear(0, 0, WIDTH, HEIGHT);
+    tpGradientAddColorStop(gradient, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+    tpGradientAddColorStop(gradient, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
+}
+
+static void destroyPaths()
+{
+    tpPathDestroy(star);
+    tpPathDestroy(zigzag);
+    tpPathDestroy(ring);
+    tpPathDestroy(ellipse);
+    tpPathDestroy(grid);
+    tpPathDestroy(clipCircle);
+    tpPathDestroy(clipRect);
+    tpPathDestroy(corner);
+    tpGradientDestroy(gradient);
+}
+
+int main(int argc, char * argv[])
+{
+    tpContext ctx;
+    GLFWwindow * window;
+    GLuint framebuffer, renderbuffers[2];
+
+    (void)argc;
+    (void)argv;
+
+    /* initialize glfw */
+    if (!glfwInit())
+        return EXIT_FAILURE;
+
+    /* and set some hints to get the correct opengl versions/profiles */
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
+    /* create the window, it is never shown */
+    window = glfwCreateWindow(WIDTH, HEIGHT, "Tarp Smoke Tests", NULL, NULL);
+    if (!window)
+    {
+        glfwTerminate();
+        printf("Could not open GLFW window :(\n");
+        return EXIT_FAILURE;
+    }
+
+    glfwMakeContextCurrent(window);
+
+    /* init opengl function pointers */
+    if (gl3wInit())
+    {
+        fprintf(stderr, "failed to initialize OpenGL\n");
+        return EXIT_FAILURE;
+    }
+
+    /* render into a framebuffer without multisampling so that the pixels can be compared */
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WIDTH, HEIGHT);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(
+        GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(
+        GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        fprintf(stderr, "failed to create the framebuffer\n");
+        return EXIT_FAILURE;
+    }
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    /* initialize the tarp context */
+    ctx = tpContextCreate();
+    if (!tpContextIsValidHandle(ctx))
+    {
+        printf("Could not init Tarp context: %s\n", tpErrorMessage());
+        return EXIT_FAILURE;
+    }
+    tpSetDefaultProjection(ctx, WIDTH, HEIGHT);
+
+    createPaths();
+
+    testCurveFlattening(ctx);
+    testFlatteningMode(ctx);
+    testFlatteningTolerance(ctx);
+    testStrokeExtrusion(ctx);
+    testThreadPool(ctx);
+    testJobSystem(ctx);
+    testGeometryBuilder(ctx);
+    testStreaming(ctx);
+    testBatching(ctx);
+    testInstancing(ctx);
+    testFillMode(ctx);
+    testClipping(ctx);
+    testViewportCulling(ctx);
+    testContourCulling(ctx);
+
+    destroyPaths();
+
+    /* clean up tarp */
+    tpContextDestroy(ctx);
+
+    glDeleteRenderbuffers(2, renderbuffers);
+    glDeleteFramebuffers(1, &framebuffer);
+
+    /* clean up glfw */
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    if (failureCount)
+    {
+        printf("%d smoke tests failed\n", failureCount);
+        return EXIT_FAILURE;
+    }
+    printf("all smoke tests passed\n");
+    return EXIT_SUCCESS;
+}